@@ -0,0 +1,141 @@
+/*
+ * arena.cpp - bump allocator implementation
+ *
+ * chunks are aligned to a cache line so float buffers carved from them are SIMD friendly
+ * deallocation only counts live allocations - memory is reclaimed wholesale on rewind, or
+ * per retired step once its last allocation is returned
+ */
+
+#include "arena.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+static constexpr size_t kChunkAlignment = 64;
+
+static void free_chunks(const std::vector<Arena::Chunk>& chunks) {
+    for (auto& chunk : chunks) {
+        ::operator delete(chunk.base, std::align_val_t(kChunkAlignment));
+    }
+}
+
+// whether p was carved from one of chunks (an empty allocation may sit at the very end)
+static bool owns(const std::vector<Arena::Chunk>& chunks, const void* p) {
+    auto address = reinterpret_cast<std::uintptr_t>(p);
+    for (auto& chunk : chunks) {
+        auto base = reinterpret_cast<std::uintptr_t>(chunk.base);
+        if (address >= base && address <= base + chunk.size) return true;
+    }
+    return false;
+}
+
+Arena::Arena(size_t chunk_size_) : chunk_size(chunk_size_) {}
+
+Arena::~Arena() {
+    if (live_allocations() != 0) {
+        // the remaining tensors would free into a destroyed resource - fail here instead
+        LOG_ERROR("[Arena] destroyed with " << live_allocations()
+                  << " live allocations: a tensor outlived its Graph");
+        std::abort();
+    }
+    free_chunks(chunks);
+}
+
+void Arena::reset() {
+    if (live == 0) {
+        rewind();
+        return;
+    }
+    if (!rewind_pending) {
+        // something from this step is still referenced (usually the loop's loss and output,
+        // released right after) - rewind as soon as it is returned
+        rewind_pending = true;
+        return;
+    }
+
+    // allocations survived a whole step: their chunks are freed once the last of them is
+    // released, and the next step starts over in new chunks instead of waiting forever
+    LOG_DEBUG("[Arena] retiring " << chunks.size() << " chunks with " << live << " live allocations");
+    retired.push_back({std::move(chunks), live});
+    chunks.clear();
+    current = 0;
+    offset = 0;
+    live = 0;
+    rewind_pending = false;
+}
+
+size_t Arena::bytes_reserved() const {
+    size_t total = 0;
+    for (auto& chunk : chunks) total += chunk.size;
+    for (auto& step : retired) {
+        for (auto& chunk : step.chunks) total += chunk.size;
+    }
+    return total;
+}
+
+size_t Arena::live_allocations() const {
+    size_t total = live;
+    for (auto& step : retired) total += step.live;
+    return total;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    while (current < chunks.size()) {
+        Chunk& chunk = chunks[current];
+        std::uintptr_t base = reinterpret_cast<std::uintptr_t>(chunk.base);
+        std::uintptr_t start = (base + offset + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+
+        if (start + bytes <= base + chunk.size) {
+            offset = start + bytes - base;
+            ++live;
+            return reinterpret_cast<void*>(start);
+        }
+
+        // current chunk exhausted - continue in the next one (if any)
+        ++current;
+        offset = 0;
+    }
+
+    // out of chunks: grow by one chunk large enough for this request
+    size_t size = std::max(chunk_size, bytes + alignment);
+    char* base = static_cast<char*>(::operator new(size, std::align_val_t(kChunkAlignment)));
+    chunks.push_back({base, size});
+    current = chunks.size() - 1;
+    offset = 0;
+    return do_allocate(bytes, alignment);
+}
+
+void Arena::do_deallocate(void* p, size_t, size_t) {
+    if (retired.empty() || owns(chunks, p)) {
+        if (--live == 0 && rewind_pending) rewind();
+        return;
+    }
+    for (auto it = retired.begin(); it != retired.end(); ++it) {
+        if (!owns(it->chunks, p)) continue;
+        if (--it->live == 0) {
+            free_chunks(it->chunks);
+            retired.erase(it);
+        }
+        return;
+    }
+}
+
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void Arena::rewind() {
+    if (chunks.size() > 1) {
+        // coalesce: one chunk sized for the whole step avoids re-growing next iteration
+        size_t total = 0;
+        for (auto& chunk : chunks) total += chunk.size;
+        free_chunks(chunks);
+        chunks.clear();
+        chunks.push_back({static_cast<char*>(::operator new(total, std::align_val_t(kChunkAlignment))), total});
+    }
+    current = 0;
+    offset = 0;
+    rewind_pending = false;
+}
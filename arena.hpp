@@ -0,0 +1,69 @@
+/*
+ * arena.hpp - bump allocator for per-iteration graph memory
+ *
+ * this allocator hands out memory for everything one training step creates:
+ * - intermediate tensors, their data/grad buffers and the operations linking them
+ * - allocation is a pointer bump inside a large chunk (no malloc per tensor)
+ * - the whole region is released in O(1) by rewinding, and the chunks are reused next step
+ *
+ * tensors that outlive graph.clear() (e.g. the loss held by the training loop) stay valid:
+ * - the rewind is deferred until the last of them is destroyed
+ * - if they are still alive at the next reset(), their chunks are retired instead (freed when
+ *   the last allocation in them is returned) and the arena continues in fresh chunks, so a
+ *   retained tensor pins only the steps it came from rather than growing the arena forever
+ *
+ * IMPORTANT: every allocation must be returned before the arena is destroyed (tensors of a Graph
+ * must not outlive the Graph); the destructor aborts otherwise instead of leaving them dangling
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+class Arena : public std::pmr::memory_resource {
+public:
+    // chunk_size is the minimum size of each block requested from the system
+    explicit Arena(size_t chunk_size = 1 << 20);
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // release everything allocated since the last reset
+    // rewinds immediately if nothing is alive, otherwise once it is (see above)
+    void reset();
+
+    // one block requested from the system
+    struct Chunk {
+        char* base;
+        size_t size;
+    };
+
+    // introspection for debugging and memory tuning
+    size_t bytes_reserved() const;     // total size of chunks owned by the arena (retired included)
+    size_t live_allocations() const;   // allocations handed out and not yet returned
+
+private:
+    // chunks of an earlier step that still hold live allocations
+    struct Retired {
+        std::vector<Chunk> chunks;
+        size_t live;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    // move the bump pointer back to the start of the first chunk
+    // chunks grown during the last step are merged into one so steady state needs no new chunks
+    void rewind();
+
+    size_t chunk_size;
+    std::vector<Chunk> chunks;
+    size_t current = 0;         // index of the chunk being bumped
+    size_t offset = 0;          // bump offset inside chunks[current]
+    size_t live = 0;            // allocations from chunks not yet returned
+    bool rewind_pending = false;  // reset() found live allocations, rewind when they are gone
+    std::vector<Retired> retired;
+};
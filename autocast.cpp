@@ -0,0 +1,16 @@
+/*
+ * autocast.cpp - thread-local compute precision state
+ */
+
+#include "autocast.hpp"
+
+// full precision by default in every thread
+static thread_local DType autocast_dtype = DType::Float32;
+
+DType Autocast::dtype() {
+    return autocast_dtype;
+}
+
+void Autocast::set_dtype(DType dtype) {
+    autocast_dtype = dtype;
+}
@@ -0,0 +1,42 @@
+/*
+ * autocast.hpp - thread-local compute precision for mixed-precision training
+ *
+ * inside an AutocastGuard the matmul-heavy ops run on 16-bit operands:
+ * - linear() casts its input and weight to the autocast dtype (a differentiable cast, so the
+ *   float32 master weights still receive float32 gradients) and writes a 16-bit output
+ * - element-wise ops and losses keep widening to float32 on entry (ops/cast.hpp), so a loss
+ *   computed from a 16-bit activation is float32
+ * - gradients are always float32; pair this with optimizer/loss_scaler.hpp to skip steps whose
+ *   gradients overflowed
+ *
+ * usage:
+ *     {
+ *         AutocastGuard autocast(DType::BFloat16);
+ *         output = model->forward(x);
+ *     }
+ *
+ * IMPORTANT: the flag is per thread like GradMode; Float32 (the default) means no autocast
+ */
+
+#pragma once
+#include "dtype.hpp"
+
+class Autocast {
+public:
+    // dtype linear() computes in on this thread, Float32 when autocast is off
+    static DType dtype();
+    static void set_dtype(DType dtype);
+};
+
+// scoped autocast, restoring the previous dtype on destruction (guards nest)
+class AutocastGuard {
+public:
+    explicit AutocastGuard(DType dtype) : previous(Autocast::dtype()) { Autocast::set_dtype(dtype); }
+    ~AutocastGuard() { Autocast::set_dtype(previous); }
+
+    AutocastGuard(const AutocastGuard&) = delete;
+    AutocastGuard& operator=(const AutocastGuard&) = delete;
+
+private:
+    DType previous;
+};
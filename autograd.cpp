@@ -0,0 +1,112 @@
+/*
+ * autograd.cpp - reverse-mode automatic differentiation engine implementation
+ *
+ * the traversal is an explicit-stack depth first search over creator->inputs links:
+ * - post-order gives a forward (inputs before outputs) ordering of the graph
+ * - reversing it gives the order in which gradients are complete and can be propagated
+ *
+ * IMPORTANT: a tensor consumed by several operations (e.g. x * x)
+ * receives all of its gradient contributions before its own creator is visited
+ */
+
+#include "autograd.hpp"
+#include "tensor.hpp"
+#include "op.hpp"
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+
+std::vector<std::shared_ptr<Tensor>> backward_order(const std::shared_ptr<Tensor>& root) {
+    std::vector<std::shared_ptr<Tensor>> order;
+    std::unordered_set<const Tensor*> visited;
+
+    // each stack frame is a tensor plus the index of the next creator input to explore
+    std::vector<std::pair<std::shared_ptr<Tensor>, size_t>> stack;
+    stack.emplace_back(root, 0);
+    visited.insert(root.get());
+
+    while (!stack.empty()) {
+        auto& frame = stack.back();
+        auto creator = frame.first->creator.lock();
+
+        if (creator && frame.second < creator->inputs.size()) {
+            auto input = creator->inputs[frame.second++].lock();
+            if (input && visited.insert(input.get()).second) {
+                stack.emplace_back(input, 0);
+            }
+            continue;
+        }
+
+        // all inputs explored - emit in post-order (inputs before outputs)
+        order.push_back(frame.first);
+        stack.pop_back();
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+// walks order (backward order) inputs-first and decides which tensors lead to a wanted leaf,
+// recording the answer per op input in the op's input_grad_mask
+// wanted(leaf) says whether a leaf (or any explicitly listed tensor) wants its gradient
+template <typename WantedFn>
+static std::unordered_set<const Tensor*> prune(const std::vector<std::shared_ptr<Tensor>>& order,
+                                               WantedFn&& wanted) {
+    std::unordered_set<const Tensor*> needed;
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        const Tensor* tensor = it->get();
+        bool need = wanted(*tensor);
+
+        if (auto creator = tensor->creator.lock()) {
+            creator->input_grad_mask = 0;
+            for (size_t i = 0; i < creator->inputs.size(); ++i) {
+                auto input = creator->inputs[i].lock();
+                if (input && needed.count(input.get())) {
+                    if (i < 64) creator->input_grad_mask |= uint64_t(1) << i;
+                    need = true;
+                }
+            }
+            // inputs past the mask width are always computed (needs_input_grad)
+            if (creator->inputs.size() > 64) need = true;
+        }
+
+        if (need) needed.insert(tensor);
+    }
+    return needed;
+}
+
+static void propagate(const std::vector<std::shared_ptr<Tensor>>& order,
+                      const std::unordered_set<const Tensor*>& needed) {
+    for (auto& tensor : order) {
+        auto creator = tensor->creator.lock();
+
+        // leaves (inputs and parameters) have no creator and nothing to propagate
+        // tensors that received no gradient or lead to no wanted leaf contribute nothing either
+        if (!creator || tensor->grad.empty() || !needed.count(tensor.get())) continue;
+
+        ProfileScope profile(creator->name(), "backward");
+        creator->backward(*tensor);
+    }
+}
+
+void run_backward(const std::shared_ptr<Tensor>& root) {
+    auto order = backward_order(root);
+    auto needed = prune(order, [](const Tensor& t) {
+        return t.creator.expired() && t.requires_grad;
+    });
+    propagate(order, needed);
+}
+
+void run_backward(const std::shared_ptr<Tensor>& root, const std::vector<std::shared_ptr<Tensor>>& leaves) {
+    std::unordered_set<const Tensor*> wanted;
+    for (auto& leaf : leaves) {
+        if (leaf && leaf->requires_grad) wanted.insert(leaf.get());
+    }
+
+    auto order = backward_order(root);
+    auto needed = prune(order, [&wanted](const Tensor& t) { return wanted.count(&t) > 0; });
+    propagate(order, needed);
+}
@@ -0,0 +1,31 @@
+/*
+ * autograd.hpp - reverse-mode automatic differentiation engine
+ *
+ * this engine drives backpropagation for the whole computational graph:
+ * - builds a reverse topological order of the graph once, starting from the root tensor
+ * - visits every tensor only after all of its consumers have contributed their gradients
+ * - calls each operation's backward() exactly once, iteratively (no stack recursion)
+ * - prunes everything that leads to no leaf wanting a gradient: those ops are never called and
+ *   the surviving ops skip the kernels of pruned inputs (Op::input_grad_mask)
+ *
+ * IMPORTANT: operations only compute local gradients w.r.t. their direct inputs
+ * walking the graph is the engine's job, never the operation's
+ */
+
+#pragma once
+#include <memory>
+#include <vector>
+
+class Tensor;
+
+// collects every tensor reachable from root through creator links
+// the result is in backward order: each tensor appears before all the tensors it was computed from
+std::vector<std::shared_ptr<Tensor>> backward_order(const std::shared_ptr<Tensor>& root);
+
+// runs backpropagation from root, whose gradient buffer must already be seeded
+// gradients are accumulated (+=) into every reachable tensor that requires grad
+void run_backward(const std::shared_ptr<Tensor>& root);
+
+// same, but only the given tensors (usually the parameters) receive gradients:
+// any other leaf, e.g. an input created with requires_grad, is treated as a constant
+void run_backward(const std::shared_ptr<Tensor>& root, const std::vector<std::shared_ptr<Tensor>>& leaves);
@@ -0,0 +1,79 @@
+/*
+ * capture.cpp - captured training step implementation
+ *
+ * replay mirrors what a fresh step would do, minus the allocations:
+ * forward ops recompute in capture order, intermediate gradients are zeroed, the loss is
+ * seeded with 1 and each op's backward runs once in the recorded reverse topological order
+ */
+
+#include "capture.hpp"
+#include "autograd.hpp"
+#include "grad_mode.hpp"
+#include "profiler.hpp"
+#include "ops/elementwise.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// copies src element by element into the packed buffer of dst (same shape)
+static void copy_into(const Tensor& src, Tensor& dst) {
+    float* out = dst.data().data();
+    for_each_element(src, [out](size_t i, float v) { out[i] = v; });
+}
+
+CapturedStep::CapturedStep(std::shared_ptr<Module> model_, const Tensor& example_input,
+                           const Tensor& example_target, LossFn loss_fn)
+    : model(std::move(model_)) {
+    if (!GradMode::is_enabled()) {
+        throw std::runtime_error("CapturedStep: cannot capture a training step under NoGradGuard");
+    }
+
+    // everything created while recording belongs to this step's graph
+    GraphScope scope(graph);
+
+    // captured input/target buffers - every replay copies its batch in here
+    input = std::make_shared<Tensor>(example_input.shape);
+    target = std::make_shared<Tensor>(example_target.shape);
+    copy_into(example_input, *input);
+    copy_into(example_target, *target);
+
+    prediction_tensor = model->forward(input);
+    loss_tensor = loss_fn(prediction_tensor, target);
+    if (!loss_tensor->requires_grad) {
+        throw std::runtime_error("CapturedStep: loss does not depend on any parameter");
+    }
+    loss_tensor->backward();
+
+    // the plan: every op output reachable from the loss, in the order backward just used
+    for (auto& tensor : backward_order(loss_tensor)) {
+        if (auto op = tensor->creator.lock()) steps.push_back({op, tensor});
+    }
+}
+
+const std::shared_ptr<Tensor>& CapturedStep::replay(const Tensor& batch_input, const Tensor& batch_target) {
+    if (batch_input.shape != input->shape || batch_target.shape != target->shape) {
+        throw std::runtime_error("CapturedStep::replay: batch shapes differ from the captured step");
+    }
+    copy_into(batch_input, *input);
+    copy_into(batch_target, *target);
+
+    // forward: inputs before outputs
+    for (auto it = steps.rbegin(); it != steps.rend(); ++it) {
+        ProfileScope profile(it->op->name(), "forward");
+        it->op->recompute(*it->output);
+    }
+
+    // backward: intermediate gradients start from zero, the loss from 1
+    for (auto& step : steps) {
+        std::fill(step.output->grad.begin(), step.output->grad.end(), 0.0f);
+    }
+    std::fill(loss_tensor->grad.begin(), loss_tensor->grad.end(), 1.0f);
+
+    for (auto& step : steps) {
+        // same skip rule as run_backward: no gradient reached this tensor
+        if (step.output->grad.empty()) continue;
+        ProfileScope profile(step.op->name(), "backward");
+        step.op->backward(*step.output);
+    }
+
+    return loss_tensor;
+}
@@ -0,0 +1,75 @@
+/*
+ * capture.hpp - captured training steps with allocation-free replay
+ *
+ * models with fixed shapes (e.g. a Sequential of Linear/ReLU) build the exact same graph every
+ * step, so rebuilding it each epoch only costs allocations. a CapturedStep records one
+ * forward + loss + backward into a static plan and re-runs it on new data:
+ * - the plan is the list of (op, output) pairs in backward order, reversed for the forward pass
+ * - every intermediate tensor and gradient buffer from the capture is kept and written in place
+ * - replay() copies the new batch into the captured input/target buffers, recomputes each op
+ *   (Op::recompute), then backpropagates through the stored order - no heap allocations
+ *
+ * usage:
+ *     CapturedStep step(model, *x, *target);         // first step, gradients accumulated
+ *     optimizer.step(model->parameters());
+ *     for (...) {
+ *         model->zero_grad();
+ *         auto& loss = step.replay(*x, *target);       // same buffers every call
+ *         optimizer.step(model->parameters());
+ *     }
+ *
+ * IMPORTANT:
+ * - the capture itself is a real training step: parameter gradients accumulate as in backward()
+ * - only values derived from parameters, the input or the target are recomputed; anything the
+ *   model computes from other tensors is frozen at its captured value
+ * - tensors from the plan (loss(), prediction()) live in the step's own graph and must not
+ *   outlive the CapturedStep
+ */
+
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include "graph.hpp"
+#include "src/module.hpp"
+#include "ops/mse.hpp"
+
+class CapturedStep {
+public:
+    using LossFn = std::function<std::shared_ptr<Tensor>(const std::shared_ptr<Tensor>&,
+                                                         const std::shared_ptr<Tensor>&)>;
+
+    // runs one forward + loss + backward of model on the example batch and records it
+    // the input and target shapes are fixed from here on
+    CapturedStep(std::shared_ptr<Module> model, const Tensor& example_input,
+                 const Tensor& example_target, LossFn loss_fn = mse_loss);
+
+    CapturedStep(const CapturedStep&) = delete;
+    CapturedStep& operator=(const CapturedStep&) = delete;
+
+    // re-runs the captured step on a new batch of the captured shapes
+    // returns the loss tensor, which is the same object on every call
+    const std::shared_ptr<Tensor>& replay(const Tensor& input, const Tensor& target);
+
+    // loss and model output of the most recent capture or replay
+    const std::shared_ptr<Tensor>& loss() const { return loss_tensor; }
+    const std::shared_ptr<Tensor>& prediction() const { return prediction_tensor; }
+
+private:
+    struct Step {
+        std::shared_ptr<Op> op;
+        std::shared_ptr<Tensor> output;
+    };
+
+    // owns every tensor and op of the plan - declared first so it is destroyed last
+    Graph graph;
+    std::shared_ptr<Module> model;  // keeps the parameters alive
+
+    std::shared_ptr<Tensor> input;
+    std::shared_ptr<Tensor> target;
+    std::shared_ptr<Tensor> prediction_tensor;
+    std::shared_ptr<Tensor> loss_tensor;
+
+    // op outputs in backward order (autograd.hpp); the forward pass walks it in reverse
+    std::vector<Step> steps;
+};
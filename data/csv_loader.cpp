@@ -1,20 +1,23 @@
 #include "csv_loader.hpp"
 #include <fstream>
 #include <sstream>
-#include <iostream>
+#include "../logging.hpp"
+#include "../profiler.hpp"
 #include <cmath> // For std::isnan, std::isinf
 
 std::vector<std::vector<double>> load_csv(const std::string& filename) {
+    ProfileScope profile("load_csv", "data");
+
     std::ifstream file(filename);
     std::vector<std::vector<double>> data;
     std::string line;
 
     if (!file.is_open()) {
-        std::cerr << "Error: Could not open file: " << filename << std::endl;
+        LOG_ERROR("Error: Could not open file: " << filename);
         return data;
     }
 
-    std::cout << "Successfully opened file: " << filename << std::endl;
+    LOG_INFO("Successfully opened file: " << filename);
     std::getline(file, line); // Skip header
 
     int line_num = 1; // for error messages
@@ -32,13 +35,13 @@ std::vector<std::vector<double>> load_csv(const std::string& filename) {
             try {
                 double val = std::stod(cell);
                 if (std::isnan(val) || std::isinf(val)) {
-                    std::cerr << "Invalid value (NaN or Inf) at line " << line_num << ": " << val << std::endl;
+                    LOG_WARN("Invalid value (NaN or Inf) at line " << line_num << ": " << val);
                     invalid_row = true;
                     break;
                 }
                 row.push_back(val);
             } catch (const std::exception& e) {
-                std::cerr << "Conversion error at line " << line_num << ": " << e.what() << std::endl;
+                LOG_WARN("Conversion error at line " << line_num << ": " << e.what());
                 invalid_row = true;
                 break;
             }
@@ -48,14 +51,14 @@ std::vector<std::vector<double>> load_csv(const std::string& filename) {
             if (column_count == 10) {  // Exactly 10 columns expected
                 data.push_back(row);
             } else {
-                std::cerr << "Warning: Skipping line " << line_num
-                          << " due to unexpected number of columns: "
-                          << column_count << std::endl;
+                LOG_WARN("Warning: Skipping line " << line_num
+                         << " due to unexpected number of columns: "
+                         << column_count);
             }
         }
     }
 
-    std::cout << "Loaded " << data.size() << " rows from CSV" << std::endl;
+    LOG_INFO("Loaded " << data.size() << " rows from CSV");
     return data;
 }
 
@@ -0,0 +1,100 @@
+/*
+ * dtype.hpp - element types of tensor storage and their scalar conversions
+ *
+ * every computation runs and accumulates in float32, but storage can hold 16-bit elements:
+ * - bfloat16: the top half of a float32 (same range, 8 significant bits), good for weights
+ *   and activations that only need to survive until the next fp32 kernel reads them
+ * - float16: ieee half precision (11 significant bits, max 65504)
+ * half-precision storage halves the bytes a memory-bound kernel streams and the size of
+ * parameters kept around for inference
+ *
+ * the scalar conversions below are the reference the vector kernels of ops/simd.hpp match
+ * bit for bit: round to nearest even, overflow to infinity, nans stay (quiet) nans
+ *
+ * IMPORTANT: gradients are always float32, whatever the dtype of the tensor
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+enum class DType {
+    Float32,
+    BFloat16,
+    Float16,
+};
+
+inline const char* dtype_name(DType dtype) {
+    switch (dtype) {
+    case DType::Float32: return "float32";
+    case DType::BFloat16: return "bfloat16";
+    case DType::Float16: return "float16";
+    }
+    return "unknown";
+}
+
+// bytes per element
+inline size_t dtype_size(DType dtype) {
+    return dtype == DType::Float32 ? 4 : 2;
+}
+
+inline uint32_t float_bits(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof x);
+    return x;
+}
+
+inline float bits_float(uint32_t x) {
+    float f;
+    std::memcpy(&f, &x, sizeof f);
+    return f;
+}
+
+inline float bf16_to_float(uint16_t h) {
+    return bits_float(static_cast<uint32_t>(h) << 16);
+}
+
+inline uint16_t float_to_bf16(float f) {
+    const uint32_t x = float_bits(f);
+    if ((x & 0x7fffffffu) > 0x7f800000u) return static_cast<uint16_t>((x >> 16) | 0x40u);  // quiet nan
+    return static_cast<uint16_t>((x + 0x7fffu + ((x >> 16) & 1u)) >> 16);
+}
+
+inline float fp16_to_float(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000u) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1fu;
+    const uint32_t mantissa = h & 0x3ffu;
+
+    if (exponent == 0x1f) return bits_float(sign | 0x7f800000u | (mantissa << 13) | (mantissa ? 0x400000u : 0u));
+    if (exponent == 0) {
+        // zero or subnormal: mantissa * 2^-24, exact in float32
+        const float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f;
+        return bits_float(sign | float_bits(magnitude));
+    }
+    return bits_float(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+inline uint16_t float_to_fp16(float f) {
+    const uint32_t x = float_bits(f);
+    const uint16_t sign = static_cast<uint16_t>((x >> 16) & 0x8000u);
+    const uint32_t a = x & 0x7fffffffu;
+
+    if (a > 0x7f800000u) return static_cast<uint16_t>(sign | 0x7e00u | ((a >> 13) & 0x3ffu));  // quiet nan
+    if (a >= 0x477ff000u) return static_cast<uint16_t>(sign | 0x7c00u);  // 65520 and up round to infinity
+    if (a >= 0x38800000u) {
+        // normal: rebias the exponent, round the 13 dropped mantissa bits to nearest even
+        const uint32_t r = a - 0x38000000u;
+        return static_cast<uint16_t>(sign | ((r + 0xfffu + ((r >> 13) & 1u)) >> 13));
+    }
+
+    // subnormal half (or zero): the significand shifted down to units of 2^-24
+    const uint32_t exponent = a >> 23;
+    if (exponent < 102) return sign;
+    const uint32_t significand = (a & 0x7fffffu) | 0x800000u;
+    const uint32_t shift = 126 - exponent;
+    uint32_t m = significand >> shift;
+    const uint32_t rest = significand & ((1u << shift) - 1);
+    const uint32_t half = 1u << (shift - 1);
+    if (rest > half || (rest == half && (m & 1u))) ++m;
+    return static_cast<uint16_t>(sign | m);
+}
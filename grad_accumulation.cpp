@@ -0,0 +1,82 @@
+/*
+ * grad_accumulation.cpp - micro-batch loop of the gradient accumulator
+ *
+ * the whole-batch loss is sum_i (rows_i / rows) * loss_i, so seeding each micro-batch loss
+ * gradient with its row share (times the loss scale) is all the weighting needed
+ */
+
+#include "grad_accumulation.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include "grad_mode.hpp"
+#include "logging.hpp"
+
+// clears the graph when a micro-batch ends, also when forward, loss or backward threw
+// declared before the micro-batch's tensors, so it runs after they are released
+struct GraphClearGuard {
+    Graph& graph;
+    ~GraphClearGuard() { graph.clear(); }
+};
+
+GradientAccumulator::GradientAccumulator(std::shared_ptr<Module> model_, int micro_batch_size, LossFn loss_fn_)
+    : model(std::move(model_)), micro_batch(micro_batch_size), loss_fn(std::move(loss_fn_)) {
+    if (!model) throw std::runtime_error("GradientAccumulator: model is null");
+    if (micro_batch <= 0) throw std::runtime_error("GradientAccumulator: micro-batch size must be positive");
+}
+
+float GradientAccumulator::backward(const std::shared_ptr<Tensor>& input, const std::shared_ptr<Tensor>& target) {
+    return accumulate(input, target, 1.0f);
+}
+
+float GradientAccumulator::backward(const std::shared_ptr<Tensor>& input, const std::shared_ptr<Tensor>& target,
+                                    const DynamicLossScaler& scaler) {
+    return accumulate(input, target, scaler.scale());
+}
+
+float GradientAccumulator::step(Adam& optimizer, const std::shared_ptr<Tensor>& input,
+                                const std::shared_ptr<Tensor>& target) {
+    model->zero_grad();
+    const float loss = accumulate(input, target, 1.0f);
+    optimizer.step(model->parameters());
+    return loss;
+}
+
+float GradientAccumulator::accumulate(const std::shared_ptr<Tensor>& input, const std::shared_ptr<Tensor>& target,
+                                      float seed) {
+    if (!GradMode::is_enabled()) {
+        throw std::runtime_error("GradientAccumulator: cannot accumulate gradients under NoGradGuard");
+    }
+    if (input->shape.empty() || target->shape.empty() || input->shape[0] != target->shape[0]) {
+        throw std::runtime_error("GradientAccumulator: input and target need the same number of rows");
+    }
+
+    const auto params = model->parameters();
+    if (std::none_of(params.begin(), params.end(), [](const auto& p) { return p->requires_grad; })) {
+        throw std::runtime_error("GradientAccumulator: the model has no parameter that requires grad");
+    }
+
+    const int rows = input->shape[0];
+    double batch_loss = 0.0;
+
+    // everything a micro-batch creates belongs to the accumulator's graph
+    GraphScope scope(graph);
+    for (int begin = 0; begin < rows; begin += micro_batch) {
+        const int end = std::min(rows, begin + micro_batch);
+        const float share = static_cast<float>(end - begin) / rows;
+        LOG_TRACE("[GradientAccumulator] micro-batch rows " << begin << ".." << end);
+
+        // the micro-batch's tensors are released before the clear, so it also rewinds the arena
+        GraphClearGuard clear_graph{graph};
+
+        // the row views are kept here: ops only hold weak references to their inputs
+        auto batch_input = input->slice(begin, end);
+        auto batch_target = target->slice(begin, end);
+        auto loss = loss_fn(model->forward(batch_input), batch_target);
+        batch_loss += static_cast<double>(share) * loss->data()[0];
+
+        // Tensor::backward only seeds a loss gradient of 1 when there is none yet
+        loss->grad.assign(loss->numel(), share * seed);
+        loss->backward(params);
+    }
+    return static_cast<float>(batch_loss);
+}
@@ -0,0 +1,67 @@
+/*
+ * grad_accumulation.hpp - gradient accumulation over micro-batches
+ *
+ * a full-batch step keeps every activation of the whole batch alive until backward, so peak
+ * memory grows with the batch. a GradientAccumulator walks the batch in row ranges instead:
+ * - each micro-batch is a zero-copy row slice of input and target (Tensor::slice)
+ * - forward + loss + backward of one micro-batch record into the accumulator's own graph,
+ *   which is cleared before the next one, so only one micro-batch of activations is ever live
+ * - the loss gradient of micro-batch i is seeded with rows_i / rows instead of 1, so parameter
+ *   gradients add up to exactly the gradient of the full-batch mean loss
+ * - step() then runs a single optimizer update, as a full-batch step would
+ *
+ * usage:
+ *     GradientAccumulator accumulator(model, 1024);
+ *     for (...) {
+ *         float loss = accumulator.step(optimizer, x, target);
+ *     }
+ *
+ * IMPORTANT:
+ * - the loss must be a mean over rows (mse/mae/huber are) for the weighting to be exact
+ * - gradients are added to what the parameters already hold; backward() does not zero them
+ * - only the model parameters receive gradients (the input never does)
+ * - tensors made by loss_fn are released between micro-batches and must not be kept
+ */
+
+#pragma once
+#include <functional>
+#include <memory>
+#include "graph.hpp"
+#include "src/module.hpp"
+#include "ops/mse.hpp"
+#include "optimizer/adam.hpp"
+#include "optimizer/loss_scaler.hpp"
+
+class GradientAccumulator {
+public:
+    using LossFn = std::function<std::shared_ptr<Tensor>(const std::shared_ptr<Tensor>&,
+                                                         const std::shared_ptr<Tensor>&)>;
+
+    // micro_batch_size rows per forward/backward; loss_fn(prediction, target) scores each one
+    GradientAccumulator(std::shared_ptr<Module> model, int micro_batch_size, LossFn loss_fn = mse_loss);
+
+    GradientAccumulator(const GradientAccumulator&) = delete;
+    GradientAccumulator& operator=(const GradientAccumulator&) = delete;
+
+    // adds the gradient of the whole-batch loss to the parameters, one micro-batch at a time
+    // returns the whole-batch loss
+    float backward(const std::shared_ptr<Tensor>& input, const std::shared_ptr<Tensor>& target);
+
+    // same, with the loss gradient scaled by scaler.scale() (mixed precision, loss_scaler.hpp)
+    float backward(const std::shared_ptr<Tensor>& input, const std::shared_ptr<Tensor>& target,
+                   const DynamicLossScaler& scaler);
+
+    // zero_grad, backward() and one optimizer step over the whole batch
+    float step(Adam& optimizer, const std::shared_ptr<Tensor>& input, const std::shared_ptr<Tensor>& target);
+
+    int micro_batch_size() const { return micro_batch; }
+
+private:
+    float accumulate(const std::shared_ptr<Tensor>& input, const std::shared_ptr<Tensor>& target, float seed);
+
+    // records one micro-batch at a time - declared first so it is destroyed last
+    Graph graph;
+    std::shared_ptr<Module> model;
+    int micro_batch;
+    LossFn loss_fn;
+};
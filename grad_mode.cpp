@@ -0,0 +1,16 @@
+/*
+ * grad_mode.cpp - thread-local gradient tracking state
+ */
+
+#include "grad_mode.hpp"
+
+// gradient tracking is on by default in every thread
+static thread_local bool grad_enabled = true;
+
+bool GradMode::is_enabled() {
+    return grad_enabled;
+}
+
+void GradMode::set_enabled(bool enabled) {
+    grad_enabled = enabled;
+}
@@ -0,0 +1,56 @@
+/*
+ * grad_mode.hpp - thread-local switch for gradient tracking
+ *
+ * lets inference code run the exact same forward functions without autograd overhead:
+ * - while gradient mode is disabled, ops produce plain tensors (requires_grad = false)
+ * - no Op is constructed, no creator is set, nothing is registered with the graph
+ * - result tensors come from the heap, not the graph arena, since no step bounds their lifetime
+ *
+ * usage (inference / scoring path):
+ *     {
+ *         NoGradGuard no_grad;
+ *         auto prediction = model->forward(x);
+ *     }
+ *
+ * IMPORTANT: the flag is per thread, a guard in one thread never affects training in another
+ */
+
+#pragma once
+
+class GradMode {
+public:
+    // whether ops on this thread currently record themselves for backpropagation
+    static bool is_enabled();
+    static void set_enabled(bool enabled);
+
+    // requires_grad for an op result: inputs need grad and recording is switched on
+    static bool track(bool inputs_require_grad) { return inputs_require_grad && is_enabled(); }
+};
+
+// scoped inference mode: disables gradient tracking until the guard goes out of scope
+// guards nest - the previous mode is restored on destruction
+class NoGradGuard {
+public:
+    NoGradGuard() : previous(GradMode::is_enabled()) { GradMode::set_enabled(false); }
+    ~NoGradGuard() { GradMode::set_enabled(previous); }
+
+    NoGradGuard(const NoGradGuard&) = delete;
+    NoGradGuard& operator=(const NoGradGuard&) = delete;
+
+private:
+    bool previous;
+};
+
+// scoped opposite of NoGradGuard: re-enables tracking inside an inference scope
+// (e.g. recomputing a checkpointed segment during backward)
+class EnableGradGuard {
+public:
+    EnableGradGuard() : previous(GradMode::is_enabled()) { GradMode::set_enabled(true); }
+    ~EnableGradGuard() { GradMode::set_enabled(previous); }
+
+    EnableGradGuard(const EnableGradGuard&) = delete;
+    EnableGradGuard& operator=(const EnableGradGuard&) = delete;
+
+private:
+    bool previous;
+};
@@ -0,0 +1,24 @@
+/*
+ * graph.cpp - per-thread graph context
+ */
+
+#include "graph.hpp"
+
+// innermost graph made current by a GraphScope on this thread (null when none is active)
+static thread_local Graph* active_graph = nullptr;
+
+Graph& current_graph() {
+    if (active_graph) return *active_graph;
+
+    // created lazily on first use and destroyed when the thread exits
+    static thread_local Graph default_graph;
+    return default_graph;
+}
+
+GraphScope::GraphScope(Graph& graph) : previous(active_graph) {
+    active_graph = &graph;
+}
+
+GraphScope::~GraphScope() {
+    active_graph = previous;
+}
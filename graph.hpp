@@ -6,16 +6,48 @@
  * IMPORTANT: tensors and operations are created during forward pass
  * but must remain alive until after backward pass and optimizer step
  * this prevents the "dangling pointer" problem in automatic differentiation
+ *
+ * graph tensors and operations are carved from the graph's arena (arena.hpp)
+ * so one step costs a few pointer bumps instead of dozens of heap allocations
+ *
+ * ops never name a graph directly, they record into current_graph():
+ * - every thread has its own default graph, so concurrent passes never share vectors
+ * - GraphScope makes an explicit Graph current for a scope (scopes nest)
+ *
+ * usage (validation scoring in a second thread):
+ *     Graph eval_graph;
+ *     float score;
+ *     {
+ *         GraphScope scope(eval_graph);
+ *         auto loss = mse_loss(model->forward(x), y);
+ *         score = loss->data()[0];   // copy out what is needed, the tensors stay with the graph
+ *     }
+ *     eval_graph.clear();
+ *
+ * IMPORTANT: a Graph (and the tensors it created) must only be used by one thread at a time,
+ * and those tensors must be released before the Graph is destroyed (arena.hpp)
  */
 
 #pragma once
 #include <vector>
 #include <memory>
+#include <memory_resource>
+#include <utility>
 #include "tensor.hpp"
 #include "op.hpp"
+#include "arena.hpp"
+#include "memory.hpp"
 
 // manages strong ownership of tensors and operations in the computation graph
 class Graph {
+    // backing memory for every tensor and operation created through make_tensor/make_op
+    // declared first so it is destroyed last, after the references below are dropped
+    Arena arena;
+
+    // arena views that count tensor buffers as activations / gradients (memory.hpp)
+    TrackedResource activations{&arena, MemoryCategory::Activation};
+    TrackedResource gradients{&arena, MemoryCategory::Gradient};
+
 public:
     // store shared_ptrs to keep alive all tensors and operations created during forward pass
     // these references prevent premature destruction of intermediate computation results
@@ -32,10 +64,59 @@ public:
         ops.push_back(op);
     }
 
+    // create an op result tensor
+    // tensors that join the graph (requires_grad) live in the arena together with their buffers,
+    // plain tensors go to the heap since nothing bounds their lifetime to this step
+    std::shared_ptr<Tensor> make_tensor(std::vector<int> shape, bool requires_grad, DType dtype = DType::Float32) {
+        if (!requires_grad) {
+            return std::make_shared<Tensor>(std::move(shape), false, tracked_heap(MemoryCategory::Activation),
+                                            tracked_heap(MemoryCategory::Gradient), dtype);
+        }
+        return std::allocate_shared<Tensor>(std::pmr::polymorphic_allocator<Tensor>(&arena),
+                                            std::move(shape), true, &activations, &gradients, dtype);
+    }
+
+    // create a view tensor sharing an existing storage, placed like make_tensor
+    std::shared_ptr<Tensor> make_view(const std::shared_ptr<Storage>& storage, std::vector<int> shape,
+                                      std::vector<int> strides, size_t offset, bool requires_grad) {
+        if (!requires_grad) {
+            return std::make_shared<Tensor>(storage, std::move(shape), std::move(strides), offset, false);
+        }
+        return std::allocate_shared<Tensor>(std::pmr::polymorphic_allocator<Tensor>(&arena), storage,
+                                            std::move(shape), std::move(strides), offset, true, &gradients);
+    }
+
+    // create an operation in the arena
+    template <typename OpType, typename... Args>
+    std::shared_ptr<OpType> make_op(Args&&... args) {
+        return std::allocate_shared<OpType>(std::pmr::polymorphic_allocator<OpType>(&arena),
+                                            std::forward<Args>(args)...);
+    }
+
     // clear all references to allow destruction and free memory
     // called after optimizer step to prevent memory accumulation across epochs
+    // the arena is rewound in O(1) once the last tensor of this step is released
     void clear() {
         tensors.clear();
         ops.clear();
+        arena.reset();
     }
 };
+
+// graph the calling thread currently records into:
+// the innermost active GraphScope, or this thread's own default graph
+Graph& current_graph();
+
+// makes graph the current graph of this thread until the scope ends
+// scopes nest - the previously current graph is restored on destruction
+class GraphScope {
+public:
+    explicit GraphScope(Graph& graph);
+    ~GraphScope();
+
+    GraphScope(const GraphScope&) = delete;
+    GraphScope& operator=(const GraphScope&) = delete;
+
+private:
+    Graph* previous;
+};
@@ -3,16 +3,17 @@
  * 
  * this header defines the linear transformation layer which is fundamental to neural networks:
  * - parameter management: weights and biases are trainable parameters
- * - forward computation: y = xW + b with matrix multiplication and bias addition
+ * - forward computation: y = xW + b, optionally followed by relu, as one fused LinearOp
  * - computational graph integration: creates operations for automatic differentiation
  * 
  * IMPORTANT design insight: weights and biases are initialized as trainable parameters
- * the forward pass creates matmul and add operations to maintain gradient flow
+ * the forward pass creates a single linear op (ops/linear_op.hpp) and a single output tensor
  */
 
 #pragma once
 
 #include "src/module.hpp"
+#include "ops/linear_op.hpp"
 #include <memory>
 #include <vector>
 
@@ -25,15 +26,22 @@ public:
     std::shared_ptr<Tensor> weight;  // input_features × output_features matrix
     std::shared_ptr<Tensor> bias;    // output_features vector
 
+    // activation fused into the layer's output, as given at construction
+    // (Sequential folds a directly following ReLU module in at forward time without touching it)
+    Activation activation;
+
     // constructor initializes weights and biases with proper initialization
     // he initialization prevents vanishing gradients in deep networks
-    Linear(int in_features, int out_features);
+    Linear(int in_features, int out_features, Activation activation = Activation::None);
 
-    // forward pass: computes y = xW + b
+    // forward pass: computes y = activation(xW + b)
     // creates computational graph operations for automatic differentiation
     // input shape: [batch_size, in_features], output shape: [batch_size, out_features]
     std::shared_ptr<Tensor> forward(std::shared_ptr<Tensor> input) override;
 
+    // same with the given activation instead of the layer's own (one fused op either way)
+    std::shared_ptr<Tensor> forward(std::shared_ptr<Tensor> input, Activation fused_activation);
+
     // returns all trainable parameters for optimizer access
     // optimizer needs these to update weights and biases during training
     std::vector<std::shared_ptr<Tensor>> parameters() const override;
@@ -45,4 +53,5 @@ public:
     // store created operations to maintain computational graph
     // note: this is currently unused but provides extensibility for future features
     std::vector<std::shared_ptr<Op>> ops;
+
 };
@@ -0,0 +1,101 @@
+/*
+ * logging.cpp - logger state and the built-in sinks
+ *
+ * the file sink keeps whole lines in a string buffer and hands it to the stream in one write
+ * once it passes kFlushBytes, so a burst of debug lines costs one system call instead of one
+ * per line; the console sink leaves that to std::cout's own buffer, which the program's other
+ * output shares, so log lines stay in order with it
+ */
+
+#include "logging.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+static constexpr size_t kFlushBytes = 1 << 14;
+
+static std::mutex& sink_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::shared_ptr<Sink>& current_sink() {
+    static std::shared_ptr<Sink> sink = std::make_shared<ConsoleSink>();
+    return sink;
+}
+
+// CPPGRAD_LOG_LEVEL picks the runtime level before main() runs
+static bool init_level_from_env() {
+    const char* env = std::getenv("CPPGRAD_LOG_LEVEL");
+    if (!env) return false;
+
+    const std::string name(env);
+    const char* names[] = {"trace", "debug", "info", "warn", "error", "off"};
+    for (int i = 0; i <= static_cast<int>(LogLevel::Off); ++i) {
+        if (name == names[i]) {
+            Logger::set_level(static_cast<LogLevel>(i));
+            return true;
+        }
+    }
+    return false;
+}
+static const bool level_from_env = init_level_from_env();
+
+void Logger::set_sink(std::shared_ptr<Sink> sink) {
+    std::lock_guard<std::mutex> lock(sink_mutex());
+    if (current_sink()) current_sink()->flush();
+    current_sink() = std::move(sink);
+}
+
+void Logger::flush() {
+    std::lock_guard<std::mutex> lock(sink_mutex());
+    if (current_sink()) current_sink()->flush();
+}
+
+void Logger::write(LogLevel level, const std::string& line) {
+    std::lock_guard<std::mutex> lock(sink_mutex());
+    if (current_sink()) current_sink()->write(level, line);
+}
+
+ConsoleSink::~ConsoleSink() {
+    flush();
+}
+
+void ConsoleSink::write(LogLevel level, const std::string& line) {
+    if (level >= LogLevel::Warn) {
+        // std::cerr is tied to std::cout, so pending stdout goes first and the order holds
+        std::cerr << line << '\n';
+        std::cerr.flush();
+        return;
+    }
+
+    // no '\n'-flush per line: std::cout batches trace/debug lines like the rest of stdout
+    std::cout << line << '\n';
+    if (level >= LogLevel::Info) std::cout.flush();
+}
+
+void ConsoleSink::flush() {
+    std::cout.flush();
+}
+
+FileSink::FileSink(const std::string& path) : file(path, std::ios::app) {
+    if (!file) throw std::runtime_error("FileSink: cannot open " + path);
+}
+
+FileSink::~FileSink() {
+    flush();
+}
+
+void FileSink::write(LogLevel level, const std::string& line) {
+    buffer += line;
+    buffer += '\n';
+    if (level >= LogLevel::Info || buffer.size() >= kFlushBytes) flush();
+}
+
+void FileSink::flush() {
+    if (buffer.empty()) return;
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.flush();
+    buffer.clear();
+}
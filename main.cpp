@@ -19,8 +19,15 @@
 #include "ops/mse.hpp"
 #include "model/sequential.hpp"
 #include "optimizer/adam.hpp"
+#include "optimizer/loss_scaler.hpp"
+#include "ops/cast.hpp"
+#include "autocast.hpp"
+#include "grad_accumulation.hpp"
 #include "data/csv_loader.hpp"
-#include "graph.hpp"  
+#include "graph.hpp"
+#include "logging.hpp"
+#include "profiler.hpp"
+#include "memory.hpp"
 
 #include <iostream>
 #include <vector>
@@ -29,10 +36,8 @@
 #include <string>
 #include <iomanip>
 #include <limits>
-
-// global computation graph manager - keeps all tensors and operations alive during training
-// critical for preventing premature destruction of intermediate computation results
-Graph global_graph;  
+#include <cstdlib>
+#include <memory>
 
 // denormalize housing prices back to original dollar amounts for human-readable output
 // normalization range: $14,999 to $500,001 (california housing market extremes)
@@ -70,7 +75,7 @@ void print_gradient_stats(const std::vector<std::shared_ptr<Tensor>>& params) {
     }
     
     if (!has_nonzero_grads) {
-        std::cout << "[WARNING] All gradients are zero! This will prevent learning." << std::endl;
+        LOG_WARN("[WARNING] All gradients are zero! This will prevent learning.");
     }
 }
 
@@ -83,16 +88,43 @@ void track_parameter_changes(const std::vector<std::shared_ptr<Tensor>>& params,
     }
     
     for (size_t i = 0; i < params.size(); ++i) {
-        if (params[i]->data.empty()) continue;
+        if (params[i]->data().empty()) continue;
         
         // store first few values of each parameter
-        for (int j = 0; j < std::min(3, (int)params[i]->data.size()); ++j) {
-            param_history[i].push_back(params[i]->data[j]);
+        for (int j = 0; j < std::min(3, (int)params[i]->data().size()); ++j) {
+            param_history[i].push_back(params[i]->data()[j]);
         }
     }
 }
 
 int main() {
+    // CPPGRAD_PROFILE=trace.json times every op, backward, optimizer step and data load of the run
+    const char* profile_path = std::getenv("CPPGRAD_PROFILE");
+    Profiler::set_enabled(profile_path != nullptr);
+    // CPPGRAD_MEMORY=1 reports live/peak bytes per step and attributes them to ops
+    const bool track_memory = std::getenv("CPPGRAD_MEMORY") != nullptr;
+    MemoryTracker::set_enabled(track_memory);
+    // CPPGRAD_PRECISION=bf16|fp16 trains in mixed precision: 16-bit activations and weight copies,
+    // float32 master weights in adam and dynamic loss scaling
+    const char* precision_env = std::getenv("CPPGRAD_PRECISION");
+    const std::string precision_name = precision_env ? precision_env : "fp32";
+    DType precision = DType::Float32;
+    if (precision_name == "bf16") {
+        precision = DType::BFloat16;
+    } else if (precision_name == "fp16") {
+        precision = DType::Float16;
+    } else if (precision_name != "fp32") {
+        LOG_WARN("unknown CPPGRAD_PRECISION=" << precision_name << ", training in fp32");
+    }
+    const bool mixed_precision = precision != DType::Float32;
+    // CPPGRAD_MICRO_BATCH=N runs every epoch as micro-batches of N rows with accumulated gradients:
+    // the same update as the full batch, with only one micro-batch of activations alive at a time
+    const char* micro_batch_env = std::getenv("CPPGRAD_MICRO_BATCH");
+    const int micro_batch = micro_batch_env ? std::atoi(micro_batch_env) : 0;
+    if (micro_batch_env && micro_batch <= 0) {
+        LOG_WARN("invalid CPPGRAD_MICRO_BATCH=" << micro_batch_env << ", training on the full batch");
+    }
+
     std::cout << "=== Loading CSV data ===" << std::endl;
 
     auto data = load_csv("data/housing_clean.csv");
@@ -136,13 +168,16 @@ int main() {
     const float target_min = 14999.0f;
     const float target_max = 500001.0f;
 
-    // create input and target tensors with proper gradient tracking
-    // input tensor requires gradients for backpropagation, target does not
-    auto x = std::make_shared<Tensor>(std::vector<int>{sample_count, input_dim}, true);
+    // create input and target tensors - neither needs gradients, only the model parameters do
+    // (a tracked input would cost a full input-gradient GEMM in the first layer's backward)
+    auto x = std::make_shared<Tensor>(std::vector<int>{sample_count, input_dim}, false);
     auto target = std::make_shared<Tensor>(std::vector<int>{sample_count, output_dim}, false);
 
-    global_graph.add_tensor(x);
-    global_graph.add_tensor(target);
+    // training records into this thread's graph - keeps all tensors and operations alive
+    // until the optimizer step, then gets cleared for the next epoch
+    Graph& graph = current_graph();
+    graph.add_tensor(x);
+    graph.add_tensor(target);
 
     // normalize all features and targets to [0,1] range for stable training
     // this prevents gradient explosion and ensures consistent learning rates
@@ -150,23 +185,23 @@ int main() {
         for (int j = 0; j < input_dim; ++j) {
             float raw_val = static_cast<float>(features[i][j]);
             float norm_val = (raw_val - feature_mins[j]) / (feature_maxs[j] - feature_mins[j]);
-            x->data[i * input_dim + j] = norm_val;
+            x->data()[i * input_dim + j] = norm_val;
         }
         // normalize target
         float raw_target = static_cast<float>(targets[i][0]);
         float norm_target = (raw_target - target_min) / (target_max - target_min);
-        target->data[i * output_dim + 0] = norm_target;
+        target->data()[i * output_dim + 0] = norm_target;
     }
     
     // validate normalization results
     std::cout << "Normalization validation:" << std::endl;
     std::cout << "First sample normalized features: ";
     for (int j = 0; j < std::min(5, input_dim); ++j) {
-        std::cout << x->data[j] << " ";
+        std::cout << x->data()[j] << " ";
     }
     std::cout << std::endl;
     
-    std::cout << "First sample normalized target: " << target->data[0] << std::endl;
+    std::cout << "First sample normalized target: " << target->data()[0] << std::endl;
     std::cout << "Target range check - min: " << target_min << ", max: " << target_max << std::endl;
 
     std::cout << "=== Building model ===" << std::endl;
@@ -180,9 +215,50 @@ int main() {
     model->add_module(std::make_shared<Linear>(4, output_dim)); // output layer: 4 -> 1
     // no activation on output layer for regression (linear output)
 
+    // all weights in one block and all gradients in another: zero_grad is a single memset and
+    // the optimizer updates the whole model as one span
+    model->flatten_parameters();
+
     // adam optimizer with increased learning rate for faster convergence
     // beta1=0.9, beta2=0.999 provide good momentum and adaptive learning
     Adam optimizer(0.01f);
+    DynamicLossScaler scaler;
+
+    // first predictions of the current epoch, for the progress display
+    std::vector<float> shown_predictions;
+    const size_t shown_count = std::min(5, sample_count);
+
+    // loss of a batch (or micro-batch) of predictions, shared by both training modes
+    auto batch_loss = [&](const std::shared_ptr<Tensor>& prediction, const std::shared_ptr<Tensor>& batch_target) {
+        // the last layer's 16-bit output is widened for the checks and the loss below
+        auto output = as_float32(prediction);
+
+        // clamp output to prevent extreme values that could destabilize training
+        // allows some overflow (up to 2.0) for learning, but prevents nan/inf
+        for (auto& val : output->data()) {
+            if (std::isnan(val) || std::isinf(val)) {
+                val = 0.5f; // default to middle of range if nan/inf
+            } else if (val < -1.0f) {
+                val = -1.0f; // clamp to reasonable range
+            } else if (val > 2.0f) {
+                val = 2.0f; // allow some overflow for learning
+            }
+        }
+
+        // micro-batches arrive in row order, so this keeps the first rows of the whole batch
+        for (int i = 0; shown_predictions.size() < shown_count && i < output->shape[0]; ++i) {
+            shown_predictions.push_back(output->data()[i * output_dim + 0]);
+        }
+
+        // compute mean squared error loss for regression
+        return mse_loss(output, batch_target);
+    };
+
+    std::unique_ptr<GradientAccumulator> accumulator;
+    if (micro_batch > 0) {
+        accumulator = std::make_unique<GradientAccumulator>(model, micro_batch, batch_loss);
+        std::cout << "Accumulating gradients over micro-batches of " << micro_batch << " rows" << std::endl;
+    }
 
     std::cout << "=== Starting training ===" << std::endl;
     
@@ -195,25 +271,36 @@ int main() {
 
     for (int epoch = 0; epoch < 200; ++epoch) {
         std::cout << "\nEpoch " << epoch << std::endl;
+        MemoryTracker::reset_peak();  // peak bytes of this step only
 
         // zero gradients before forward pass to prevent gradient accumulation
         // this is critical for proper backpropagation
         model->zero_grad();
 
-        auto output = model->forward(x);
-        
-        // clamp output to prevent extreme values that could destabilize training
-        // allows some overflow (up to 2.0) for learning, but prevents nan/inf
-        for (auto& val : output->data) {
-            if (std::isnan(val) || std::isinf(val)) {
-                val = 0.5f; // default to middle of range if nan/inf
-            } else if (val < -1.0f) {
-                val = -1.0f; // clamp to reasonable range
-            } else if (val > 2.0f) {
-                val = 2.0f; // allow some overflow for learning
+        shown_predictions.clear();
+
+        // micro-batch mode runs forward, loss and backward of the whole epoch here and keeps
+        // only the loss value; otherwise the full-batch loss tensor is backpropagated below
+        std::shared_ptr<Tensor> loss;
+        float loss_val;
+        if (accumulator) {
+            AutocastGuard autocast(precision);
+            loss_val = mixed_precision ? accumulator->backward(x, target, scaler) : accumulator->backward(x, target);
+        } else {
+            std::shared_ptr<Tensor> prediction;
+            {
+                AutocastGuard autocast(precision);
+                prediction = model->forward(x);
             }
+            loss = batch_loss(prediction, target);
+
+            if (loss->data().empty()) {
+                std::cerr << "Loss data is empty!" << std::endl;
+                break;
+            }
+            loss_val = loss->data()[0];
         }
-        
+
         // display predictions every 10 epochs to monitor training progress
         if (epoch % 10 == 0) {  
             std::cout << "\n--- Predictions vs Targets (first 5 samples) ---" << std::endl;
@@ -221,9 +308,9 @@ int main() {
 
             std::vector<std::pair<float, float>> epoch_records;
 
-            for (int i = 0; i < std::min(5, sample_count); ++i) {
-                float pred_price_norm = output->data[i * output_dim + 0];
-                float target_price_norm = target->data[i * output_dim + 0];
+            for (size_t i = 0; i < shown_predictions.size(); ++i) {
+                float pred_price_norm = shown_predictions[i];
+                float target_price_norm = target->data()[i * output_dim + 0];
 
                 float pred_price = denormalize_price(pred_price_norm);
                 float target_price = denormalize_price(target_price_norm);
@@ -238,15 +325,6 @@ int main() {
             std::cout << "-----------------------------------------------\n" << std::endl;
         }
 
-        // compute mean squared error loss for regression
-        auto loss = mse_loss(output, target);
-
-        if (loss->data.empty()) {
-            std::cerr << "Loss data is empty!" << std::endl;
-            break;
-        }
-
-        float loss_val = loss->data[0];
         std::cout << "Loss: " << loss_val << std::endl;
 
         if (!prediction_history.empty() && epoch % 10 == 0) {
@@ -274,27 +352,37 @@ int main() {
         }
 
         // backpropagate gradients through the computation graph
-        loss->backward();
+        // (mixed precision: scaled by the loss scale, adam unscales them)
+        // (micro-batch mode has already accumulated them, one micro-batch at a time)
+        if (loss && mixed_precision) {
+            scaler.backward(loss);
+        } else if (loss) {
+            loss->backward();
+        }
 
         // monitor gradient flow to ensure proper learning
         auto params = model->parameters();
         print_gradient_stats(params);
         
         // debug: verify gradients are actually flowing through the network
-        std::cout << "[Debug] After backward pass:" << std::endl;
-        for (size_t i = 0; i < params.size(); ++i) {
-            if (params[i]->requires_grad && !params[i]->grad.empty()) {
-                float max_grad = *std::max_element(params[i]->grad.begin(), params[i]->grad.end(), 
-                    [](float a, float b) { return std::abs(a) < std::abs(b); });
-                std::cout << "  Param " << i << " max grad: " << max_grad << std::endl;
+        // (the per-parameter scan only runs when debug output is on)
+        if (Logger::enabled(LogLevel::Debug)) {
+            LOG_DEBUG("[Debug] After backward pass:");
+            for (size_t i = 0; i < params.size(); ++i) {
+                if (params[i]->requires_grad && !params[i]->grad.empty()) {
+                    float max_grad = *std::max_element(params[i]->grad.begin(), params[i]->grad.end(),
+                        [](float a, float b) { return std::abs(a) < std::abs(b); });
+                    LOG_DEBUG("  Param " << i << " max grad: " << max_grad);
+                }
             }
         }
 
         // gradient clipping prevents gradient explosion in deep networks
         // clips gradients to maximum norm of 1.0 for stability
+        // (mixed precision leaves this to the clamp adam applies after unscaling)
         float max_grad_norm = 1.0f;
         for (auto& param : params) {
-            if (!param->requires_grad || param->grad.empty()) continue;
+            if (mixed_precision || !param->requires_grad || param->grad.empty()) continue;
             for (auto& grad : param->grad) {
                 if (std::abs(grad) > max_grad_norm) {
                     grad = std::copysign(max_grad_norm, grad);
@@ -304,21 +392,23 @@ int main() {
 
         // additional gradient debugging and extreme value detection
         if (!params.empty() && !params[0]->grad.empty()) {
-            std::cout << "[Debug] First param grad[0]: " << params[0]->grad[0] << std::endl;
+            LOG_DEBUG("[Debug] First param grad[0]: " << params[0]->grad[0]);
             
             // check for extreme gradient values that could destabilize training
+            // (mixed precision gradients still carry the loss scale, compare them unscaled)
+            const float unscale = mixed_precision ? 1.0f / scaler.scale() : 1.0f;
             bool extreme_grads = false;
             for (auto& param : params) {
                 if (!param->requires_grad || param->grad.empty()) continue;
                 for (auto& grad : param->grad) {
-                    if (std::isnan(grad) || std::isinf(grad) || std::abs(grad) > 1000.0f) {
-                        std::cout << "[Debug] Extreme gradient detected: " << grad << std::endl;
+                    if (std::isnan(grad) || std::isinf(grad) || std::abs(grad * unscale) > 1000.0f) {
+                        LOG_DEBUG("[Debug] Extreme gradient detected: " << grad);
                         extreme_grads = true;
                     }
                 }
             }
             if (extreme_grads) {
-                std::cout << "[Debug] Extreme gradients detected, training may be unstable" << std::endl;
+                LOG_WARN("[Debug] Extreme gradients detected, training may be unstable");
             }
         }
 
@@ -326,11 +416,18 @@ int main() {
         track_parameter_changes(model->parameters(), param_history);
         
         // update parameters using adam optimizer
-        optimizer.step(model->parameters());
+        // (mixed precision: skipped when a gradient overflowed, the scaler then lowers its scale)
+        if (!mixed_precision) {
+            optimizer.step(model->parameters());
+        } else if (!scaler.step(optimizer, model->parameters())) {
+            LOG_INFO("gradient overflow, step skipped (loss scale " << scaler.scale() << ")");
+        }
         
         // clear computational graph after optimizer step to free memory
         // this must happen after optimizer step, not before, to preserve gradients
-        global_graph.clear();
+        graph.clear();
+
+        if (track_memory) LOG_INFO("[Memory] " << MemoryTracker::step_summary());
     }
 
     // final prediction summary showing model performance across all epochs
@@ -374,6 +471,21 @@ int main() {
         std::cout << std::endl;
     }
     
+    if (profile_path) {
+        std::cout << "\n" << std::string(80, '=') << std::endl;
+        std::cout << "⏱️ PROFILE SUMMARY (chrome trace: " << profile_path << ")" << std::endl;
+        std::cout << std::string(80, '=') << std::endl;
+        Profiler::print_summary(std::cout);
+        Profiler::write_chrome_trace(profile_path);
+    }
+
+    if (track_memory) {
+        std::cout << "\n" << std::string(80, '=') << std::endl;
+        std::cout << "💾 MEMORY SUMMARY (peak of the last step, per-op totals of the run)" << std::endl;
+        std::cout << std::string(80, '=') << std::endl;
+        MemoryTracker::print_summary(std::cout);
+    }
+
     std::cout << "\n" << std::string(80, '=') << std::endl;
     std::cout << "✅ Training finished.\n";
     return 0;
@@ -0,0 +1,197 @@
+/*
+ * memory.cpp - category counters, per-op attribution and the tracked resources
+ */
+
+#include "memory.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+static std::atomic<size_t> live_bytes[kMemoryCategories];
+static std::atomic<size_t> peak_bytes[kMemoryCategories];
+static std::atomic<size_t> allocation_counts[kMemoryCategories];
+static std::atomic<size_t> total_live{0};
+static std::atomic<size_t> total_peak{0};
+
+// per-op attribution, only touched while tracking is enabled
+// the table and its mutex are never destroyed, buffers can still be released during exit
+struct Attribution {
+    std::map<std::pair<std::string, int>, OpMemoryStats> ops;
+    std::unordered_map<const void*, OpMemoryStats*> owners;  // live buffer -> op that allocated it
+};
+
+static std::mutex& attribution_mutex() {
+    static std::mutex* mutex = new std::mutex;
+    return *mutex;
+}
+
+static Attribution& attribution() {
+    static Attribution* table = new Attribution;
+    return *table;
+}
+
+static void raise_peak(std::atomic<size_t>& peak, size_t value) {
+    size_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+static std::string format_bytes(size_t bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB"};
+    double value = static_cast<double>(bytes);
+    int unit = 0;
+    while (value >= 1024.0 && unit < 3) {
+        value /= 1024.0;
+        ++unit;
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(unit == 0 ? 0 : 2) << value << " " << units[unit];
+    return out.str();
+}
+
+const char* memory_category_name(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Activation: return "activation";
+        case MemoryCategory::Gradient: return "gradient";
+        case MemoryCategory::Parameter: return "parameter";
+        case MemoryCategory::OptimizerState: return "optimizer";
+        case MemoryCategory::Other: return "other";
+    }
+    return "other";
+}
+
+void MemoryTracker::set_enabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(attribution_mutex());
+    if (enabled && !attributing.load(std::memory_order_relaxed)) {
+        attribution().ops.clear();
+        attribution().owners.clear();
+    }
+    attributing.store(enabled, std::memory_order_relaxed);
+}
+
+void MemoryTracker::reset_peak() {
+    for (int c = 0; c < kMemoryCategories; ++c) {
+        peak_bytes[c].store(live_bytes[c].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        allocation_counts[c].store(0, std::memory_order_relaxed);
+    }
+    total_peak.store(total_live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void MemoryTracker::record_allocation(MemoryCategory category, const void* p, size_t bytes) {
+    const int c = static_cast<int>(category);
+    raise_peak(peak_bytes[c], live_bytes[c].fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    raise_peak(total_peak, total_live.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    allocation_counts[c].fetch_add(1, std::memory_order_relaxed);
+
+    if (!enabled()) return;
+    const char* op = current_op ? current_op : "(no op)";
+    std::lock_guard<std::mutex> lock(attribution_mutex());
+    OpMemoryStats& stats = attribution().ops[{op, c}];
+    stats.live_bytes += bytes;
+    stats.allocated_bytes += bytes;
+    stats.allocations++;
+    attribution().owners[p] = &stats;
+}
+
+void MemoryTracker::record_deallocation(MemoryCategory category, const void* p, size_t bytes) {
+    const int c = static_cast<int>(category);
+    live_bytes[c].fetch_sub(bytes, std::memory_order_relaxed);
+    total_live.fetch_sub(bytes, std::memory_order_relaxed);
+
+    if (!enabled()) return;
+    std::lock_guard<std::mutex> lock(attribution_mutex());
+    auto owner = attribution().owners.find(p);
+    if (owner == attribution().owners.end()) return;  // allocated before tracking was enabled
+    owner->second->live_bytes -= bytes;
+    attribution().owners.erase(owner);
+}
+
+MemorySnapshot MemoryTracker::snapshot() {
+    MemorySnapshot s;
+    for (int c = 0; c < kMemoryCategories; ++c) {
+        s.categories[c].live_bytes = live_bytes[c].load(std::memory_order_relaxed);
+        s.categories[c].peak_bytes = peak_bytes[c].load(std::memory_order_relaxed);
+        s.categories[c].allocations = allocation_counts[c].load(std::memory_order_relaxed);
+    }
+    s.live_bytes = total_live.load(std::memory_order_relaxed);
+    s.peak_bytes = total_peak.load(std::memory_order_relaxed);
+
+    {
+        std::lock_guard<std::mutex> lock(attribution_mutex());
+        for (auto& entry : attribution().ops) {
+            OpMemoryStats stats = entry.second;
+            stats.op = entry.first.first;
+            stats.category = static_cast<MemoryCategory>(entry.first.second);
+            s.ops.push_back(std::move(stats));
+        }
+    }
+    std::sort(s.ops.begin(), s.ops.end(),
+              [](const OpMemoryStats& a, const OpMemoryStats& b) { return a.allocated_bytes > b.allocated_bytes; });
+    return s;
+}
+
+std::string MemoryTracker::step_summary() {
+    MemorySnapshot s = snapshot();
+    std::ostringstream out;
+    out << "live " << format_bytes(s.live_bytes) << ", peak " << format_bytes(s.peak_bytes) << " (";
+    for (int c = 0; c < kMemoryCategories; ++c) {
+        out << (c ? ", " : "") << memory_category_name(static_cast<MemoryCategory>(c)) << " "
+            << format_bytes(s.categories[c].peak_bytes);
+    }
+    out << ")";
+    return out.str();
+}
+
+void MemoryTracker::print_summary(std::ostream& out) {
+    MemorySnapshot s = snapshot();
+    out << std::left << std::setw(12) << "category" << std::right << std::setw(14) << "live"
+        << std::setw(14) << "peak" << std::setw(10) << "allocs" << "\n";
+    for (int c = 0; c < kMemoryCategories; ++c) {
+        const MemoryCategoryStats& stats = s.categories[c];
+        out << std::left << std::setw(12) << memory_category_name(static_cast<MemoryCategory>(c))
+            << std::right << std::setw(14) << format_bytes(stats.live_bytes)
+            << std::setw(14) << format_bytes(stats.peak_bytes) << std::setw(10) << stats.allocations << "\n";
+    }
+    out << std::left << std::setw(12) << "total" << std::right << std::setw(14) << format_bytes(s.live_bytes)
+        << std::setw(14) << format_bytes(s.peak_bytes) << "\n";
+
+    if (s.ops.empty()) return;
+    out << "\n" << std::left << std::setw(16) << "op" << std::setw(12) << "category" << std::right
+        << std::setw(14) << "allocated" << std::setw(14) << "live" << std::setw(10) << "allocs" << "\n";
+    for (const OpMemoryStats& stats : s.ops) {
+        out << std::left << std::setw(16) << stats.op << std::setw(12) << memory_category_name(stats.category)
+            << std::right << std::setw(14) << format_bytes(stats.allocated_bytes)
+            << std::setw(14) << format_bytes(stats.live_bytes) << std::setw(10) << stats.allocations << "\n";
+    }
+}
+
+void* TrackedResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = upstream->allocate(bytes, alignment);
+    MemoryTracker::record_allocation(category, p, bytes);
+    return p;
+}
+
+void TrackedResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    MemoryTracker::record_deallocation(category, p, bytes);
+    upstream->deallocate(p, bytes, alignment);
+}
+
+bool TrackedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+std::pmr::memory_resource* tracked_heap(MemoryCategory category) {
+    // never destroyed: tensors with static lifetime may release their buffers during exit
+    static TrackedResource* heaps[kMemoryCategories] = {
+        new TrackedResource(std::pmr::new_delete_resource(), MemoryCategory::Activation),
+        new TrackedResource(std::pmr::new_delete_resource(), MemoryCategory::Gradient),
+        new TrackedResource(std::pmr::new_delete_resource(), MemoryCategory::Parameter),
+        new TrackedResource(std::pmr::new_delete_resource(), MemoryCategory::OptimizerState),
+        new TrackedResource(std::pmr::new_delete_resource(), MemoryCategory::Other),
+    };
+    return heaps[static_cast<int>(category)];
+}
@@ -0,0 +1,118 @@
+/*
+ * memory.hpp - live/peak byte accounting per tensor category and per op
+ *
+ * answers "what is the peak memory of one training step":
+ * - every tensor buffer is allocated through a TrackedResource tagged with what it holds
+ *   (activations, gradients, parameters, optimizer state, other tensors such as inputs)
+ * - live and peak bytes per category are always counted (a few relaxed atomics per allocation)
+ * - while tracking is enabled, allocations are also attributed to the op that made them:
+ *   the innermost ProfileScope (profiler.hpp) names the op, so "matmul" gradients and "add"
+ *   activations show up separately
+ *
+ * usage:
+ *     MemoryTracker::set_enabled(true);
+ *     for (...) {
+ *         MemoryTracker::reset_peak();                 // peak of this step only
+ *         ... forward, backward, optimizer step ...
+ *         LOG_INFO("[Memory] " << MemoryTracker::step_summary());
+ *     }
+ *     MemoryTracker::print_summary(std::cout);
+ *
+ * IMPORTANT: bytes are the buffers handed out, not what the system reserved - arena chunks
+ * (Arena::bytes_reserved) and the bookkeeping of tensor/op objects themselves are not included
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class MemoryCategory : int { Activation = 0, Gradient = 1, Parameter = 2, OptimizerState = 3, Other = 4 };
+constexpr int kMemoryCategories = 5;
+
+const char* memory_category_name(MemoryCategory category);
+
+// byte counters of one category
+struct MemoryCategoryStats {
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;      // highest live_bytes since the last reset_peak()
+    size_t allocations = 0;     // buffers handed out since the last reset_peak()
+};
+
+// bytes one op allocated for one category while tracking was enabled
+struct OpMemoryStats {
+    std::string op;
+    MemoryCategory category = MemoryCategory::Other;
+    size_t live_bytes = 0;
+    size_t allocated_bytes = 0;  // total since tracking was enabled
+    size_t allocations = 0;
+};
+
+struct MemorySnapshot {
+    std::array<MemoryCategoryStats, kMemoryCategories> categories;
+    size_t live_bytes = 0;
+    size_t peak_bytes = 0;        // peak of the total, not the sum of the category peaks
+    std::vector<OpMemoryStats> ops;  // largest allocated_bytes first (empty while disabled)
+
+    const MemoryCategoryStats& operator[](MemoryCategory category) const {
+        return categories[static_cast<int>(category)];
+    }
+};
+
+class MemoryTracker {
+public:
+    // per-op attribution switch, the category counters run regardless
+    // enabling starts a fresh attribution table
+    static bool enabled() { return attributing.load(std::memory_order_relaxed); }
+    static void set_enabled(bool enabled);
+
+    // restarts peak and allocation counts from the current live bytes (call at the start of a step)
+    static void reset_peak();
+
+    static MemorySnapshot snapshot();
+
+    // one line: total live/peak and the peak of each category
+    static std::string step_summary();
+    // category table followed by the per-op table
+    static void print_summary(std::ostream& out);
+
+    // called by TrackedResource
+    static void record_allocation(MemoryCategory category, const void* p, size_t bytes);
+    static void record_deallocation(MemoryCategory category, const void* p, size_t bytes);
+
+    // op the calling thread is currently running (set by ProfileScope), returns the previous one
+    static const char* enter_op(const char* op) {
+        const char* previous = current_op;
+        current_op = op;
+        return previous;
+    }
+    static void leave_op(const char* previous) { current_op = previous; }
+
+private:
+    static inline std::atomic<bool> attributing{false};
+    static inline thread_local const char* current_op = nullptr;
+};
+
+// forwards to an upstream resource and counts every buffer under one category
+class TrackedResource : public std::pmr::memory_resource {
+public:
+    TrackedResource(std::pmr::memory_resource* upstream_, MemoryCategory category_)
+        : upstream(upstream_), category(category_) {}
+
+    MemoryCategory memory_category() const { return category; }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream;
+    MemoryCategory category;
+};
+
+// process-wide heap resource for one category (tensors that are not carved from a graph arena)
+std::pmr::memory_resource* tracked_heap(MemoryCategory category);
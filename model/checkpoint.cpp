@@ -0,0 +1,99 @@
+/*
+ * checkpoint.cpp - activation checkpointing implementation
+ *
+ * the segment output handed to the caller is a tracked alias of the untracked forward result:
+ * it shares the storage (no copy) and carries CheckpointOp as its creator
+ */
+
+#include "checkpoint.hpp"
+#include "sequential.hpp"
+#include "../autocast.hpp"
+#include "../autograd.hpp"
+#include "../grad_mode.hpp"
+#include "../graph.hpp"
+#include "../profiler.hpp"
+#include "../ops/simd.hpp"
+#include <stdexcept>
+
+// module after module (linear + relu pairs fused), with whatever gradient mode is active
+static std::shared_ptr<Tensor> run_segment(const std::vector<std::shared_ptr<Module>>& segment,
+                                           std::shared_ptr<Tensor> x) {
+    return forward_modules(segment, x);
+}
+
+CheckpointOp::CheckpointOp(std::vector<std::shared_ptr<Module>> segment_, const std::shared_ptr<Tensor>& input)
+    : segment(std::move(segment_)), precision(Autocast::dtype()) {
+    inputs.push_back(input);
+
+    // the segment's parameters are listed too, so pruning (autograd.hpp) sees that they are
+    // reached through this op, and input_grad_mask tells backward which of them are wanted
+    for (auto& module : segment) {
+        for (auto& param : module->parameters()) inputs.push_back(param);
+    }
+}
+
+void CheckpointOp::backward(Tensor& grad_output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("CheckpointOp: input expired");
+
+    // the recomputed activations only live for this call
+    // and are computed in the precision of the original forward
+    EnableGradGuard enable_grad;
+    AutocastGuard autocast(precision);
+    Graph recompute_graph;
+    GraphScope scope(recompute_graph);
+
+    // fresh leaf over the same data, so the segment's graph stops here
+    auto x = input->detach();
+    x->requires_grad = input->requires_grad && needs_input_grad(0);
+
+    auto y = run_segment(segment, x);
+    if (!y->requires_grad || y->creator.expired()) return;
+
+    // the recompute only writes the gradients the outer backward asked for
+    // (a backward(leaves) call leaves the unlisted parameters untouched)
+    std::vector<std::shared_ptr<Tensor>> leaves;
+    if (x->requires_grad) leaves.push_back(x);
+    for (size_t i = 1; i < inputs.size(); ++i) {
+        if (!needs_input_grad(i)) continue;
+        if (auto param = inputs[i].lock()) leaves.push_back(param);
+    }
+
+    y->grad.assign(grad_output.grad.begin(), grad_output.grad.end());
+    run_backward(y, leaves);
+
+    if (x->requires_grad && !x->grad.empty()) {
+        // both gradients are packed in the input's shape
+        if (input->grad.empty()) input->grad.resize(input->numel(), 0.0f);
+        simd().accumulate(x->grad.data(), input->grad.data(), input->grad.size());
+    }
+}
+
+std::shared_ptr<Tensor> checkpoint(std::vector<std::shared_ptr<Module>> segment,
+                                   const std::shared_ptr<Tensor>& input) {
+    ProfileScope profile("checkpoint", "forward");
+
+    std::shared_ptr<Tensor> output;
+    {
+        // intermediates are dropped as soon as the next module has consumed them
+        NoGradGuard no_grad;
+        output = run_segment(segment, input);
+    }
+
+    bool needs_grad = input->requires_grad;
+    for (auto& module : segment) {
+        for (auto& param : module->parameters()) needs_grad = needs_grad || param->requires_grad;
+    }
+    if (!GradMode::track(needs_grad)) return output;
+
+    Graph& graph = current_graph();
+    auto result = graph.make_view(output->storage, output->shape, output->strides, output->offset, true);
+    auto op = graph.make_op<CheckpointOp>(std::move(segment), input);
+    result->set_creator(op);
+
+    // register with the current graph for lifetime management
+    graph.add_tensor(result);
+    graph.add_op(op);
+
+    return result;
+}
@@ -0,0 +1,39 @@
+/*
+ * checkpoint.hpp - activation checkpointing for chains of modules
+ *
+ * trades compute for memory during training:
+ * - the segment's forward pass runs under NoGradGuard, so none of its intermediate
+ *   activations, ops or cached tensors stay alive after it returns
+ * - only the segment input and output are kept, linked by a single CheckpointOp
+ * - during backward the op re-runs the segment with gradient tracking in a private graph
+ *   and backpropagates through that copy, accumulating into the parameters and the input
+ *   (only those the outer backward wants, so backward(leaves) restrictions still hold)
+ *
+ * IMPORTANT: modules must be deterministic - the recomputed forward pass has to match the
+ * original one. a checkpointed step cannot be replayed by CapturedStep (capture.hpp)
+ */
+
+#pragma once
+#include <memory>
+#include <vector>
+#include "../op.hpp"
+#include "../tensor.hpp"
+#include "../src/module.hpp"
+
+// stands in for a whole segment of modules in the computational graph
+class CheckpointOp : public Op {
+public:
+    CheckpointOp(std::vector<std::shared_ptr<Module>> segment, const std::shared_ptr<Tensor>& input);
+
+    // recomputes the segment with gradient tracking, then backpropagates grad_output through it
+    void backward(Tensor& grad_output) override;
+    const char* name() const override { return "checkpoint"; }
+
+private:
+    std::vector<std::shared_ptr<Module>> segment;
+    DType precision;  // autocast dtype of the forward pass (autocast.hpp)
+};
+
+// runs segment on input (module after module) keeping only the output for backward
+std::shared_ptr<Tensor> checkpoint(std::vector<std::shared_ptr<Module>> segment,
+                                   const std::shared_ptr<Tensor>& input);
@@ -0,0 +1,109 @@
+/*
+ * quantized.cpp - calibration and the forward pass of the int8 inference model
+ */
+
+#include "quantized.hpp"
+#include "../grad_mode.hpp"
+#include "../linear.hpp"
+#include "../relu.hpp"
+#include "../logging.hpp"
+#include "../memory.hpp"
+#include "../profiler.hpp"
+#include "../ops/cast.hpp"
+#include "../ops/elementwise.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+// quantization params covering every value of a float tensor
+static QuantParams calibrate(const Tensor& x) {
+    float lo = 0.0f, hi = 0.0f;
+    for_each_element(x, [&](size_t, float v) {
+        lo = std::min(lo, v);
+        hi = std::max(hi, v);
+    });
+    return choose_quant_params(lo, hi);
+}
+
+std::shared_ptr<QuantizedSequential> quantize(const Sequential& model, const std::shared_ptr<Tensor>& calibration) {
+    if (model.layers().empty()) throw std::runtime_error("quantize: model has no layers");
+
+    auto result = std::make_shared<QuantizedSequential>();
+    NoGradGuard no_grad;
+    auto x = as_float32(calibration);
+
+    const auto& layers = model.layers();
+    for (size_t i = 0; i < layers.size(); ++i) {
+        auto linear = std::dynamic_pointer_cast<Linear>(layers[i]);
+        if (!linear) throw std::runtime_error("quantize: unsupported module " + layers[i]->name());
+
+        // a ReLU module right after the layer folds into its epilogue, as in Sequential::forward;
+        // after a layer that applies relu itself it changes nothing (relu is idempotent)
+        Activation activation = linear->activation;
+        if (i + 1 < layers.size() && std::dynamic_pointer_cast<ReLU>(layers[i + 1])) {
+            activation = Activation::ReLU;
+            ++i;
+        }
+
+        QuantizedSequential::Stage stage;
+        stage.input = calibrate(*x);
+        stage.weights = quantize_weights(*linear->weight);
+        stage.relu = activation == Activation::ReLU;
+
+        auto bias = as_float32(linear->bias)->contiguous();
+        const float* b = bias->storage->data() + bias->offset;
+        stage.bias.assign(b, b + bias->numel());
+
+        LOG_DEBUG("[quantize] Linear " << stage.weights.in << "x" << stage.weights.out << " input scale "
+                  << stage.input.scale << " zero point " << stage.input.zero_point);
+        result->stages.push_back(std::move(stage));
+
+        // the float output is the next layer's calibration input
+        x = as_float32(linear->forward(x, activation));
+    }
+    return result;
+}
+
+std::shared_ptr<Tensor> QuantizedSequential::forward(std::shared_ptr<Tensor> input) {
+    ProfileScope profile("qlinear", "forward");
+
+    if (stages.empty()) throw std::runtime_error("QuantizedSequential: not built by quantize()");
+    auto x = as_float32(input);
+    if (x->shape.size() != 2 || x->shape[1] != stages.front().weights.in) {
+        throw std::runtime_error("QuantizedSequential: expected a [batch, " +
+                                 std::to_string(stages.front().weights.in) + "] input");
+    }
+    const int batch = x->shape[0];
+
+    // uint8 activations of the current and the next layer, per thread, grown once
+    static thread_local std::vector<uint8_t> current;
+    static thread_local std::vector<uint8_t> next;
+    current.resize(static_cast<size_t>(batch) * stages.front().weights.in);
+    quantize_activations(*x, stages.front().input, current.data());
+
+    auto result = std::make_shared<Tensor>(std::vector<int>{batch, stages.back().weights.out}, false,
+                                           tracked_heap(MemoryCategory::Activation));
+
+    for (size_t s = 0; s < stages.size(); ++s) {
+        const Stage& stage = stages[s];
+        QLinearEpilogue epilogue;
+        epilogue.bias = stage.bias.data();
+        epilogue.relu = stage.relu;
+
+        if (s + 1 == stages.size()) {
+            qlinear(batch, current.data(), stage.input, stage.weights, epilogue, result->data().data(), nullptr);
+        } else {
+            // requantized for the next layer inside the epilogue
+            epilogue.output = &stages[s + 1].input;
+            next.resize(static_cast<size_t>(batch) * stage.weights.out);
+            qlinear(batch, current.data(), stage.input, stage.weights, epilogue, nullptr, next.data());
+            current.swap(next);
+        }
+    }
+    return result;
+}
+
+size_t QuantizedSequential::weight_bytes() const {
+    size_t bytes = 0;
+    for (const auto& stage : stages) bytes += stage.weights.bytes() + stage.bias.size() * sizeof(float);
+    return bytes;
+}
@@ -0,0 +1,56 @@
+/*
+ * quantized.hpp - int8 inference copy of a trained Sequential model
+ *
+ * quantize(model, calibration) turns a chain of Linear layers (each optionally followed by a
+ * ReLU) into an inference-only model built on ops/qgemm.hpp:
+ * - every weight matrix becomes int8 with one scale per output channel (~4x less memory)
+ * - the calibration batch is run through the float model once; the range of every layer's
+ *   input fixes that layer's uint8 activation scale and zero point
+ * - hidden layers hand uint8 activations straight to the next layer (bias, relu and
+ *   requantization are fused into the integer gemm epilogue), only the last layer writes floats
+ *
+ * usage:
+ *     auto int8_model = quantize(*model, calibration_inputs);
+ *     auto prediction = int8_model->forward(x);   // untracked float32 [batch, out]
+ *
+ * IMPORTANT: no gradients flow through the quantized model and it has no parameters; inputs far
+ * outside the calibration range are clamped. only Linear layers (and a ReLU right after one)
+ * are supported
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "sequential.hpp"
+#include "../ops/qgemm.hpp"
+
+class QuantizedSequential : public Module {
+public:
+    // applies the quantized layers to a float [batch, in_features] input
+    // the model is read-only here, so several threads may score with it at once
+    std::shared_ptr<Tensor> forward(std::shared_ptr<Tensor> input) override;
+
+    // inference only: nothing to train
+    std::vector<std::shared_ptr<Tensor>> parameters() const override { return {}; }
+
+    std::string name() const override { return "QuantizedSequential"; }
+
+    // memory held by the quantized weights, scales and biases
+    size_t weight_bytes() const;
+
+private:
+    friend std::shared_ptr<QuantizedSequential> quantize(const Sequential& model,
+                                                         const std::shared_ptr<Tensor>& calibration);
+
+    struct Stage {
+        QuantizedWeights weights;
+        std::vector<float> bias;
+        bool relu = false;
+        QuantParams input;  // quantization of this layer's input, from calibration
+    };
+    std::vector<Stage> stages;
+};
+
+// int8 copy of model calibrated on a representative [batch, in_features] input
+std::shared_ptr<QuantizedSequential> quantize(const Sequential& model, const std::shared_ptr<Tensor>& calibration);
@@ -5,27 +5,72 @@
  * - forward pass applies modules in sequence: input -> module1 -> module2 -> ... -> output
  * - parameter collection aggregates parameters from all contained modules
  * - provides debugging output during forward pass execution
+ * - a ReLU right after a Linear is fused with it at forward time (one op, one output tensor),
+ *   the modules themselves stay as added
  * each module's output becomes the next module's input, creating a chain of transformations
  */
 
 #include "sequential.hpp"
+#include "checkpoint.hpp"
+#include "../grad_mode.hpp"
+#include "../linear.hpp"
+#include "../relu.hpp"
+#include "../logging.hpp"
+#include "../src/flat_parameters.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+std::shared_ptr<Tensor> forward_modules(const std::vector<std::shared_ptr<Module>>& modules,
+                                        std::shared_ptr<Tensor> x) {
+    for (size_t i = 0; i < modules.size(); ++i) {
+        // linear followed by relu: the layer applies the activation in its gemm epilogue
+        auto linear = std::dynamic_pointer_cast<Linear>(modules[i]);
+        if (linear && linear->activation == Activation::None && i + 1 < modules.size() &&
+            std::dynamic_pointer_cast<ReLU>(modules[i + 1])) {
+            LOG_DEBUG("Forward pass layers " << i << "-" << i + 1 << " (Linear + ReLU, fused)");
+            x = linear->forward(x, Activation::ReLU);
+            ++i;
+            continue;
+        }
+        LOG_DEBUG("Forward pass layer " << i << " (" << modules[i]->name() << ")");
+        x = modules[i]->forward(x);
+    }
+    return x;
+}
 
 void Sequential::add_module(std::shared_ptr<Module> module) {
+    // the flat block and the cached parameter list cover only the modules flattened so far
+    if (flat) throw std::runtime_error("Sequential::add_module: parameters are flattened, add modules first");
+
     // add module to the end of the sequential chain
     modules.push_back(module);
 }
 
+void Sequential::set_checkpointing(size_t segment_size) {
+    checkpoint_segment_size = segment_size;
+}
+
 std::shared_ptr<Tensor> Sequential::forward(std::shared_ptr<Tensor> input) {
     // thjs executes modules sequentially: input -> module1 -> module2 -> ... -> output
     std::shared_ptr<Tensor> x = input;
-    for (size_t i = 0; i < modules.size(); ++i) {
-        std::cout << "Forward pass layer " << i << " (" << modules[i]->name() << ")" << std::endl;
-        x = modules[i]->forward(x);
+
+    // checkpointing only matters when a graph is being recorded
+    if (checkpoint_segment_size > 0 && GradMode::is_enabled()) {
+        for (size_t begin = 0; begin < modules.size(); begin += checkpoint_segment_size) {
+            size_t end = std::min(begin + checkpoint_segment_size, modules.size());
+            LOG_DEBUG("Forward pass layers " << begin << "-" << end - 1 << " (checkpointed)");
+            x = checkpoint({modules.begin() + begin, modules.begin() + end}, x);
+        }
+        return x;
     }
-    return x;
+
+    return forward_modules(modules, x);
 }
 
 std::vector<std::shared_ptr<Tensor>> Sequential::parameters() const {
+    // flattened models keep the list
+    if (flat) return flat->tensors();
+
     // thsi collects parameters from all contained modules
     std::vector<std::shared_ptr<Tensor>> params;
     for (auto& module : modules) {
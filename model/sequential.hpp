@@ -13,20 +13,38 @@ public:
     Sequential() = default;
     // adds a module to the sequential container
     // modules will always be executed in the order they were added
+    // (a ReLU directly after a Linear is stored as given and fused with it at forward time)
+    // throws once flatten_parameters() was called
     void add_module(std::shared_ptr<Module> module);
 
     // forward pass: applies all modules sequentially to input
     // each module's output becomes the next module's input(this is opposite on backwards passes)
     std::shared_ptr<Tensor> forward(std::shared_ptr<Tensor> input) override;
 
+    // activation checkpointing: forward runs in segments of segment_size modules whose
+    // intermediate activations are dropped and recomputed during backward (checkpoint.hpp)
+    // 0 disables it (the default)
+    void set_checkpointing(size_t segment_size);
+
     // collects parameters from all contained modules
     // returns concatenated list of all trainable parameters
     std::vector<std::shared_ptr<Tensor>> parameters() const override;
 
+    // the stored modules in execution order, exactly as added
+    const std::vector<std::shared_ptr<Module>>& layers() const { return modules; }
+
     // model identification for debugging and inspection
     std::string name() const override { return "Sequential"; }
 
 private:
     // ordered list of modules to execute sequentially(this is used for debugging and inspection)
     std::vector<std::shared_ptr<Module>> modules;
+
+    // modules per checkpointed segment, 0 when checkpointing is off
+    size_t checkpoint_segment_size = 0;
 };
+
+// runs modules one after another on x; a Linear without activation directly followed by a
+// ReLU is computed as one fused op (relu in the gemm epilogue) and the ReLU module is skipped
+std::shared_ptr<Tensor> forward_modules(const std::vector<std::shared_ptr<Module>>& modules,
+                                        std::shared_ptr<Tensor> x);
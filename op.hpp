@@ -8,11 +8,14 @@
  * 
  * IMPORTANT design insight: operations are the nodes in the computational graph
  * each operation knows how to compute gradients w.r.t. its inputs
+ * but never walks the graph itself
  */
 
 #pragma once
 #include <vector>
 #include <memory>
+#include <cstdint>
+#include <stdexcept>
 class Tensor;
 
 class Op : public std::enable_shared_from_this<Op> {
@@ -21,9 +24,28 @@ public:
     // weak_ptr allows tensors to be destroyed when no longer needed
     std::vector<std::weak_ptr<Tensor>> inputs;
 
+    // one bit per input: whether backward() has to produce that input's gradient
+    // the autograd engine clears the bits of inputs whose subgraph reaches no leaf that wants a
+    // gradient, so their kernels are skipped and their grad buffers never allocated
+    uint64_t input_grad_mask = ~uint64_t(0);
+
+    bool needs_input_grad(size_t i) const { return i >= 64 || ((input_grad_mask >> i) & 1); }
+
     // compute gradients w.r.t. input tensors during backpropagation
     // grad_output contains gradients flowing backward from output
+    // only accumulates into the direct inputs' grad buffers - the autograd engine
+    // (autograd.hpp) decides the visiting order and calls this exactly once per step
     virtual void backward(Tensor& grad_output) = 0;
+
+    // recompute output from the inputs' current values, writing into its existing buffers
+    // used by graph replay (capture.hpp), so implementations must not allocate
+    virtual void recompute(Tensor& output) {
+        (void)output;
+        throw std::runtime_error("Op: this operation does not support recompute");
+    }
     
+    // short operation name, used by the profiler and diagnostics
+    virtual const char* name() const { return "op"; }
+
     virtual ~Op() = default;
 };
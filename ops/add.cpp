@@ -2,18 +2,20 @@
  * add.cpp - element-wise addition operation implementation
  * 
  * this file implements tensor addition with sophisticated broadcasting support:
- * - forward pass: handles shape mismatches through automatic broadcasting
- * - backward pass: propagates gradients with proper broadcasting rules
+ * - forward pass: numpy-style broadcasting through stride-0 operands, nothing is expanded
+ * - backward pass: gradients are summed back down to each operand's shape
  */
 
 #include "add.hpp"
 #include <stdexcept>
 #include "../graph.hpp"
+#include "../grad_mode.hpp"
+#include "../profiler.hpp"
 #include "../tensor.hpp"
+#include "elementwise.hpp"
+#include "cast.hpp"
 #include <iostream>
 
-extern Graph global_graph;
-
 // constructor stores weak references to input tensors to prevent circular dependencies
 // weak_ptr allows tensors to be destroyed when no longer needed
 AddOp::AddOp(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b) {
@@ -22,109 +24,62 @@ AddOp::AddOp(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b) {
 }
 
 void AddOp::backward(Tensor& grad_output) {
-    for (auto& weak_input : inputs) {
-        auto input = std::const_pointer_cast<Tensor>(weak_input.lock());
-        if (!input) throw std::runtime_error("AddOp: input expired");
+    auto a = inputs[0].lock();
+    auto b = inputs[1].lock();
+    if (!a || !b) throw std::runtime_error("AddOp: input expired");
 
-        if (input->requires_grad) {
-            if (input->grad.empty()) input->grad.resize(input->data.size(), 0.0f);
-            
-            // handle broadcasting in backward pass for bias addition
-            // bias tensors (1d) need gradients summed across batch dimension
-            if (input->shape.size() == 1 && grad_output.shape.size() == 2) {
-                // bias tensor (1d) - sum gradients across batch dimension
-                for (size_t i = 0; i < input->data.size(); ++i) {
-                    for (size_t batch = 0; batch < grad_output.shape[0]; ++batch) {
-                        input->grad[i] += grad_output.grad[batch * grad_output.shape[1] + i];
-                    }
-                }
-            } else {
-                // same shape tensors - direct gradient assignment
-                for (size_t i = 0; i < input->data.size(); ++i)
-                    input->grad[i] += grad_output.grad[i];
-            }
+    for (size_t k = 0; k < inputs.size(); ++k) {
+        auto input = std::const_pointer_cast<Tensor>(k == 0 ? a : b);
+
+        if (input->requires_grad && needs_input_grad(k)) {
+            if (input->grad.empty()) input->grad.resize(input->numel(), 0.0f);
 
-            // propagate gradients to input tensor's creator to maintain gradient chain
-            // critical fix: check if creator is different to prevent infinite loops
-            auto input_creator = input->creator.lock();
-            if (input_creator && input_creator.get() != this) {
-                // only propagate if the creator is different from this operation
-                input_creator->backward(*input);
+            if (input->shape == grad_output.shape) {
+                // same shape tensors - direct gradient assignment
+                simd().accumulate(grad_output.grad.data(), input->grad.data(), input->grad.size());
+            } else {
+                // broadcast operand (e.g. a bias row) - sum gradients over the repeated dimensions
+                reduce_broadcast(grad_output.shape, grad_output.grad.data(), *a, *b, input->shape,
+                                 input->grad.data(), [](float g, float, float) { return g; });
             }
         }
     }
 }
 
+// a + b into a preallocated output, shared by add() and graph replay
+static void add_kernel(const Tensor& a, const Tensor& b, Tensor& out) {
+    broadcast_binary(a, b, out, [](float x, float y) { return x + y; }, simd().add);
+}
+
+void AddOp::recompute(Tensor& output) {
+    auto a = inputs[0].lock();
+    auto b = inputs[1].lock();
+    if (!a || !b) throw std::runtime_error("AddOp: input expired");
+    add_kernel(*a, *b, output);
+}
+
 std::shared_ptr<Tensor> add(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b) {
-    // determine output shape and handle broadcasting for shape mismatches
-    // this enables efficient operations like matrix + bias vector
-    std::vector<int> output_shape;
-    bool needs_broadcasting = false;
-    
-    if (a->shape.size() != b->shape.size()) {
-        // different dimensions - assume broadcasting is needed
-        needs_broadcasting = true;
-        if (a->shape.size() > b->shape.size()) {
-            output_shape = a->shape;
-        } else {
-            output_shape = b->shape;
-        }
-    } else {
-        // same dimensions - check if shapes match
-        output_shape = a->shape;
-        for (size_t i = 0; i < a->shape.size(); ++i) {
-            if (a->shape[i] != b->shape[i]) {
-                needs_broadcasting = true;
-                output_shape[i] = std::max(a->shape[i], b->shape[i]);
-            }
-        }
-    }
-    
-    auto result = std::make_shared<Tensor>(output_shape, a->requires_grad || b->requires_grad);
-    
-    if (needs_broadcasting) {
-        // handle broadcasting: 2d + 1d (matrix + bias vector)
-        // this is the most common case in neural networks
-        if (a->shape.size() == 2 && b->shape.size() == 1) {
-            // matrix + bias vector: broadcast bias across rows
-            int rows = a->shape[0];
-            int cols = a->shape[1];
-            
-            for (int i = 0; i < rows; ++i) {
-                for (int j = 0; j < cols; ++j) {
-                    result->data[i * cols + j] = a->data[i * cols + j] + b->data[j];
-                }
-            }
-        } else if (a->shape.size() == 1 && b->shape.size() == 2) {
-            // bias vector + matrix: broadcast bias across rows
-            int rows = b->shape[0];
-            int cols = b->shape[1];
-            
-            for (int i = 0; i < rows; ++i) {
-                for (int j = 0; j < cols; ++j) {
-                    result->data[i * cols + j] = a->data[j] + b->data[i * cols + j];
-                }
-            }
-        } else {
-            // fallback for other broadcasting cases
-            for (size_t i = 0; i < result->data.size(); ++i) {
-                result->data[i] = a->data[i % a->data.size()] + b->data[i % b->data.size()];
-            }
-        }
-    } else {
-        // no broadcasting needed - direct addition
-        for (size_t i = 0; i < result->data.size(); ++i)
-            result->data[i] = a->data[i] + b->data[i];
-    }
+    ProfileScope profile("add", "forward");
+
+    // 16-bit operands are widened once (ops/cast.hpp), the kernels read float32
+    a = as_float32(a);
+    b = as_float32(b);
+
+    // numpy-style broadcasting: size-1 and missing leading dims repeat (matrix + bias row, ...)
+    std::vector<int> output_shape = broadcast_shape(a->shape, b->shape);
+
+    auto result = current_graph().make_tensor(output_shape, GradMode::track(a->requires_grad || b->requires_grad));
+    add_kernel(*a, *b, *result);
 
     if (result->requires_grad) {
+        Graph& graph = current_graph();
         // create add operation and integrate with computational graph
-        auto op = std::make_shared<AddOp>(a, b);
+        auto op = graph.make_op<AddOp>(a, b);
         result->set_creator(op);
 
-        // register with global graph for lifetime management
-        global_graph.add_tensor(result);
-        global_graph.add_op(op);
+        // register with the current graph for lifetime management
+        graph.add_tensor(result);
+        graph.add_op(op);
     }
 
     return result;
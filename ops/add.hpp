@@ -19,6 +19,8 @@ class AddOp : public Op {
 public:
     AddOp(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b);
     void backward(Tensor& grad_output) override;
+    void recompute(Tensor& output) override;
+    const char* name() const override { return "add"; }
 };
 
 // global add function creates add operations and integrates with computational graph
@@ -0,0 +1,144 @@
+/*
+ * cast.cpp - dtype conversion kernels and the cast op
+ *
+ * every row of the copy goes through one of the simd conversions (strided rows are gathered
+ * into a small staging buffer first); a 16-bit to 16-bit copy of a different type goes through
+ * float32, a same-dtype copy is a plain copy
+ */
+
+#include "cast.hpp"
+#include "simd.hpp"
+#include "../graph.hpp"
+#include "../grad_mode.hpp"
+#include "../profiler.hpp"
+#include "../strided.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr size_t kConvertChunk = 256;  // staging elements (strided rows, 16-bit to 16-bit)
+
+// n packed elements from src (dtype from) to dst (dtype to)
+static void convert_run(const void* src, DType from, void* dst, DType to, size_t n) {
+    if (from == to) {
+        std::memcpy(dst, src, n * dtype_size(from));
+        return;
+    }
+    if (from == DType::Float32) {
+        const float* s = static_cast<const float*>(src);
+        uint16_t* d = static_cast<uint16_t*>(dst);
+        if (to == DType::BFloat16) simd().narrow_bf16(s, d, n);
+        else simd().narrow_fp16(s, d, n);
+        return;
+    }
+    const uint16_t* s = static_cast<const uint16_t*>(src);
+    if (to == DType::Float32) {
+        float* d = static_cast<float*>(dst);
+        if (from == DType::BFloat16) simd().widen_bf16(s, d, n);
+        else simd().widen_fp16(s, d, n);
+        return;
+    }
+    float staging[kConvertChunk];
+    uint16_t* d = static_cast<uint16_t*>(dst);
+    for (size_t i = 0; i < n; i += kConvertChunk) {
+        const size_t count = std::min(kConvertChunk, n - i);
+        convert_run(s + i, from, staging, DType::Float32, count);
+        convert_run(staging, DType::Float32, d + i, to, count);
+    }
+}
+
+// n elements of the given dtype, step elements apart, packed into out
+static void gather(const char* in, DType dtype, int step, int n, char* out) {
+    if (dtype == DType::Float32) {
+        const float* s = reinterpret_cast<const float*>(in);
+        float* d = reinterpret_cast<float*>(out);
+        for (int j = 0; j < n; ++j) d[j] = s[static_cast<long>(j) * step];
+    } else {
+        const uint16_t* s = reinterpret_cast<const uint16_t*>(in);
+        uint16_t* d = reinterpret_cast<uint16_t*>(out);
+        for (int j = 0; j < n; ++j) d[j] = s[static_cast<long>(j) * step];
+    }
+}
+
+// address of a tensor's first element (offset already applied)
+static char* element_bytes(const Tensor& t) {
+    if (t.dtype() == DType::Float32) return reinterpret_cast<char*>(t.storage->data() + t.offset);
+    return reinterpret_cast<char*>(t.storage->half_data() + t.offset);
+}
+
+void convert_kernel(const Tensor& src, Tensor& dst) {
+    const DType from = src.dtype();
+    const DType to = dst.dtype();
+    const size_t from_size = dtype_size(from);
+    const size_t to_size = dtype_size(to);
+    const char* in = element_bytes(src);
+    char* out = element_bytes(dst);
+
+    if (src.is_contiguous()) {
+        convert_run(in, from, out, to, src.numel());
+        return;
+    }
+
+    // strided source: row by row, strided rows gathered in chunks first
+    size_t written = 0;
+    const int* strides = src.strides.data();
+    for_each_row<1>(src.shape, {strides}, {0},
+        [&](const std::array<size_t, 1>& off, int count, const std::array<int, 1>& step) {
+            if (step[0] == 1) {
+                convert_run(in + off[0] * from_size, from, out + written * to_size, to, count);
+                written += count;
+                return;
+            }
+            alignas(float) char staging[kConvertChunk * sizeof(float)];
+            for (int j0 = 0; j0 < count; j0 += static_cast<int>(kConvertChunk)) {
+                const int n = std::min(count - j0, static_cast<int>(kConvertChunk));
+                gather(in + (off[0] + static_cast<size_t>(j0) * step[0]) * from_size, from, step[0], n, staging);
+                convert_run(staging, from, out + written * to_size, to, n);
+                written += n;
+            }
+        });
+}
+
+CastOp::CastOp(const std::shared_ptr<Tensor>& input) {
+    inputs.push_back(input);
+}
+
+void CastOp::backward(Tensor& grad_output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("CastOp: input expired");
+    if (!input->requires_grad || !needs_input_grad(0)) return;
+
+    if (input->grad.empty()) input->grad.resize(input->numel(), 0.0f);
+    simd().accumulate(grad_output.grad.data(), input->grad.data(), input->grad.size());
+}
+
+void CastOp::recompute(Tensor& output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("CastOp: input expired");
+    convert_kernel(*input, output);
+}
+
+std::shared_ptr<Tensor> to_dtype(const std::shared_ptr<Tensor>& x, DType dtype) {
+    if (x->dtype() == dtype && x->is_contiguous()) return x;
+    ProfileScope profile("cast", "forward");
+
+    auto result = current_graph().make_tensor(x->shape, GradMode::track(x->requires_grad), dtype);
+    convert_kernel(*x, *result);
+
+    if (result->requires_grad) {
+        Graph& graph = current_graph();
+        auto op = graph.make_op<CastOp>(x);
+        result->set_creator(op);
+
+        // register with the current graph to prevent premature destruction
+        graph.add_tensor(result);
+        graph.add_op(op);
+    }
+
+    return result;
+}
+
+std::shared_ptr<Tensor> as_float32(const std::shared_ptr<Tensor>& x) {
+    if (!x || x->dtype() == DType::Float32) return x;
+    return to_dtype(x, DType::Float32);
+}
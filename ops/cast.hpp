@@ -0,0 +1,40 @@
+/*
+ * cast.hpp - dtype conversion between float32 and 16-bit tensor storage
+ *
+ * to_dtype() copies a tensor into packed storage of another dtype (dtype.hpp):
+ * - float32 -> bfloat16 / float16 rounds to nearest even through the simd kernels
+ * - the cast is differentiable: gradients are float32 on both sides and pass straight through
+ * as_float32() is what the element-wise ops call on their operands, so a 16-bit tensor can be fed
+ * to any op; matmul and linear skip it and read 16-bit operands directly (ops/gemm.hpp)
+ *
+ * usage:
+ *     auto w16 = to_dtype(w, DType::BFloat16);  // half the bytes, same shape
+ *     auto y = linear(x, w16, b);              // accumulates in float32
+ */
+
+#pragma once
+#include "../tensor.hpp"
+#include "../op.hpp"
+
+class CastOp : public Op {
+public:
+    explicit CastOp(const std::shared_ptr<Tensor>& input);
+
+    // input.grad += grad_output (both float32, in the same packed order)
+    void backward(Tensor& grad_output) override;
+
+    // converts the input again into the existing output (graph replay)
+    void recompute(Tensor& output) override;
+
+    const char* name() const override { return "cast"; }
+};
+
+// copies src (any layout and dtype) into the packed elements of dst, converting on the way
+// dst must have src's shape; also serves contiguous() and Module::to
+void convert_kernel(const Tensor& src, Tensor& dst);
+
+// packed copy of x with the given element type (x itself when it already is packed in that dtype)
+std::shared_ptr<Tensor> to_dtype(const std::shared_ptr<Tensor>& x, DType dtype);
+
+// x widened to float32, or x itself when it is float32 already (or null)
+std::shared_ptr<Tensor> as_float32(const std::shared_ptr<Tensor>& x);
@@ -5,17 +5,20 @@
  * - forward pass: element-wise division by scalar with safety checks
  * - backward pass: gradient follows chain rule: ∂(a/c)/∂a = 1/c
  * - normalization: essential for scaling tensors and loss computation
+ * - tensor / tensor division shares the broadcasting engine of elementwise.hpp
  */
 
 #include "div.hpp"
 #include "../op.hpp"
 #include "../tensor.hpp"
 #include "../graph.hpp"
+#include "../grad_mode.hpp"
+#include "../profiler.hpp"
+#include "elementwise.hpp"
+#include "cast.hpp"
 #include <iostream>
 #include <memory>
 
-extern Graph global_graph;
-
 // constructor stores input tensor reference and scalar divisor
 // weak references prevent circular dependencies while maintaining access to input data
 DivOp::DivOp(std::shared_ptr<Tensor> input, float scalar_) : scalar(scalar_) {
@@ -27,41 +30,111 @@ void DivOp::backward(Tensor& grad_output) {
     if (!input_const) return;
 
     auto input = std::const_pointer_cast<Tensor>(input_const);
-    if (input->requires_grad) {
-        if (input->grad.empty()) input->grad.resize(input->data.size(), 0.0f);
-        for (size_t i = 0; i < input->data.size(); ++i)
-            input->grad[i] += grad_output.grad[i] / scalar; // ∂(a/c)/∂a = 1/c
+    if (input->requires_grad && needs_input_grad(0)) {
+        if (input->grad.empty()) input->grad.resize(input->numel(), 0.0f);
+        simd().accumulate_div(grad_output.grad.data(), scalar, input->grad.data(), input->grad.size()); // ∂(a/c)/∂a = 1/c
     }
+}
 
-    // propagate gradients to input tensor's creator to maintain gradient chain
-    // critical fix: check if creator is different to prevent infinite loops
-    auto input_creator = input->creator.lock();
-    if (input_creator && input_creator.get() != this) {
-        // only propagate if the creator is different from this operation
-        input_creator->backward(*input);
+// element-wise division by scalar into a preallocated output (strided inputs are read in place)
+static void div_kernel(const Tensor& input, float scalar, Tensor& output) {
+    float* out = output.storage->data() + output.offset;
+    if (input.is_contiguous()) {
+        simd().div_scalar(input.storage->data() + input.offset, scalar, out, input.numel());
+    } else {
+        for_each_element(input, [out, scalar](size_t i, float v) { out[i] = v / scalar; });
     }
 }
 
+void DivOp::recompute(Tensor& output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("DivOp: input expired");
+    div_kernel(*input, scalar, output);
+}
+
 std::shared_ptr<Tensor> div(std::shared_ptr<Tensor> input, float scalar) {
+    ProfileScope profile("div", "forward");
+    input = as_float32(input);
+
     // safety check: prevent division by zero which would cause undefined behavior
     if (scalar == 0.0f) throw std::runtime_error("div: division by zero");
 
     // create output tensor with same shape and gradient requirements as input
-    auto result = std::make_shared<Tensor>(input->shape, input->requires_grad);
-    result->data.resize(input->data.size());
+    auto result = current_graph().make_tensor(input->shape, GradMode::track(input->requires_grad));
+    div_kernel(*input, scalar, *result);
+
+    if (result->requires_grad) {
+        Graph& graph = current_graph();
+        // create div operation and integrate with computational graph
+        auto op = graph.make_op<DivOp>(input, scalar);
+        result->set_creator(op);
+
+        // register with the current graph for lifetime management
+        graph.add_tensor(result);
+        graph.add_op(op);
+    }
+
+    return result;
+}
+
+ElementwiseDivOp::ElementwiseDivOp(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b) {
+    inputs.push_back(a);
+    inputs.push_back(b);
+}
+
+void ElementwiseDivOp::backward(Tensor& grad_output) {
+    auto a_const = inputs[0].lock();
+    auto b_const = inputs[1].lock();
+    if (!a_const || !b_const) return;
+
+    auto a = std::const_pointer_cast<Tensor>(a_const);
+    auto b = std::const_pointer_cast<Tensor>(b_const);
+
+    if (a->requires_grad && needs_input_grad(0)) {
+        if (a->grad.empty()) a->grad.resize(a->numel(), 0.0f);
+        reduce_broadcast(grad_output.shape, grad_output.grad.data(), *a, *b, a->shape, a->grad.data(),
+                         [](float g, float, float bv) { return g / bv; });  // ∂(a/b)/∂a = 1/b
+    }
+
+    if (b->requires_grad && needs_input_grad(1)) {
+        if (b->grad.empty()) b->grad.resize(b->numel(), 0.0f);
+        reduce_broadcast(grad_output.shape, grad_output.grad.data(), *a, *b, b->shape, b->grad.data(),
+                         [](float g, float av, float bv) { return -g * av / (bv * bv); });  // ∂(a/b)/∂b = -a/b^2
+    }
+}
+
+// a / b into a preallocated output, shared by div() and graph replay
+static void div_tensor_kernel(const Tensor& a, const Tensor& b, Tensor& out) {
+    broadcast_binary(a, b, out, [](float x, float y) { return x / y; }, simd().div);
+}
+
+void ElementwiseDivOp::recompute(Tensor& output) {
+    auto a = inputs[0].lock();
+    auto b = inputs[1].lock();
+    if (!a || !b) throw std::runtime_error("ElementwiseDivOp: input expired");
+    div_tensor_kernel(*a, *b, output);
+}
+
+std::shared_ptr<Tensor> div(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b) {
+    ProfileScope profile("div", "forward");
+    a = as_float32(a);
+    b = as_float32(b);
+
+    // numpy-style broadcasting: size-1 and missing leading dims repeat
+    std::vector<int> output_shape = broadcast_shape(a->shape, b->shape);
 
-    // perform element-wise division by scalar
-    for (size_t i = 0; i < result->data.size(); ++i)
-        result->data[i] = input->data[i] / scalar;
+    auto result = current_graph().make_tensor(output_shape, GradMode::track(a->requires_grad || b->requires_grad));
+    div_tensor_kernel(*a, *b, *result);
 
     if (result->requires_grad) {
+        Graph& graph = current_graph();
         // create div operation and integrate with computational graph
-        auto op = std::make_shared<DivOp>(input, scalar);
+        auto op = graph.make_op<ElementwiseDivOp>(a, b);
         result->set_creator(op);
 
-        // register with global graph for lifetime management
-        global_graph.add_tensor(result);
-        global_graph.add_op(op);
+        // register with the current graph for lifetime management
+        graph.add_tensor(result);
+        graph.add_op(op);
     }
 
     return result;
@@ -5,6 +5,7 @@
  * - forward pass: element-wise division by scalar value
  * - backward pass: gradient follows chain rule: ∂(a/c)/∂a = 1/c
  * - normalization: commonly used for scaling tensors and loss computation
+ * - tensor / tensor division broadcasts like add, sub and mul (per-feature scales)
  */
 
 #pragma once
@@ -14,11 +15,28 @@
 // div operation handles element-wise division by scalar values
 // primarily used for normalization and scaling operations
 class DivOp : public Op {
+    float scalar;  // divisor applied in forward, needed for the 1/c gradient
+
 public:
     DivOp(std::shared_ptr<Tensor> a, float scalar);
     void backward(Tensor& grad_output) override;
+    void recompute(Tensor& output) override;
+    const char* name() const override { return "div"; }
 };
 
 // global div function creates div operations and integrates with computational graph
 // this is the user-facing interface for tensor division operations
 std::shared_ptr<Tensor> div(std::shared_ptr<Tensor> a, float scalar);
+
+// element-wise division between tensors with numpy-style broadcasting
+// ∂(a/b)/∂a = 1/b, ∂(a/b)/∂b = -a/b^2
+class ElementwiseDivOp : public Op {
+public:
+    ElementwiseDivOp(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b);
+    void backward(Tensor& grad_output) override;
+    void recompute(Tensor& output) override;
+    const char* name() const override { return "div"; }
+};
+
+// a / b with broadcasting, the tensor counterpart of div(a, scalar)
+std::shared_ptr<Tensor> div(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b);
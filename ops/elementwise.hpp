@@ -0,0 +1,202 @@
+/*
+ * elementwise.hpp - element visitors shared by the element-wise kernels
+ *
+ * these helpers let every forward/backward loop read strided views directly:
+ * - fn receives the packed (row-major) index i and the element value(s)
+ * - packed operands take a plain flat loop (the fast path)
+ * - strided operands are walked row by row through for_each_row (strided.hpp)
+ *
+ * - binary ops broadcast numpy-style through stride-0 operands (broadcast_binary), and their
+ *   backwards sum gradients back down to each operand's shape (reduce_broadcast)
+ *
+ * IMPORTANT: output and gradient buffers are always packed, so writing out[i] / grad[i] is safe
+ */
+
+#pragma once
+#include "../tensor.hpp"
+#include "../strided.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// visits every element of two operands given by raw layouts over the same iteration shape
+// strides may contain zeros, which repeats an operand along that dimension (broadcasting)
+template <typename Fn>
+void zip_strided(const std::vector<int>& shape,
+                 const float* a, const int* a_strides, size_t a_offset,
+                 const float* b, const int* b_strides, size_t b_offset,
+                 Fn&& fn) {
+    size_t i = 0;
+    for_each_row<2>(shape, {a_strides, b_strides}, {a_offset, b_offset},
+        [&](const std::array<size_t, 2>& off, int count, const std::array<int, 2>& step) {
+            const float* pa = a + off[0];
+            const float* pb = b + off[1];
+            for (int j = 0; j < count; ++j, ++i) {
+                fn(i, pa[static_cast<size_t>(j) * step[0]], pb[static_cast<size_t>(j) * step[1]]);
+            }
+        });
+}
+
+// visits every element of t as fn(i, value)
+template <typename Fn>
+void for_each_element(const Tensor& t, Fn&& fn) {
+    if (t.is_contiguous()) {
+        const float* p = t.storage->data() + t.offset;
+        const size_t n = t.numel();
+        for (size_t i = 0; i < n; ++i) fn(i, p[i]);
+        return;
+    }
+
+    size_t i = 0;
+    for_each_row<1>(t.shape, {t.strides.data()}, {t.offset},
+        [&](const std::array<size_t, 1>& off, int count, const std::array<int, 1>& step) {
+            const float* p = t.storage->data() + off[0];
+            for (int j = 0; j < count; ++j, ++i) fn(i, p[static_cast<size_t>(j) * step[0]]);
+        });
+}
+
+// sum of all elements (packed tensors use the simd reduction)
+inline float sum_elements(const Tensor& t) {
+    if (t.is_contiguous()) return simd().sum(t.storage->data() + t.offset, t.numel());
+    float sum = 0.0f;
+    for_each_element(t, [&sum](size_t, float v) { sum += v; });
+    return sum;
+}
+
+// visits every element of two same-shape tensors as fn(i, a_value, b_value)
+template <typename Fn>
+void for_each_pair(const Tensor& a, const Tensor& b, Fn&& fn) {
+    if (a.is_contiguous() && b.is_contiguous()) {
+        const float* pa = a.storage->data() + a.offset;
+        const float* pb = b.storage->data() + b.offset;
+        const size_t n = a.numel();
+        for (size_t i = 0; i < n; ++i) fn(i, pa[i], pb[i]);
+        return;
+    }
+
+    zip_strided(a.shape, a.storage->data(), a.strides.data(), a.offset,
+                b.storage->data(), b.strides.data(), b.offset, fn);
+}
+
+// packed simd kernel computing out = a op b (SimdKernels::add, sub, mul, div)
+using VectorBinaryFn = void (*)(const float*, const float*, float*, size_t);
+
+// numpy-style result shape of a binary op: shapes are aligned from the right, and each pair of
+// sizes must match or contain a 1 (which is repeated); missing leading dims count as 1
+inline std::vector<int> broadcast_shape(const std::vector<int>& a, const std::vector<int>& b) {
+    std::vector<int> shape(std::max(a.size(), b.size()));
+    for (size_t d = 0; d < shape.size(); ++d) {
+        const int da = d < a.size() ? a[a.size() - 1 - d] : 1;
+        const int db = d < b.size() ? b[b.size() - 1 - d] : 1;
+        if (da != db && da != 1 && db != 1) {
+            throw std::runtime_error("broadcast: incompatible shapes");
+        }
+        shape[shape.size() - 1 - d] = da == 1 ? db : da;
+    }
+    return shape;
+}
+
+// strides that read an operand of the given shape/strides over out_shape:
+// right-aligned, 0 for missing and size-1 dims so those elements repeat
+inline void broadcast_strides(const std::vector<int>& shape, const int* strides,
+                              const std::vector<int>& out_shape, int* out) {
+    const size_t lead = out_shape.size() - shape.size();
+    for (size_t d = 0; d < out_shape.size(); ++d) {
+        out[d] = d < lead || shape[d - lead] == 1 ? 0 : strides[d - lead];
+    }
+}
+
+// writes out = op(a, b) under numpy broadcasting rules (out already has the result shape)
+// - packed same-shape operands: one vector_op over the whole buffer
+// - otherwise a strided walk over out with stride-0 repeats, never expanding an operand:
+//   rows where every operand advances by 1 go through vector_op (e.g. matrix + bias row),
+//   the rest (a repeated scalar, a transposed view) through op
+template <typename BinaryFn>
+void broadcast_binary(const Tensor& a, const Tensor& b, Tensor& out, BinaryFn&& op, VectorBinaryFn vector_op) {
+    if (a.shape == b.shape && a.is_contiguous() && b.is_contiguous()) {
+        vector_op(a.storage->data() + a.offset, b.storage->data() + b.offset,
+                  out.storage->data() + out.offset, out.numel());
+        return;
+    }
+    if (out.shape.size() > kMaxStridedDims) {
+        throw std::runtime_error("broadcast: tensor rank exceeds kMaxStridedDims");
+    }
+
+    int a_strides[kMaxStridedDims];
+    int b_strides[kMaxStridedDims];
+    int out_strides[kMaxStridedDims];
+    broadcast_strides(a.shape, a.strides.data(), out.shape, a_strides);
+    broadcast_strides(b.shape, b.strides.data(), out.shape, b_strides);
+    contiguous_strides(out.shape, out_strides);
+
+    const float* pa = a.storage->data();
+    const float* pb = b.storage->data();
+    float* po = out.storage->data();
+    for_each_row<3>(out.shape, {a_strides, b_strides, out_strides}, {a.offset, b.offset, out.offset},
+        [&](const std::array<size_t, 3>& off, int count, const std::array<int, 3>& step) {
+            const float* ra = pa + off[0];
+            const float* rb = pb + off[1];
+            float* ro = po + off[2];
+            if (step[0] == 1 && step[1] == 1) {
+                vector_op(ra, rb, ro, count);
+            } else if (step[1] == 0) {
+                const float y = *rb;
+                for (int j = 0; j < count; ++j) ro[j] = op(ra[static_cast<size_t>(j) * step[0]], y);
+            } else if (step[0] == 0) {
+                const float x = *ra;
+                for (int j = 0; j < count; ++j) ro[j] = op(x, rb[static_cast<size_t>(j) * step[1]]);
+            } else {
+                for (int j = 0; j < count; ++j) {
+                    ro[j] = op(ra[static_cast<size_t>(j) * step[0]], rb[static_cast<size_t>(j) * step[1]]);
+                }
+            }
+        });
+}
+
+// backward counterpart of broadcast_binary: reduces a gradient over the output shape down to
+// one operand's shape, dst[k] += sum of term(g, a, b) over every output element that read k
+// - grad_out is the packed gradient of an output of shape out_shape
+// - a and b are the forward operands (read with broadcasting, for product/quotient rules)
+// - dst is the packed gradient buffer of the operand with the given shape
+// rows that fold into one dst element are summed first and added once
+template <typename TermFn>
+void reduce_broadcast(const std::vector<int>& out_shape, const float* grad_out, const Tensor& a, const Tensor& b,
+                      const std::vector<int>& shape, float* dst, TermFn&& term) {
+    if (out_shape.size() > kMaxStridedDims) {
+        throw std::runtime_error("broadcast: tensor rank exceeds kMaxStridedDims");
+    }
+
+    int g_strides[kMaxStridedDims];
+    int a_strides[kMaxStridedDims];
+    int b_strides[kMaxStridedDims];
+    int packed[kMaxStridedDims];
+    int dst_strides[kMaxStridedDims];
+    contiguous_strides(out_shape, g_strides);
+    broadcast_strides(a.shape, a.strides.data(), out_shape, a_strides);
+    broadcast_strides(b.shape, b.strides.data(), out_shape, b_strides);
+    contiguous_strides(shape, packed);
+    broadcast_strides(shape, packed, out_shape, dst_strides);
+
+    const float* pa = a.storage->data();
+    const float* pb = b.storage->data();
+    for_each_row<4>(out_shape, {g_strides, a_strides, b_strides, dst_strides}, {0, a.offset, b.offset, 0},
+        [&](const std::array<size_t, 4>& off, int count, const std::array<int, 4>& step) {
+            const float* rg = grad_out + off[0];
+            const float* ra = pa + off[1];
+            const float* rb = pb + off[2];
+            float* rd = dst + off[3];
+            // the innermost row of a packed buffer advances by 1 (or 0 when it is broadcast)
+            if (step[3] == 0) {
+                float sum = 0.0f;
+                for (int j = 0; j < count; ++j) {
+                    sum += term(rg[j], ra[static_cast<size_t>(j) * step[1]], rb[static_cast<size_t>(j) * step[2]]);
+                }
+                *rd += sum;
+            } else {
+                for (int j = 0; j < count; ++j) {
+                    rd[j] += term(rg[j], ra[static_cast<size_t>(j) * step[1]], rb[static_cast<size_t>(j) * step[2]]);
+                }
+            }
+        });
+}
@@ -0,0 +1,271 @@
+/*
+ * gemm.cpp - blocked gemm: panel packing plus an MR x NR register microkernel
+ *
+ * loop nest (outermost first): NC columns of b, KC depth slice, MC rows of a, then NR x MR tiles
+ * - a packed KC x NR panel of b stays in L1 while every MR-row panel of a streams past it
+ * - a packed MC x KC block of a stays in L2 for the whole NC column block
+ * large products are split into MC-row (or kColumnGrain-column) slices across the thread pool;
+ * every element of c sees the same depth order either way, so the bits match the serial result
+ * short, narrow and deep products (the first layer's weight gradient x^T g: a few rows and
+ * columns, the whole batch as depth) are split along k instead: each depth slice goes to its
+ * own partial c, summed in slice order at the end. the split depends on the shape alone, so
+ * those products also give the same bits for any pool size, 1 included
+ * 16-bit operands only change the packing loads, the panels are float32 either way
+ */
+
+#include "gemm.hpp"
+#include "../tensor.hpp"
+#include "../thread_pool.hpp"
+#include <algorithm>
+#include <vector>
+
+static constexpr int MR = 6;     // rows of the register tile
+static constexpr int NR = 8;     // columns of the register tile (12 SSE accumulators)
+static constexpr int MC = 120;   // rows of a per packed block (a multiple of MR)
+static constexpr int KC = 256;   // depth per packed block
+static constexpr int NC = 2048;  // columns of b per packed block
+
+static constexpr int kColumnGrain = 256;          // columns per slice when m is too short to split
+static constexpr int kDepthGrain = 4096;          // least depth per slice when only k is long
+static constexpr int kMaxDepthSlices = 16;        // bounds the partial c buffers of a depth split
+static constexpr long kParallelFlops = 1L << 21;  // smaller products stay on the calling thread
+
+// per-thread packing scratch, sized on first use
+struct PackBuffers {
+    std::vector<float> a;
+    std::vector<float> b;
+};
+
+static PackBuffers& pack_buffers() {
+    static thread_local PackBuffers buffers;
+    return buffers;
+}
+
+// element i of a float32 / bfloat16 / float16 operand, widened to float32
+struct LoadFloat32 {
+    const float* p;
+    float operator()(long i) const { return p[i]; }
+};
+
+struct LoadBFloat16 {
+    const uint16_t* p;
+    float operator()(long i) const { return bf16_to_float(p[i]); }
+};
+
+struct LoadFloat16 {
+    const uint16_t* p;
+    float operator()(long i) const { return fp16_to_float(p[i]); }
+};
+
+// calls fn with the loader matching the operand's dtype
+template <typename Fn>
+static void with_loader(const MatrixView& m, Fn&& fn) {
+    switch (m.dtype) {
+    case DType::Float32: fn(LoadFloat32{static_cast<const float*>(m.data)}); break;
+    case DType::BFloat16: fn(LoadBFloat16{static_cast<const uint16_t*>(m.data)}); break;
+    case DType::Float16: fn(LoadFloat16{static_cast<const uint16_t*>(m.data)}); break;
+    }
+}
+
+// copies rows [i0, i0 + mc) x depth [p0, p0 + kc) of a into MR-row panels,
+// each panel stored depth-major (MR values per depth step), rows past mc padded with zeros
+template <typename Load>
+static void pack_a(const MatrixView& a, Load load, int i0, int p0, int mc, int kc, float* out) {
+    for (int ir = 0; ir < mc; ir += MR) {
+        const int rows = std::min(MR, mc - ir);
+        for (int p = 0; p < kc; ++p) {
+            const long src = static_cast<long>(p0 + p) * a.col_stride;
+            for (int r = 0; r < rows; ++r) out[r] = load(src + static_cast<long>(i0 + ir + r) * a.row_stride);
+            for (int r = rows; r < MR; ++r) out[r] = 0.0f;
+            out += MR;
+        }
+    }
+}
+
+// copies depth [p0, p0 + kc) x columns [j0, j0 + nc) of b into NR-column panels,
+// each panel stored depth-major (NR values per depth step), columns past nc padded with zeros
+template <typename Load>
+static void pack_b(const MatrixView& b, Load load, int p0, int j0, int kc, int nc, float* out) {
+    for (int jr = 0; jr < nc; jr += NR) {
+        const int cols = std::min(NR, nc - jr);
+        for (int p = 0; p < kc; ++p) {
+            const long src = static_cast<long>(p0 + p) * b.row_stride + static_cast<long>(j0 + jr) * b.col_stride;
+            if (b.col_stride == 1) {
+                for (int c = 0; c < cols; ++c) out[c] = load(src + c);
+            } else {
+                for (int c = 0; c < cols; ++c) out[c] = load(src + static_cast<long>(c) * b.col_stride);
+            }
+            for (int c = cols; c < NR; ++c) out[c] = 0.0f;
+            out += NR;
+        }
+    }
+}
+
+// c[rows, cols] (+)= packed a panel * packed b panel over kc depth steps
+// the full MR x NR tile is accumulated in registers, only the valid corner is written back
+// epilogue is only passed with the last depth slice (bias already offset to the tile's columns)
+static void micro_kernel(int kc, const float* a, const float* b, float* c, int ldc,
+                         int rows, int cols, bool accumulate, const GemmEpilogue* epilogue) {
+    float acc[MR][NR] = {};
+    for (int p = 0; p < kc; ++p) {
+        for (int r = 0; r < MR; ++r) {
+            const float av = a[r];
+            for (int j = 0; j < NR; ++j) acc[r][j] += av * b[j];
+        }
+        a += MR;
+        b += NR;
+    }
+
+    for (int r = 0; r < rows; ++r) {
+        float* c_row = c + static_cast<long>(r) * ldc;
+        if (accumulate) {
+            for (int j = 0; j < cols; ++j) c_row[j] += acc[r][j];
+        } else {
+            for (int j = 0; j < cols; ++j) c_row[j] = acc[r][j];
+        }
+        if (!epilogue) continue;
+        if (epilogue->bias) {
+            for (int j = 0; j < cols; ++j) c_row[j] += epilogue->bias[j];
+        }
+        if (epilogue->relu) {
+            for (int j = 0; j < cols; ++j) c_row[j] = c_row[j] > 0.0f ? c_row[j] : 0.0f;
+        }
+    }
+}
+
+static void gemm_serial(int m, int n, int k, MatrixView a, MatrixView b, float* c, int ldc, bool accumulate,
+                        const GemmEpilogue& epilogue) {
+    const bool has_epilogue = epilogue.bias || epilogue.relu;
+    if (k <= 0) {
+        // empty product: nothing to add, or a zero result (still biased and clamped)
+        for (int i = 0; i < m; ++i) {
+            float* c_row = c + static_cast<long>(i) * ldc;
+            if (!accumulate) std::fill(c_row, c_row + n, 0.0f);
+            for (int j = 0; j < n; ++j) {
+                if (epilogue.bias) c_row[j] += epilogue.bias[j];
+                if (epilogue.relu) c_row[j] = c_row[j] > 0.0f ? c_row[j] : 0.0f;
+            }
+        }
+        return;
+    }
+
+    PackBuffers& buffers = pack_buffers();
+    const int kc_max = std::min(KC, k);
+    const size_t a_size = static_cast<size_t>((std::min(MC, m) + MR - 1) / MR) * MR * kc_max;
+    const size_t b_size = static_cast<size_t>((std::min(NC, n) + NR - 1) / NR) * NR * kc_max;
+    if (buffers.a.size() < a_size) buffers.a.resize(a_size);
+    if (buffers.b.size() < b_size) buffers.b.resize(b_size);
+    float* packed_a = buffers.a.data();
+    float* packed_b = buffers.b.data();
+
+    for (int j0 = 0; j0 < n; j0 += NC) {
+        const int nc = std::min(NC, n - j0);
+        for (int p0 = 0; p0 < k; p0 += KC) {
+            const int kc = std::min(KC, k - p0);
+            // later depth slices add onto the partial sums of the first
+            const bool add = accumulate || p0 > 0;
+            const bool last = p0 + kc == k;
+            with_loader(b, [&](auto load) { pack_b(b, load, p0, j0, kc, nc, packed_b); });
+
+            for (int i0 = 0; i0 < m; i0 += MC) {
+                const int mc = std::min(MC, m - i0);
+                with_loader(a, [&](auto load) { pack_a(a, load, i0, p0, mc, kc, packed_a); });
+
+                for (int jr = 0; jr < nc; jr += NR) {
+                    const float* b_panel = packed_b + static_cast<size_t>(jr) * kc;
+                    GemmEpilogue tile_epilogue = epilogue;
+                    if (epilogue.bias) tile_epilogue.bias += j0 + jr;
+                    const GemmEpilogue* finish = has_epilogue && last ? &tile_epilogue : nullptr;
+                    for (int ir = 0; ir < mc; ir += MR) {
+                        const float* a_panel = packed_a + static_cast<size_t>(ir) * kc;
+                        float* c_tile = c + static_cast<long>(i0 + ir) * ldc + j0 + jr;
+                        micro_kernel(kc, a_panel, b_panel, c_tile, ldc,
+                                     std::min(MR, mc - ir), std::min(NR, nc - jr), add, finish);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// c (+)= a * b as fixed depth slices into per-slice partial products, summed in slice order
+// the partials live on the calling thread and grow once, like the packing scratch
+static void gemm_depth_split(int m, int n, int k, MatrixView a, MatrixView b, float* c, int ldc, bool accumulate,
+                             const GemmEpilogue& epilogue) {
+    // a whole number of KC blocks per slice, from the shape only
+    const int least = std::max(kDepthGrain, (k + kMaxDepthSlices - 1) / kMaxDepthSlices);
+    const int slice = (least + KC - 1) / KC * KC;
+    const int slices = (k + slice - 1) / slice;
+    const size_t tile = static_cast<size_t>(m) * n;
+
+    static thread_local std::vector<float> partials;
+    if (partials.size() < tile * slices) partials.resize(tile * slices);
+    float* partial = partials.data();
+
+    parallel_for(0, slices, 1, [&](size_t lo, size_t hi) {
+        for (size_t s = lo; s < hi; ++s) {
+            const long p0 = static_cast<long>(s) * slice;
+            const int kc = static_cast<int>(std::min<long>(slice, k - p0));
+            gemm_serial(m, n, kc, a.advanced(p0 * a.col_stride), b.advanced(p0 * b.row_stride), partial + s * tile,
+                        n, false, {});
+        }
+    });
+
+    for (int i = 0; i < m; ++i) {
+        float* c_row = c + static_cast<long>(i) * ldc;
+        for (int j = 0; j < n; ++j) {
+            const size_t at = static_cast<size_t>(i) * n + j;
+            float total = partial[at];
+            for (int s = 1; s < slices; ++s) total += partial[s * tile + at];
+            float value = accumulate ? c_row[j] + total : total;
+            if (epilogue.bias) value += epilogue.bias[j];
+            if (epilogue.relu) value = value > 0.0f ? value : 0.0f;
+            c_row[j] = value;
+        }
+    }
+}
+
+void gemm(int m, int n, int k, MatrixView a, MatrixView b, float* c, int ldc, bool accumulate,
+          const GemmEpilogue& epilogue) {
+    if (m <= 0 || n <= 0) return;
+    if (static_cast<long>(m) * n * std::max(k, 1) < kParallelFlops) {
+        gemm_serial(m, n, k, a, b, c, ldc, accumulate, epilogue);
+        return;
+    }
+
+    // neither rows nor columns give more than one slice, but the depth does
+    // (checked before the thread count: the summation order must not depend on it)
+    if (m < 2 * MC && n <= kColumnGrain && k >= 2 * kDepthGrain) {
+        gemm_depth_split(m, n, k, a, b, c, ldc, accumulate, epilogue);
+        return;
+    }
+
+    if (ThreadPool::num_threads() == 1) {
+        gemm_serial(m, n, k, a, b, c, ldc, accumulate, epilogue);
+        return;
+    }
+
+    if (m >= 2 * MC) {
+        // row slices: each thread packs its own a blocks, b panels are packed once per slice
+        parallel_for(0, m, MC, [&](size_t lo, size_t hi) {
+            const MatrixView rows = a.advanced(static_cast<long>(lo) * a.row_stride);
+            gemm_serial(static_cast<int>(hi - lo), n, k, rows, b, c + static_cast<long>(lo) * ldc, ldc,
+                        accumulate, epilogue);
+        });
+    } else {
+        // short and wide (the weight gradients of small batches): column slices instead
+        parallel_for(0, n, kColumnGrain, [&](size_t lo, size_t hi) {
+            const MatrixView cols = b.advanced(static_cast<long>(lo) * b.col_stride);
+            GemmEpilogue slice_epilogue = epilogue;
+            if (epilogue.bias) slice_epilogue.bias += lo;
+            gemm_serial(m, static_cast<int>(hi - lo), k, a, cols, c + lo, ldc, accumulate, slice_epilogue);
+        });
+    }
+}
+
+MatrixView matrix_view(const Tensor& t) {
+    if (t.dtype() == DType::Float32) {
+        return {t.storage->data() + t.offset, t.strides[0], t.strides[1]};
+    }
+    return {t.storage->half_data() + t.offset, t.strides[0], t.strides[1], t.dtype()};
+}
@@ -0,0 +1,53 @@
+/*
+ * gemm.hpp - cache-blocked, register-tiled matrix multiply shared by matmul and linear
+ *
+ * computes c = a * b (or c += a * b) for [m, k] x [k, n] operands given by raw strides:
+ * - operands are read through (row_stride, col_stride), so a transposed operand is just
+ *   swapped strides - a^T * g and g * b^T in the backward passes never materialize a transpose
+ * - blocks of a (MC x KC) and b (KC x NC) are packed into contiguous panels sized for the
+ *   L2 / L1 caches, with a zero-padded edge so the microkernel never branches on bounds
+ * - the microkernel keeps an MR x NR tile of c in registers across the whole KC loop
+ * - an optional epilogue adds a bias row and applies relu while the last depth slice of a
+ *   tile is written back, so linear layers never make a second pass over their output
+ *
+ * - a and b may hold bfloat16 / float16 elements (dtype.hpp): they are widened while packing,
+ *   so the microkernel always multiplies and accumulates in float32
+ *
+ * IMPORTANT: c is a packed row-major [m, n] float buffer with leading dimension ldc
+ * the packing scratch is per thread and grows once, so steady-state calls never allocate
+ */
+
+#pragma once
+#include "../dtype.hpp"
+
+class Tensor;
+
+// read-only strided matrix: element (r, c) lives at data[r * row_stride + c * col_stride],
+// with elements of the given dtype
+struct MatrixView {
+    const void* data;
+    int row_stride;
+    int col_stride;
+    DType dtype = DType::Float32;
+
+    MatrixView transposed() const { return {data, col_stride, row_stride, dtype}; }
+
+    // the same matrix starting the given number of elements further into data
+    MatrixView advanced(long elements) const {
+        const char* base = static_cast<const char*>(data) + elements * static_cast<long>(dtype_size(dtype));
+        return {base, row_stride, col_stride, dtype};
+    }
+};
+
+// a 2-d tensor (possibly a strided view, any dtype) as a gemm operand
+MatrixView matrix_view(const Tensor& t);
+
+// applied to each element of c once its full sum is known: c = max(0, c + bias[col])
+struct GemmEpilogue {
+    const float* bias = nullptr;  // packed [n] row added to every row of c, or none
+    bool relu = false;
+};
+
+// c[m, n] = a[m, k] * b[k, n], or c += a * b when accumulate is set (gradient buffers)
+void gemm(int m, int n, int k, MatrixView a, MatrixView b, float* c, int ldc, bool accumulate,
+          const GemmEpilogue& epilogue = {});
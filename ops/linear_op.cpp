@@ -1,30 +1,53 @@
 // Author: Nico Boving
 // linear operation
 #include "linear_op.hpp"
+#include "gemm.hpp"
+#include "simd.hpp"
+#include "cast.hpp"
 #include <iostream>
-#include <algorithm>  
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "../autocast.hpp"
 #include "../graph.hpp"
+#include "../grad_mode.hpp"
+#include "../logging.hpp"
+#include "../profiler.hpp"
 #include <memory>
 
-extern Graph global_graph;
-
 LinearOp::LinearOp(const std::shared_ptr<Tensor>& input_,
                    const std::shared_ptr<Tensor>& weight_,
-                   const std::shared_ptr<Tensor>& bias_)
-    : input(input_), weight(weight_), bias(bias_) {
+                   const std::shared_ptr<Tensor>& bias_,
+                   Activation activation_)
+    : input(input_), weight(weight_), bias(bias_), activation(activation_) {
     inputs.push_back(input);
     inputs.push_back(weight);
     if (bias) inputs.push_back(bias);
 }
 
+// per-thread buffer for the relu-masked output gradient, grows once
+static float* masked_grad_buffer(size_t size) {
+    static thread_local std::vector<float> buffer;
+    if (buffer.size() < size) buffer.resize(size);
+    return buffer.data();
+}
+
+// per-thread float32 rows: the gemm result before it is narrowed into a 16-bit output, and
+// a widened output row for the relu mask
+static float* staging_buffer(size_t size) {
+    static thread_local std::vector<float> buffer;
+    if (buffer.size() < size) buffer.resize(size);
+    return buffer.data();
+}
+
 void LinearOp::backward(Tensor& grad_output) {
     int batch = input->shape[0];
     int in_dim = input->shape[1];
     int out_dim = weight->shape[1];
 
     // Check grad_output size matches batch*out_dim
-    if (grad_output.grad.size() != batch * out_dim) {
-        std::cerr << "[LinearOp] ERROR: grad_output.grad size mismatch\n";
+    if (grad_output.grad.size() != static_cast<size_t>(batch) * out_dim) {
+        LOG_ERROR("[LinearOp] ERROR: grad_output.grad size mismatch");
         return;
     }
 
@@ -33,54 +56,126 @@ void LinearOp::backward(Tensor& grad_output) {
     auto weight_mut = std::const_pointer_cast<Tensor>(weight);
     std::shared_ptr<Tensor> bias_mut = bias ? std::const_pointer_cast<Tensor>(bias) : nullptr;
 
-    if (input_mut->requires_grad) {
-        if (input_mut->grad.size() != input_mut->data.size())
-            input_mut->grad.resize(input_mut->data.size(), 0.0f);
+    const bool input_grad = input_mut->requires_grad && needs_input_grad(0);
+    const bool weight_grad = weight_mut->requires_grad && needs_input_grad(1);
+    const bool bias_grad = bias_mut && bias_mut->requires_grad && needs_input_grad(2);
+    if (!input_grad && !weight_grad && !bias_grad) return;
+
+    if (bias_grad && bias_mut->grad.size() != static_cast<size_t>(bias_mut->numel()))
+        bias_mut->grad.resize(bias_mut->numel(), 0.0f);
 
+    // gradient w.r.t. the pre-activation, shared by dX, dW and db
+    const float* g_data = grad_output.grad.data();
+    if (activation == Activation::ReLU) {
+        // one sweep over the rows: mask by the output (relu(z) > 0 exactly when z > 0),
+        // and sum the masked row into db while it is still in cache
+        // (a 16-bit output is widened a row at a time; values that rounded to zero mask their gradient)
+        float* masked = masked_grad_buffer(grad_output.grad.size());
+        const DType out_dtype = grad_output.dtype();
         for (int b = 0; b < batch; ++b) {
-            for (int i = 0; i < in_dim; ++i) {
-                float grad_val = 0.0f;
-                for (int j = 0; j < out_dim; ++j) {
-                    grad_val += grad_output.grad[b * out_dim + j] * weight_mut->data[i * out_dim + j];
+            float* row = masked + static_cast<size_t>(b) * out_dim;
+            const size_t at = grad_output.offset + static_cast<size_t>(b) * out_dim;
+            const float* y = nullptr;
+            if (out_dtype == DType::Float32) {
+                y = grad_output.storage->data() + at;
+            } else {
+                float* widened = staging_buffer(out_dim);
+                const uint16_t* half = grad_output.storage->half_data() + at;
+                if (out_dtype == DType::BFloat16) {
+                    simd().widen_bf16(half, widened, out_dim);
+                } else {
+                    simd().widen_fp16(half, widened, out_dim);
                 }
-                input_mut->grad[b * in_dim + i] += grad_val;
+                y = widened;
             }
+            std::fill(row, row + out_dim, 0.0f);
+            simd().relu_backward(y, g_data + static_cast<size_t>(b) * out_dim, row, out_dim);
+            if (bias_grad) simd().accumulate(row, bias_mut->grad.data(), out_dim);
+        }
+        g_data = masked;
+    } else if (bias_grad) {
+        // sum over the batch one packed row at a time
+        for (int b = 0; b < batch; ++b) {
+            simd().accumulate(g_data + static_cast<size_t>(b) * out_dim, bias_mut->grad.data(), out_dim);
         }
     }
 
-    if (weight_mut->requires_grad) {
-        if (weight_mut->grad.size() != weight_mut->data.size())
-            weight_mut->grad.resize(weight_mut->data.size(), 0.0f);
+    // input and weight may be strided views, and bfloat16 / float16 (widened by gemm's packing)
+    const MatrixView x = matrix_view(*input);
+    const MatrixView w = matrix_view(*weight);
+    const MatrixView g{g_data, out_dim, 1};
 
-        for (int i = 0; i < in_dim; ++i) {
-            for (int j = 0; j < out_dim; ++j) {
-                float grad_val = 0.0f;
-                for (int b = 0; b < batch; ++b) {
-                    grad_val += input->data[b * in_dim + i] * grad_output.grad[b * out_dim + j];
-                }
-                weight_mut->grad[i * out_dim + j] += grad_val;
-            }
-        }
+    if (input_grad) {
+        if (input_mut->grad.size() != static_cast<size_t>(input_mut->numel()))
+            input_mut->grad.resize(input_mut->numel(), 0.0f);
+        // dX[batch, in] += G * W^T
+        gemm(batch, in_dim, out_dim, g, w.transposed(), input_mut->grad.data(), in_dim, true);
     }
 
-    if (bias_mut && bias_mut->requires_grad) {
-        if (bias_mut->grad.size() != bias_mut->data.size())
-            bias_mut->grad.resize(bias_mut->data.size(), 0.0f);
+    if (weight_grad) {
+        if (weight_mut->grad.size() != static_cast<size_t>(weight_mut->numel()))
+            weight_mut->grad.resize(weight_mut->numel(), 0.0f);
+        // dW[in, out] += X^T * G
+        gemm(in_dim, out_dim, batch, x.transposed(), g, weight_mut->grad.data(), out_dim, true);
+    }
+}
 
-        for (int j = 0; j < out_dim; ++j) {
-            float grad_val = 0.0f;
-            for (int b = 0; b < batch; ++b) {
-                grad_val += grad_output.grad[b * out_dim + j];
-            }
-            bias_mut->grad[j] += grad_val;
-        }
+// activation(x * w + b) into a preallocated [batch, out] output, shared by linear() and graph replay
+// a 16-bit output is computed into float32 staging and narrowed once at the end
+static void linear_kernel(const Tensor& x, const Tensor& w, const Tensor* b, Activation activation,
+                          Tensor& output) {
+    GemmEpilogue epilogue;
+    epilogue.bias = b ? b->storage->data() + b->offset : nullptr;
+    epilogue.relu = activation == Activation::ReLU;
+
+    const size_t n = static_cast<size_t>(x.shape[0]) * w.shape[1];
+    const DType dtype = output.dtype();
+    float* out = dtype == DType::Float32 ? output.storage->data() + output.offset : staging_buffer(n);
+    gemm(x.shape[0], w.shape[1], x.shape[1], matrix_view(x), matrix_view(w), out, w.shape[1], false, epilogue);
+
+    if (dtype == DType::BFloat16) simd().narrow_bf16(out, output.storage->half_data() + output.offset, n);
+    if (dtype == DType::Float16) simd().narrow_fp16(out, output.storage->half_data() + output.offset, n);
+}
+
+void LinearOp::recompute(Tensor& output) {
+    linear_kernel(*input, *weight, bias.get(), activation, output);
+}
+
+std::shared_ptr<Tensor> linear(const std::shared_ptr<Tensor>& input,
+                               const std::shared_ptr<Tensor>& weight,
+                               const std::shared_ptr<Tensor>& bias,
+                               Activation activation) {
+    // input and weight may stay 16-bit, but the epilogue adds a float32 bias row
+    if (bias && bias->dtype() != DType::Float32) return linear(input, weight, as_float32(bias), activation);
+
+    // mixed precision (autocast.hpp): 16-bit operands, gradients reach the float32 originals
+    const DType compute = Autocast::dtype();
+    if (compute != DType::Float32 && (input->dtype() != compute || weight->dtype() != compute)) {
+        return linear(to_dtype(input, compute), to_dtype(weight, compute), bias, activation);
     }
+    ProfileScope profile(activation == Activation::ReLU ? "linear_relu" : "linear", "forward");
 
-    // CRITICAL FIX: Propagate gradients to input tensor's creator
-    // But avoid infinite loops by checking if the creator is different
-    auto input_creator = input->creator.lock();
-    if (input_creator && input_creator.get() != this) {
-        // Only propagate if the creator is different from this operation
-        input_creator->backward(*input);
+    if (input->shape.size() != 2 || weight->shape.size() != 2 || input->shape[1] != weight->shape[0]) {
+        throw std::runtime_error("linear: expected input [batch, in] and weight [in, out]");
+    }
+    if (bias && (bias->shape.size() != 1 || bias->shape[0] != weight->shape[1] || !bias->is_contiguous())) {
+        throw std::runtime_error("linear: bias must be a packed [out] vector");
     }
+
+    const bool track = GradMode::track(input->requires_grad || weight->requires_grad ||
+                                       (bias && bias->requires_grad));
+    auto result = current_graph().make_tensor(std::vector<int>{input->shape[0], weight->shape[1]}, track, compute);
+    linear_kernel(*input, *weight, bias.get(), activation, *result);
+
+    if (result->requires_grad) {
+        Graph& graph = current_graph();
+        auto op = graph.make_op<LinearOp>(input, weight, bias, activation);
+        result->set_creator(op);
+
+        // Register tensor and op with the current graph
+        graph.add_tensor(result);
+        graph.add_op(op);
+    }
+
+    return result;
 }
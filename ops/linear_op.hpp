@@ -6,6 +6,11 @@
  * - essential for implementing fully connected layers in neural networks
  * - stores input, weight, and bias tensors for gradient computation during backpropagation
  * - enables efficient computation of linear transformations with automatic differentiation
+ * - can fuse a following relu: bias and activation are applied in the gemm epilogue, and
+ *   backward masks the incoming gradient once for dX, dW and db
+ *
+ * IMPORTANT: the fused forward writes exactly one [batch, out] tensor per layer, where
+ * matmul + add + relu wrote three
  */
 
 #pragma once
@@ -16,6 +21,12 @@
 
 class Tensor;
 
+// activation applied to the output of a linear transformation
+enum class Activation {
+    None,
+    ReLU,
+};
+
 // linear transformation operation that combines matrix multiplication and bias addition
 // this operation is the core building block for fully connected neural network layers
 class LinearOp : public Op {
@@ -29,13 +40,30 @@ public:
     // bias vector: [output_features] - the learnable offset added to each output
     std::shared_ptr<Tensor> bias;
 
+    // activation fused into the output (relu masks the gradient in backward)
+    Activation activation;
+
     // constructor stores all three tensors for gradient computation during backpropagation
     // these tensors are used to compute gradients w.r.t. weights, biases, and inputs
     LinearOp(const std::shared_ptr<Tensor>& input_,
              const std::shared_ptr<Tensor>& weight_,
-             const std::shared_ptr<Tensor>& bias_);
+             const std::shared_ptr<Tensor>& bias_,
+             Activation activation_ = Activation::None);
 
     // computes gradients w.r.t. input, weight, and bias tensors using the chain rule
     // grad_output contains gradients flowing backward from the output tensor
     void backward(Tensor& grad_output) override;
+
+    // re-runs the fused forward into the existing output buffer (graph replay)
+    void recompute(Tensor& output) override;
+
+    const char* name() const override { return activation == Activation::ReLU ? "linear_relu" : "linear"; }
 };
+
+// activation(input * weight + bias) as one op and one output tensor
+// input: [batch, in] (may be a strided view), weight: [in, out], bias: packed [out] or nullptr
+// under an AutocastGuard (autocast.hpp) input and weight are cast and the output is 16-bit
+std::shared_ptr<Tensor> linear(const std::shared_ptr<Tensor>& input,
+                               const std::shared_ptr<Tensor>& weight,
+                               const std::shared_ptr<Tensor>& bias,
+                               Activation activation = Activation::None);
@@ -1,11 +1,12 @@
 #include "matmul.hpp"
+#include "gemm.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <memory>
+#include <algorithm>
 #include "../graph.hpp"
-
-// Add global graph
-extern Graph global_graph;
+#include "../grad_mode.hpp"
+#include "../profiler.hpp"
 
 MatMulOp::MatMulOp(const std::shared_ptr<Tensor>& a, const std::shared_ptr<Tensor>& b) {
     inputs.push_back(a);
@@ -28,67 +29,55 @@ void MatMulOp::backward(Tensor& grad_output) {
     int k = a->shape[1];
     int n = b->shape[1];
 
-    if (a->requires_grad) {
-        if (a->grad.empty()) a->grad.resize(a->data.size(), 0.0f);
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < k; ++j) {
-                float grad_val = 0.0f;
-                for (int l = 0; l < n; ++l) {
-                    grad_val += grad_output.grad[i * n + l] * b->data[j * n + l];
-                }
-                a->grad[i * k + j] += grad_val; // Changed from = to += for gradient accumulation
-            }
-        }
-    }
+    // inputs may be strided views: element (r, c) lives at p[r * s0 + c * s1]
+    const MatrixView av = matrix_view(*a);
+    const MatrixView bv = matrix_view(*b);
+    const MatrixView g{grad_output.grad.data(), n, 1};
 
-    if (b->requires_grad) {
-        if (b->grad.empty()) b->grad.resize(b->data.size(), 0.0f);
-        for (int i = 0; i < k; ++i) {
-            for (int j = 0; j < n; ++j) {
-                float grad_val = 0.0f;
-                for (int l = 0; l < m; ++l) {
-                    grad_val += a->data[l * k + i] * grad_output.grad[l * n + j];
-                }
-                b->grad[i * n + j] += grad_val; // Changed from = to += for gradient accumulation
-            }
-        }
+    if (a->requires_grad && needs_input_grad(0)) {
+        if (a->grad.empty()) a->grad.resize(a->numel(), 0.0f);
+        // dA[m, k] += G[m, n] * B^T
+        gemm(m, k, n, g, bv.transposed(), a->grad.data(), k, true);
     }
 
-    // CRITICAL FIX: Propagate gradients to input tensors' creators
-    // But avoid infinite loops by checking if the creators are different
-    auto a_creator = a->creator.lock();
-    if (a_creator && a_creator.get() != this) {
-        a_creator->backward(*a);
-    }
-    auto b_creator = b->creator.lock();
-    if (b_creator && b_creator.get() != this) {
-        b_creator->backward(*b);
+    if (b->requires_grad && needs_input_grad(1)) {
+        if (b->grad.empty()) b->grad.resize(b->numel(), 0.0f);
+        // dB[k, n] += A^T * G[m, n]
+        gemm(k, n, m, av.transposed(), g, b->grad.data(), n, true);
     }
 }
 
+// [m, k] x [k, n] into a preallocated [m, n] output, shared by matmul() and graph replay
+static void matmul_kernel(const Tensor& a, const Tensor& b, Tensor& output) {
+    // inputs may be strided views (of any dtype), the output is packed and fully overwritten
+    gemm(a.shape[0], b.shape[1], a.shape[1], matrix_view(a), matrix_view(b),
+         output.storage->data() + output.offset, b.shape[1], false);
+}
+
+void MatMulOp::recompute(Tensor& output) {
+    auto a = inputs[0].lock();
+    auto b = inputs[1].lock();
+    if (!a || !b) throw std::runtime_error("MatMulOp: input tensors expired");
+    matmul_kernel(*a, *b, output);
+}
+
 std::shared_ptr<Tensor> matmul(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b) {
+    ProfileScope profile("matmul", "forward");
+
     int m = a->shape[0];
-    int k = a->shape[1];
     int n = b->shape[1];
 
-    auto result = std::make_shared<Tensor>(std::vector<int>{m, n}, a->requires_grad || b->requires_grad);
-    result->data.resize(m * n, 0.0f);
-
-    for (int i = 0; i < m; ++i) {
-        for (int j = 0; j < n; ++j) {
-            for (int l = 0; l < k; ++l) {
-                result->data[i * n + j] += a->data[i * k + l] * b->data[l * n + j];
-            }
-        }
-    }
+    auto result = current_graph().make_tensor(std::vector<int>{m, n}, GradMode::track(a->requires_grad || b->requires_grad));
+    matmul_kernel(*a, *b, *result);
 
     if (result->requires_grad) {
-        auto op = std::make_shared<MatMulOp>(a, b);
+        Graph& graph = current_graph();
+        auto op = graph.make_op<MatMulOp>(a, b);
         result->set_creator(op);
 
-        // Register tensor and op with global graph
-        global_graph.add_tensor(result);
-        global_graph.add_op(op);
+        // Register tensor and op with the current graph
+        graph.add_tensor(result);
+        graph.add_op(op);
     }
 
     return result;
@@ -26,6 +26,11 @@ public:
     // computes gradients w.r.t. input tensors using the chain rule
     // grad_output contains gradients flowing backward from the output tensor
     void backward(Tensor& grad_output) override;
+
+    // re-runs the product into the existing output buffer (graph replay)
+    void recompute(Tensor& output) override;
+
+    const char* name() const override { return "matmul"; }
 };
 
 // convenience function that creates matrix multiplication operation and registers with computation graph
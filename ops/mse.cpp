@@ -1,24 +1,138 @@
 #include "mse.hpp"
+#include <algorithm>
 #include <iostream>
-#include "sub.hpp"
-#include "mean.hpp"
-#include "mul.hpp"
-#include "../tensor_ops.hpp"
+#include <stdexcept>
+#include <string>
+#include "elementwise.hpp"
+#include "pairwise.hpp"
+#include "cast.hpp"
 #include "../graph.hpp"
+#include "../grad_mode.hpp"
+#include "../profiler.hpp"
+#include "../thread_pool.hpp"
 
-extern Graph global_graph;
+// the loss sum is reduced like the full mean of ops/reduce.hpp (pairwise.hpp, same pieces and
+// order), so mse matches mean((p - t)^2) bit for bit and any thread count agrees
+static constexpr size_t kLossGrain = 1 << 15;
 
-std::shared_ptr<Tensor> mse_loss(const std::shared_ptr<Tensor>& prediction, const std::shared_ptr<Tensor>& target) {
-    // Create the computation graph properly
-    auto diff = prediction - target;                      // SubOp
-    auto squared = (diff) * (diff);                       // MulOp
-    auto loss = squared->mean();                          // MeanOp
-
-    // The tensor operators should have already set up the creators and registered with global_graph
-    // But let's ensure the loss tensor is properly set up
-    if (prediction->requires_grad || target->requires_grad) {
-        loss->requires_grad = true;
+// packed copy of a strided operand in a per-thread buffer that grows once
+static const float* packed_operand(const Tensor& t, std::vector<float>& buffer) {
+    if (buffer.size() < static_cast<size_t>(t.numel())) buffer.resize(t.numel());
+    float* out = buffer.data();
+    for_each_element(t, [out](size_t i, float v) { out[i] = v; });
+    return out;
+}
+
+// sum of loss(prediction - target) over all elements
+template <typename Loss>
+static float loss_sum(const Loss& loss, const Tensor& prediction, const Tensor& target) {
+    static thread_local std::vector<float> prediction_buffer;
+    static thread_local std::vector<float> target_buffer;
+    const float* p = prediction.is_contiguous() ? prediction.storage->data() + prediction.offset
+                                                : packed_operand(prediction, prediction_buffer);
+    const float* t = target.is_contiguous() ? target.storage->data() + target.offset
+                                            : packed_operand(target, target_buffer);
+    return pairwise_sum_parallel(prediction.numel(), [&](size_t i) { return loss.value(p[i] - t[i]); });
+}
+
+// grad[i] += scale * f'(prediction[i] - target[i]) into a packed gradient buffer (scale < 0 for the target)
+template <typename Loss>
+static void accumulate_loss_grad(const Loss& loss, const Tensor& prediction, const Tensor& target,
+                                 float scale, float* grad) {
+    if (prediction.is_contiguous() && target.is_contiguous()) {
+        const float* p = prediction.storage->data() + prediction.offset;
+        const float* t = target.storage->data() + target.offset;
+        parallel_for(0, prediction.numel(), kLossGrain, [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; ++i) grad[i] += scale * loss.derivative(p[i] - t[i]);
+        });
+        return;
     }
-    
-    return loss;
+    for_each_pair(prediction, target, [&](size_t i, float p, float t) {
+        grad[i] += scale * loss.derivative(p - t);
+    });
+}
+
+template <typename Loss>
+PointwiseLossOp<Loss>::PointwiseLossOp(const std::shared_ptr<Tensor>& prediction,
+                                       const std::shared_ptr<Tensor>& target, Loss loss_)
+    : loss(loss_) {
+    inputs.push_back(prediction);
+    inputs.push_back(target);
+}
+
+template <typename Loss>
+void PointwiseLossOp<Loss>::backward(Tensor& grad_output) {
+    auto prediction = std::const_pointer_cast<Tensor>(inputs[0].lock());
+    auto target = std::const_pointer_cast<Tensor>(inputs[1].lock());
+    if (!prediction || !target) throw std::runtime_error("PointwiseLossOp: input expired");
+
+    // d(mean f(p - t))/dp_i = f'(p_i - t_i) / N, and the negation for t_i
+    const float scale = grad_output.grad[0] / prediction->numel();
+
+    if (prediction->requires_grad && needs_input_grad(0)) {
+        if (prediction->grad.empty()) prediction->grad.resize(prediction->numel(), 0.0f);
+        accumulate_loss_grad(loss, *prediction, *target, scale, prediction->grad.data());
+    }
+    if (target->requires_grad && needs_input_grad(1)) {
+        if (target->grad.empty()) target->grad.resize(target->numel(), 0.0f);
+        accumulate_loss_grad(loss, *prediction, *target, -scale, target->grad.data());
+    }
+}
+
+template <typename Loss>
+void PointwiseLossOp<Loss>::recompute(Tensor& output) {
+    auto prediction = inputs[0].lock();
+    auto target = inputs[1].lock();
+    if (!prediction || !target) throw std::runtime_error("PointwiseLossOp: input expired");
+    output.storage->data()[output.offset] = loss_sum(loss, *prediction, *target) / prediction->numel();
+}
+
+template class PointwiseLossOp<MSELoss>;
+template class PointwiseLossOp<MAELoss>;
+template class PointwiseLossOp<HuberLoss>;
+
+// one scalar loss tensor, plus its op when a gradient is needed
+template <typename Loss>
+static std::shared_ptr<Tensor> pointwise_loss(const std::shared_ptr<Tensor>& prediction,
+                                              const std::shared_ptr<Tensor>& target, Loss loss) {
+    if (prediction->dtype() != DType::Float32 || target->dtype() != DType::Float32) {
+        return pointwise_loss(as_float32(prediction), as_float32(target), loss);
+    }
+    ProfileScope profile(Loss::name, "forward");
+
+    if (prediction->shape != target->shape) {
+        throw std::runtime_error(std::string(Loss::name) + ": prediction and target shapes differ");
+    }
+
+    auto result = current_graph().make_tensor(std::vector<int>{1},
+                                              GradMode::track(prediction->requires_grad || target->requires_grad));
+    result->data()[0] = loss_sum(loss, *prediction, *target) / prediction->numel();
+
+    if (result->requires_grad) {
+        Graph& graph = current_graph();
+        auto op = graph.make_op<PointwiseLossOp<Loss>>(prediction, target, loss);
+        result->set_creator(op);
+
+        // register with the current graph to prevent premature destruction
+        graph.add_tensor(result);
+        graph.add_op(op);
+    }
+
+    return result;
+}
+
+std::shared_ptr<Tensor> mse_loss(const std::shared_ptr<Tensor>& prediction, const std::shared_ptr<Tensor>& target) {
+    return pointwise_loss(prediction, target, MSELoss{});
+}
+
+std::shared_ptr<Tensor> mae_loss(const std::shared_ptr<Tensor>& prediction, const std::shared_ptr<Tensor>& target) {
+    return pointwise_loss(prediction, target, MAELoss{});
+}
+
+std::shared_ptr<Tensor> huber_loss(const std::shared_ptr<Tensor>& prediction, const std::shared_ptr<Tensor>& target,
+                                   float delta) {
+    if (delta <= 0.0f) throw std::runtime_error("huber_loss: delta must be positive");
+    HuberLoss loss;
+    loss.delta = delta;
+    return pointwise_loss(prediction, target, loss);
 }
@@ -1,11 +1,18 @@
 /*
  * mse.hpp - mean squared error loss function for regression tasks
- * 
+ *
  * this loss function is essential for training neural networks on regression problems:
  * - computes the average squared difference between predictions and targets
  * - provides smooth gradients that enable stable training and convergence
  * - used extensively in housing price prediction, function approximation, and time series forecasting
  * - critical for measuring model performance and guiding parameter updates during training
+ *
+ * mae (mean absolute error) and huber losses share the same fused op:
+ * - forward reads prediction and target once and writes only the scalar loss
+ * - backward writes the analytic gradient (2(p - t)/N for mse) straight into the prediction grad,
+ *   no difference or squared tensors are ever allocated
+ *
+ * IMPORTANT: prediction and target must have the same shape (no broadcasting)
  */
 
 #pragma once
@@ -13,7 +20,60 @@
 #include "../op.hpp"
 #include "../tensor.hpp"
 
+// per-element loss f(d) of the difference d = prediction - target, and its derivative f'(d)
+struct MSELoss {
+    static constexpr const char* name = "mse_loss";
+    float value(float d) const { return d * d; }
+    float derivative(float d) const { return 2.0f * d; }
+};
+
+struct MAELoss {
+    static constexpr const char* name = "mae_loss";
+    float value(float d) const { return d < 0.0f ? -d : d; }
+    float derivative(float d) const { return d > 0.0f ? 1.0f : (d < 0.0f ? -1.0f : 0.0f); }
+};
+
+// quadratic within delta of the target, linear beyond it
+struct HuberLoss {
+    static constexpr const char* name = "huber_loss";
+    float delta = 1.0f;
+    float value(float d) const {
+        const float a = d < 0.0f ? -d : d;
+        return a <= delta ? 0.5f * d * d : delta * (a - 0.5f * delta);
+    }
+    float derivative(float d) const { return d > delta ? delta : (d < -delta ? -delta : d); }
+};
+
+// mean of loss(prediction - target) over all elements as a single graph node
+template <typename Loss>
+class PointwiseLossOp : public Op {
+public:
+    PointwiseLossOp(const std::shared_ptr<Tensor>& prediction, const std::shared_ptr<Tensor>& target, Loss loss);
+
+    // prediction.grad += g * f'(d) / N, target.grad -= g * f'(d) / N
+    void backward(Tensor& grad_output) override;
+
+    // re-evaluates the loss into the existing scalar output (graph replay)
+    void recompute(Tensor& output) override;
+
+    const char* name() const override { return Loss::name; }
+
+private:
+    Loss loss;
+};
+
+using MSELossOp = PointwiseLossOp<MSELoss>;
+using MAELossOp = PointwiseLossOp<MAELoss>;
+using HuberLossOp = PointwiseLossOp<HuberLoss>;
+
 // computes mean squared error loss between predictions and targets
 // this function creates a computational graph that enables automatic differentiation
 // the loss value is used by the optimizer to update model parameters during training
 std::shared_ptr<Tensor> mse_loss(const std::shared_ptr<Tensor>& pred, const std::shared_ptr<Tensor>& target);
+
+// mean absolute error: less sensitive to outliers, constant-size gradients
+std::shared_ptr<Tensor> mae_loss(const std::shared_ptr<Tensor>& pred, const std::shared_ptr<Tensor>& target);
+
+// huber loss: mse for |pred - target| <= delta, mae-like beyond it
+std::shared_ptr<Tensor> huber_loss(const std::shared_ptr<Tensor>& pred, const std::shared_ptr<Tensor>& target,
+                                   float delta = 1.0f);
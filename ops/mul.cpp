@@ -2,7 +2,7 @@
  * mul.cpp - element-wise multiplication operation implementation
  * 
  * this file implements tensor multiplication with broadcasting support:
- * - forward pass: handles shape mismatches through automatic broadcasting
+ * - forward pass: numpy-style broadcasting through stride-0 operands
  * - backward pass: applies product rule for gradient computation
  * - loss computation: essential for squared error terms in mse loss
  */
@@ -10,9 +10,11 @@
 #include "mul.hpp"
 #include <stdexcept>
 #include "../graph.hpp"
+#include "../grad_mode.hpp"
+#include "../profiler.hpp"
 #include "../tensor.hpp"
-
-extern Graph global_graph;
+#include "elementwise.hpp"
+#include "cast.hpp"
 
 // constructor implementation for mul operation
 // stores weak references to input tensors to prevent circular dependencies
@@ -31,100 +33,68 @@ void MulOp::backward(Tensor& grad_output) {
     auto a = std::const_pointer_cast<Tensor>(a_const);
     auto b = std::const_pointer_cast<Tensor>(b_const);
 
-    if (a->requires_grad) {
-        if (a->grad.empty()) a->grad.resize(a->data.size(), 0.0f);
-        for (size_t i = 0; i < a->data.size(); ++i)
-            a->grad[i] += grad_output.grad[i] * b->data[i]; // ∂(a*b)/∂a = b
+    if (a->requires_grad && needs_input_grad(0)) {
+        if (a->grad.empty()) a->grad.resize(a->numel(), 0.0f);
+        float* g_a = a->grad.data();
+        const float* g_out = grad_output.grad.data();
+        if (a->shape != grad_output.shape || b->shape != grad_output.shape) {
+            // broadcast operands: ∂(a*b)/∂a = b, summed over the dimensions a was repeated along
+            reduce_broadcast(grad_output.shape, g_out, *a, *b, a->shape, g_a,
+                             [](float g, float, float bv) { return g * bv; });
+        } else if (b->is_contiguous()) {
+            simd().accumulate_mul(g_out, b->storage->data() + b->offset, g_a, a->numel()); // ∂(a*b)/∂a = b
+        } else {
+            for_each_element(*b, [=](size_t i, float bv) { g_a[i] += g_out[i] * bv; });
+        }
     }
 
-    if (b->requires_grad) {
-        if (b->grad.empty()) b->grad.resize(b->data.size(), 0.0f);
-        for (size_t i = 0; i < b->data.size(); ++i)
-            b->grad[i] += grad_output.grad[i] * a->data[i]; // ∂(a*b)/∂b = a
+    if (b->requires_grad && needs_input_grad(1)) {
+        if (b->grad.empty()) b->grad.resize(b->numel(), 0.0f);
+        float* g_b = b->grad.data();
+        const float* g_out = grad_output.grad.data();
+        if (a->shape != grad_output.shape || b->shape != grad_output.shape) {
+            reduce_broadcast(grad_output.shape, g_out, *a, *b, b->shape, g_b,
+                             [](float g, float av, float) { return g * av; });
+        } else if (a->is_contiguous()) {
+            simd().accumulate_mul(g_out, a->storage->data() + a->offset, g_b, b->numel()); // ∂(a*b)/∂b = a
+        } else {
+            for_each_element(*a, [=](size_t i, float av) { g_b[i] += g_out[i] * av; });
+        }
     }
+}
 
-    // propagate gradients to input tensors' creators to maintain gradient chain
-    // critical fix: check if creators are different to prevent infinite loops
-    auto a_creator = a->creator.lock();
-    if (a_creator && a_creator.get() != this) {
-        a_creator->backward(*a);
-    }
-    auto b_creator = b->creator.lock();
-    if (b_creator && b_creator.get() != this) {
-        b_creator->backward(*b);
-    }
+// a * b into a preallocated output, shared by mul() and graph replay
+static void mul_kernel(const Tensor& a, const Tensor& b, Tensor& out) {
+    broadcast_binary(a, b, out, [](float x, float y) { return x * y; }, simd().mul);
+}
+
+void MulOp::recompute(Tensor& output) {
+    auto a = inputs[0].lock();
+    auto b = inputs[1].lock();
+    if (!a || !b) throw std::runtime_error("MulOp: input expired");
+    mul_kernel(*a, *b, output);
 }
 
 std::shared_ptr<Tensor> mul(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b) {
-    // determine output shape and handle broadcasting for shape mismatches
-    // this enables operations between tensors of different shapes
-    std::vector<int> output_shape;
-    bool needs_broadcasting = false;
-    
-    if (a->shape.size() != b->shape.size()) {
-        // different dimensions - assume broadcasting is needed
-        needs_broadcasting = true;
-        if (a->shape.size() > b->shape.size()) {
-            output_shape = a->shape;
-        } else {
-            output_shape = b->shape;
-        }
-    } else {
-        // same dimensions - check if shapes match
-        output_shape = a->shape;
-        for (size_t i = 0; i < a->shape.size(); ++i) {
-            if (a->shape[i] != b->shape[i]) {
-                needs_broadcasting = true;
-                output_shape[i] = std::max(a->shape[i], b->shape[i]);
-            }
-        }
-    }
-    
-    auto result = std::make_shared<Tensor>(output_shape, a->requires_grad || b->requires_grad);
-    
-    if (needs_broadcasting) {
-        // handle broadcasting: 2d * 1d (matrix * bias vector)
-        // this pattern is less common than addition but still supported
-        if (a->shape.size() == 2 && b->shape.size() == 1) {
-            // matrix * bias vector: broadcast bias across rows
-            int rows = a->shape[0];
-            int cols = a->shape[1];
-            
-            for (int i = 0; i < rows; ++i) {
-                for (int j = 0; j < cols; ++j) {
-                    result->data[i * cols + j] = a->data[i * cols + j] * b->data[j];
-                }
-            }
-        } else if (a->shape.size() == 1 && b->shape.size() == 2) {
-            // bias vector * matrix: broadcast bias across rows
-            int rows = b->shape[0];
-            int cols = b->shape[1];
-            
-            for (int i = 0; i < rows; ++i) {
-                for (int j = 0; j < cols; ++j) {
-                    result->data[i * cols + j] = a->data[j] * b->data[i * cols + j];
-                }
-            }
-        } else {
-            // fallback for other broadcasting cases
-            for (size_t i = 0; i < result->data.size(); ++i) {
-                result->data[i] = a->data[i % a->data.size()] * b->data[i % b->data.size()];
-            }
-        }
-    } else {
-        // no broadcasting needed - direct multiplication
-        for (size_t i = 0; i < result->data.size(); ++i)
-            result->data[i] = a->data[i] * b->data[i];
-    }
+    ProfileScope profile("mul", "forward");
+    a = as_float32(a);
+    b = as_float32(b);
+
+    // numpy-style broadcasting: per-feature scales and masks are never expanded
+    std::vector<int> output_shape = broadcast_shape(a->shape, b->shape);
+
+    auto result = current_graph().make_tensor(output_shape, GradMode::track(a->requires_grad || b->requires_grad));
+    mul_kernel(*a, *b, *result);
 
     if (result->requires_grad) {
+        Graph& graph = current_graph();
         // create mul operation and integrate with computational graph
-        auto op = std::make_shared<MulOp>(a, b);
+        auto op = graph.make_op<MulOp>(a, b);
         result->set_creator(op);
 
-        // register with global graph for lifetime management
-        global_graph.add_tensor(result);
-        global_graph.add_op(op);
+        // register with the current graph for lifetime management
+        graph.add_tensor(result);
+        graph.add_op(op);
     }
 
     return result;
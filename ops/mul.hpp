@@ -13,8 +13,6 @@
 #include "../tensor_ops.hpp"
 #include "../graph.hpp"
 
-extern Graph global_graph;
-
 // mul operation handles element-wise multiplication between tensors
 // used for hadamard product and squared error computation in loss functions
 class MulOp : public Op {
@@ -24,6 +22,8 @@ class MulOp : public Op {
 public:
     MulOp(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b);
     void backward(Tensor& grad_output) override;
+    void recompute(Tensor& output) override;
+    const char* name() const override { return "mul"; }
 };
 
 // global mul function creates mul operations and integrates with computational graph
@@ -0,0 +1,56 @@
+/*
+ * pairwise.hpp - pairwise float summation shared by the reductions and the fused losses
+ *
+ * a run of n terms is summed in kPairwiseLanes partial sums up to kPairwiseBlock terms and split
+ * in halves above that, so the rounding error grows with log(n) instead of n
+ * - pairwise_sum_parallel first cuts long runs into at most kMaxPairwisePieces fixed pieces
+ *   (sized by n alone) on the thread pool, then sums the pieces pairwise
+ * - the order of additions only depends on n: every thread count gives the same bits, and two
+ *   callers summing the same terms (mean(x * x) and mse_loss) agree exactly
+ *
+ * IMPORTANT: term(i) is called once for every i in [0, n) and must not depend on the calling thread
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include "../thread_pool.hpp"
+
+static constexpr size_t kPairwiseLanes = 16;       // partial sums of a pairwise leaf
+static constexpr size_t kPairwiseBlock = 256;      // pairwise leaves are summed directly
+static constexpr size_t kPairwiseGrain = 1 << 15;  // terms per parallel piece (at least)
+static constexpr size_t kMaxPairwisePieces = 64;   // pieces of one long run
+
+// sum of term(first + i) for i in [0, n)
+template <typename Term>
+float pairwise_sum(size_t first, size_t n, const Term& term) {
+    if (n <= kPairwiseBlock) {
+        float lanes[kPairwiseLanes] = {};
+        size_t i = 0;
+        for (; i + kPairwiseLanes <= n; i += kPairwiseLanes) {
+            for (size_t j = 0; j < kPairwiseLanes; ++j) lanes[j] += term(first + i + j);
+        }
+        for (size_t j = 0; i < n; ++i, ++j) lanes[j] += term(first + i);
+
+        float total = 0.0f;
+        for (size_t j = 0; j < kPairwiseLanes; ++j) total += lanes[j];
+        return total;
+    }
+    const size_t half = (n / 2 + kPairwiseLanes - 1) / kPairwiseLanes * kPairwiseLanes;
+    return pairwise_sum(first, half, term) + pairwise_sum(first + half, n - half, term);
+}
+
+// sum of term(i) for i in [0, n), long runs split over the thread pool
+template <typename Term>
+float pairwise_sum_parallel(size_t n, const Term& term) {
+    if (n <= kPairwiseGrain) return pairwise_sum(0, n, term);
+
+    const size_t piece = (std::max(kPairwiseGrain, (n + kMaxPairwisePieces - 1) / kMaxPairwisePieces)
+                          + kPairwiseLanes - 1) / kPairwiseLanes * kPairwiseLanes;
+    const size_t pieces = (n + piece - 1) / piece;
+    float partial[kMaxPairwisePieces];
+    parallel_for(0, pieces, 1, [&](size_t lo, size_t hi) {
+        for (size_t p = lo; p < hi; ++p) partial[p] = pairwise_sum(p * piece, std::min(piece, n - p * piece), term);
+    });
+    return pairwise_sum(0, pieces, [&partial](size_t p) { return partial[p]; });
+}
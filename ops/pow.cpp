@@ -2,8 +2,7 @@
 #include "pow.hpp"
 #include <cmath>
 #include "../graph.hpp"
-
-extern Graph global_graph;
+#include "elementwise.hpp"
 
 PowOp::PowOp(const std::shared_ptr<Tensor>& input, float exponent_) : exponent(exponent_) {
     auto input_nc = std::const_pointer_cast<Tensor>(input);
@@ -18,24 +17,39 @@ void PowOp::backward(Tensor& grad_output) {
     if (!input_const) return;
 
     auto input = std::const_pointer_cast<Tensor>(input_const);
-    if (!input->requires_grad) return;
+    if (!input->requires_grad || !needs_input_grad(0)) return;
 
-    if (input->grad.size() != input->data.size())
-        input->grad.assign(input->data.size(), 0.0f);
+    if (input->grad.size() != static_cast<size_t>(input->numel()))
+        input->grad.assign(input->numel(), 0.0f);
 
     if (input->requires_grad) {
-        if (input->grad.empty()) input->grad.resize(input->data.size(), 0.0f);
-        for (size_t i = 0; i < input->data.size(); ++i) {
-            input->grad[i] += exponent * std::pow(input->data[i], exponent - 1) * grad_output.grad[i]; // Changed from = to += for gradient accumulation
+        float* g_in = input->grad.data();
+        const float* g_out = grad_output.grad.data();
+        const float e = exponent;
+        if (e == 2.0f && input->is_contiguous()) {
+            // d/dx x^2 = 2 * x
+            simd().accumulate_scaled_mul(input->storage->data() + input->offset, g_out, 2.0f, g_in, input->numel());
+            return;
         }
+        for_each_element(*input, [=](size_t i, float x) {
+            g_in[i] += e * std::pow(x, e - 1) * g_out[i]; // Changed from = to += for gradient accumulation
+        });
     }
+}
 
-    // CRITICAL FIX: Propagate gradients to input tensor's creator
-    // But avoid infinite loops by checking if the creator is different
-    auto input_creator = input->creator.lock();
-    if (input_creator && input_creator.get() != this) {
-        // Only propagate if the creator is different from this operation
-        input_creator->backward(*input);
+void pow_kernel(const Tensor& input, float exponent, float* out) {
+    if (exponent == 2.0f && input.is_contiguous()) {
+        const float* p = input.storage->data() + input.offset;
+        simd().mul(p, p, out, input.numel());
+        return;
     }
+    for_each_element(input, [out, exponent](size_t i, float v) { out[i] = std::pow(v, exponent); });
 }
 
+
+void PowOp::recompute(Tensor& output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("PowOp: input expired");
+
+    pow_kernel(*input, exponent, output.storage->data() + output.offset);
+}
@@ -33,4 +33,13 @@ public:
     // computes gradients w.r.t. input tensor using the power rule: d/dx(x^n) = n*x^(n-1)
     // grad_output contains gradients flowing backward from the output tensor
     void backward(Tensor& grad_output) override;
+
+    // re-applies the power into the existing output buffer (graph replay)
+    void recompute(Tensor& output) override;
+
+    const char* name() const override { return "pow"; }
 };
+
+// out = input ^ exponent for a packed output buffer, shared by Tensor::pow and graph replay
+// squares (the mse case) take the simd multiply instead of std::pow
+void pow_kernel(const Tensor& input, float exponent, float* out);
@@ -0,0 +1,142 @@
+/*
+ * qgemm.cpp - int8 quantization, the scalar dot kernel and the fused qlinear epilogue
+ */
+
+#include "qgemm.hpp"
+#include "cast.hpp"
+#include "elementwise.hpp"
+#include "simd.hpp"
+#include "../grad_mode.hpp"
+#include "../logging.hpp"
+#include "../thread_pool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+static constexpr size_t kQgemmGrain = 1 << 16;  // multiply-adds per parallel chunk of rows
+
+static void dot_rows_scalar(const uint8_t* a, const int8_t* w, int depth, int n, int32_t* out) {
+    for (int j = 0; j < n; ++j) {
+        const int8_t* row = w + static_cast<size_t>(j) * depth;
+        int32_t sum = 0;
+        for (int k = 0; k < depth; ++k) sum += static_cast<int32_t>(a[k]) * row[k];
+        out[j] = sum;
+    }
+}
+
+const QgemmKernels& qgemm_scalar_kernels() {
+    static const QgemmKernels kernels = {"scalar", dot_rows_scalar};
+    return kernels;
+}
+
+// follows the instruction set ops/simd.hpp picked (so CPPGRAD_SIMD caps both),
+// vnni additionally needs avx512_vnni and avx512bw
+static const QgemmKernels& select_kernels() {
+    const char* simd_name = simd().name;
+#ifdef CPPGRAD_X86_SIMD
+    __builtin_cpu_init();
+    if (std::strcmp(simd_name, "avx512") == 0 && __builtin_cpu_supports("avx512vnni") &&
+        __builtin_cpu_supports("avx512bw")) {
+        return qgemm_vnni_kernels();
+    }
+    if (std::strcmp(simd_name, "avx512") == 0 || std::strcmp(simd_name, "avx2") == 0) return qgemm_avx2_kernels();
+#endif
+    (void)simd_name;
+    return qgemm_scalar_kernels();
+}
+
+const QgemmKernels& qgemm() {
+    static const QgemmKernels& kernels = [] () -> const QgemmKernels& {
+        const QgemmKernels& chosen = select_kernels();
+        LOG_DEBUG("[qgemm] int8 kernels: " << chosen.name);
+        return chosen;
+    }();
+    return kernels;
+}
+
+// round to nearest (even), shift by the zero point, clamp to uint8
+static uint8_t quantize_value(float v, const QuantParams& p) {
+    const long q = std::lrint(v / p.scale) + p.zero_point;
+    return static_cast<uint8_t>(std::min(255L, std::max(0L, q)));
+}
+
+QuantizedWeights quantize_weights(const Tensor& weight) {
+    if (weight.shape.size() != 2) throw std::runtime_error("quantize_weights: expected a [in, out] matrix");
+
+    // packed float32 copy (the weight may be a strided or 16-bit tensor)
+    NoGradGuard no_grad;
+    auto self = std::const_pointer_cast<Tensor>(weight.shared_from_this());
+    auto packed = to_dtype(self, DType::Float32);
+    const float* w = packed->storage->data() + packed->offset;
+
+    QuantizedWeights q;
+    q.in = weight.shape[0];
+    q.out = weight.shape[1];
+    q.values.resize(static_cast<size_t>(q.in) * q.out);
+    q.scales.resize(q.out);
+    q.sums.resize(q.out);
+
+    for (int j = 0; j < q.out; ++j) {
+        float largest = 0.0f;
+        for (int k = 0; k < q.in; ++k) largest = std::max(largest, std::fabs(w[static_cast<size_t>(k) * q.out + j]));
+        const float scale = largest > 0.0f ? largest / 127.0f : 1.0f;
+
+        int32_t sum = 0;
+        int8_t* row = q.values.data() + static_cast<size_t>(j) * q.in;
+        for (int k = 0; k < q.in; ++k) {
+            const long v = std::lrint(w[static_cast<size_t>(k) * q.out + j] / scale);
+            row[k] = static_cast<int8_t>(std::min(127L, std::max(-127L, v)));
+            sum += row[k];
+        }
+        q.scales[j] = scale;
+        q.sums[j] = sum;
+    }
+    return q;
+}
+
+QuantParams choose_quant_params(float min, float max) {
+    min = std::min(min, 0.0f);
+    max = std::max(max, 0.0f);
+
+    QuantParams p;
+    if (max > min) {
+        p.scale = (max - min) / 255.0f;
+        p.zero_point = static_cast<int>(std::min(255L, std::max(0L, std::lrint(-min / p.scale))));
+    }
+    return p;
+}
+
+void quantize_activations(const Tensor& x, QuantParams params, uint8_t* out) {
+    for_each_element(x, [&](size_t i, float v) { out[i] = quantize_value(v, params); });
+}
+
+void qlinear(int m, const uint8_t* a, QuantParams a_params, const QuantizedWeights& w,
+             const QLinearEpilogue& epilogue, float* out_float, uint8_t* out_quantized) {
+    const int in = w.in;
+    const int out = w.out;
+    const size_t grain = std::max<size_t>(1, kQgemmGrain / std::max<size_t>(static_cast<size_t>(in) * out, 1));
+
+    parallel_for(0, m, grain, [&](size_t lo, size_t hi) {
+        static thread_local std::vector<int32_t> sums;
+        if (sums.size() < static_cast<size_t>(out)) sums.resize(out);
+
+        for (size_t i = lo; i < hi; ++i) {
+            qgemm().dot_rows(a + i * in, w.values.data(), in, out, sums.data());
+
+            for (int j = 0; j < out; ++j) {
+                // exact integer sum without the input zero point, then back to float
+                const int32_t centered = sums[j] - a_params.zero_point * w.sums[j];
+                float y = a_params.scale * w.scales[j] * static_cast<float>(centered);
+                if (epilogue.bias) y += epilogue.bias[j];
+                if (epilogue.relu) y = y > 0.0f ? y : 0.0f;
+
+                if (epilogue.output) {
+                    out_quantized[i * out + j] = quantize_value(y, *epilogue.output);
+                } else {
+                    out_float[i * out + j] = y;
+                }
+            }
+        }
+    });
+}
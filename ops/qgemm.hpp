@@ -0,0 +1,74 @@
+/*
+ * qgemm.hpp - int8 linear layers for inference: quantization helpers and the integer gemm
+ *
+ * y = activation(x * w + b) with x quantized to uint8 and w to int8:
+ * - weights are symmetric per output channel: w[k, j] ~ scales[j] * q[j, k], q in [-127, 127]
+ * - activations are asymmetric per tensor: x ~ scale * (q - zero_point), q in [0, 255], with the
+ *   range taken from a calibration batch (model/quantized.hpp)
+ * - products are summed exactly in int32; the zero point is removed afterwards with the
+ *   precomputed weight sums: sum (qx - zp) * qw = sum qx * qw - zp * sum qw
+ * - the epilogue rescales to float, adds the bias, applies relu and either writes floats or
+ *   requantizes straight to the uint8 input of the next layer (no float activation in between)
+ *
+ * the dot products run on the best integer kernel the cpu offers: avx-512 vnni (vpdpbusd),
+ * avx2 (operands widened to 16 bit, then vpmaddwd) or scalar; the sums are exact, so every
+ * kernel gives the same bits. CPPGRAD_SIMD caps the choice like it does for ops/simd.hpp
+ *
+ * IMPORTANT: integer sums stay exact up to ~66000 input features (255 * 127 * k < 2^31)
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../tensor.hpp"
+
+// int8 weights of a [in, out] matrix, stored output channel by output channel
+struct QuantizedWeights {
+    int in = 0;
+    int out = 0;
+    std::vector<int8_t> values;  // [out, in]: the in weights of output j are contiguous
+    std::vector<float> scales;   // [out]
+    std::vector<int32_t> sums;   // [out]: sum of output j's quantized weights
+
+    size_t bytes() const { return values.size() + (scales.size() + sums.size()) * 4; }
+};
+
+// uint8 activation quantization: x ~ scale * (q - zero_point)
+struct QuantParams {
+    float scale = 1.0f;
+    int zero_point = 0;
+};
+
+// what happens to each int32 sum of qlinear
+struct QLinearEpilogue {
+    const float* bias = nullptr;          // [out] added after rescaling, or none
+    bool relu = false;
+    const QuantParams* output = nullptr;  // requantize to uint8 with these params instead of writing floats
+};
+
+// dot products of one uint8 row with n weight rows: out[j] = sum_k a[k] * w[j * depth + k]
+struct QgemmKernels {
+    const char* name;
+    void (*dot_rows)(const uint8_t* a, const int8_t* w, int depth, int n, int32_t* out);
+};
+
+// kernel table chosen at startup, and the per instruction set ones (avx2 / vnni are x86-64 only)
+const QgemmKernels& qgemm();
+const QgemmKernels& qgemm_scalar_kernels();
+const QgemmKernels& qgemm_avx2_kernels();
+const QgemmKernels& qgemm_vnni_kernels();
+
+// per output channel int8 copy of a [in, out] weight matrix (any layout or dtype)
+QuantizedWeights quantize_weights(const Tensor& weight);
+
+// params covering [min, max] (widened to include 0, so zero is exact)
+QuantParams choose_quant_params(float min, float max);
+
+// float [rows, cols] tensor to packed uint8 rows
+void quantize_activations(const Tensor& x, QuantParams params, uint8_t* out);
+
+// [m, in] uint8 rows times the quantized weights, finished by the epilogue into a packed
+// [m, out] float buffer or (epilogue.output set) a packed [m, out] uint8 buffer
+void qlinear(int m, const uint8_t* a, QuantParams a_params, const QuantizedWeights& w,
+             const QLinearEpilogue& epilogue, float* out_float, uint8_t* out_quantized);
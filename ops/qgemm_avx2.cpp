@@ -0,0 +1,72 @@
+/*
+ * qgemm_avx2.cpp - int8 dot kernel, built with -mavx2 (x86-64 only)
+ *
+ * vpmaddubsw would saturate its int16 pair sums (255 * 127 * 2 > 32767), so both operands
+ * are widened to int16 and multiplied with vpmaddwd, which adds the pairs in int32 exactly
+ */
+
+#include "qgemm.hpp"
+#include <immintrin.h>
+
+static int32_t horizontal_sum(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+}
+
+// 16 products of a[k..k+16) and w[k..k+16) added pairwise into 8 int32 lanes
+static __m256i multiply_add(__m256i acc, __m256i a16, const int8_t* w) {
+    const __m256i w16 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(w)));
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(a16, w16));
+}
+
+static void dot_rows_avx2(const uint8_t* a, const int8_t* w, int depth, int n, int32_t* out) {
+    const int vector_depth = depth / 16 * 16;
+
+    // four weight rows share every widened load of a
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const int8_t* w0 = w + static_cast<size_t>(j) * depth;
+        const int8_t* w1 = w0 + depth;
+        const int8_t* w2 = w1 + depth;
+        const int8_t* w3 = w2 + depth;
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int k = 0; k < vector_depth; k += 16) {
+            const __m256i a16 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k)));
+            acc0 = multiply_add(acc0, a16, w0 + k);
+            acc1 = multiply_add(acc1, a16, w1 + k);
+            acc2 = multiply_add(acc2, a16, w2 + k);
+            acc3 = multiply_add(acc3, a16, w3 + k);
+        }
+        int32_t s0 = horizontal_sum(acc0), s1 = horizontal_sum(acc1);
+        int32_t s2 = horizontal_sum(acc2), s3 = horizontal_sum(acc3);
+        for (int k = vector_depth; k < depth; ++k) {
+            const int32_t av = a[k];
+            s0 += av * w0[k];
+            s1 += av * w1[k];
+            s2 += av * w2[k];
+            s3 += av * w3[k];
+        }
+        out[j] = s0;
+        out[j + 1] = s1;
+        out[j + 2] = s2;
+        out[j + 3] = s3;
+    }
+    for (; j < n; ++j) {
+        const int8_t* row = w + static_cast<size_t>(j) * depth;
+        __m256i acc = _mm256_setzero_si256();
+        for (int k = 0; k < vector_depth; k += 16) {
+            acc = multiply_add(acc, _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k))),
+                               row + k);
+        }
+        int32_t sum = horizontal_sum(acc);
+        for (int k = vector_depth; k < depth; ++k) sum += static_cast<int32_t>(a[k]) * row[k];
+        out[j] = sum;
+    }
+}
+
+const QgemmKernels& qgemm_avx2_kernels() {
+    static const QgemmKernels kernels = {"avx2", dot_rows_avx2};
+    return kernels;
+}
@@ -0,0 +1,60 @@
+/*
+ * qgemm_vnni.cpp - int8 dot kernel, built with -mavx512f -mavx512bw -mavx512vnni (x86-64 only)
+ *
+ * vpdpbusd multiplies 64 uint8 x int8 pairs and adds each group of four straight into int32
+ * lanes (no intermediate saturation); the tail of a row is a masked load
+ */
+
+#include "qgemm.hpp"
+#include <immintrin.h>
+
+static void dot_rows_vnni(const uint8_t* a, const int8_t* w, int depth, int n, int32_t* out) {
+    const int vector_depth = depth / 64 * 64;
+    const __mmask64 tail = depth == vector_depth ? 0 : (~0ULL >> (64 - (depth - vector_depth)));
+
+    // four weight rows share every load of a
+    int j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const int8_t* w0 = w + static_cast<size_t>(j) * depth;
+        const int8_t* w1 = w0 + depth;
+        const int8_t* w2 = w1 + depth;
+        const int8_t* w3 = w2 + depth;
+        __m512i acc0 = _mm512_setzero_si512(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for (int k = 0; k < vector_depth; k += 64) {
+            const __m512i av = _mm512_loadu_si512(a + k);
+            acc0 = _mm512_dpbusd_epi32(acc0, av, _mm512_loadu_si512(w0 + k));
+            acc1 = _mm512_dpbusd_epi32(acc1, av, _mm512_loadu_si512(w1 + k));
+            acc2 = _mm512_dpbusd_epi32(acc2, av, _mm512_loadu_si512(w2 + k));
+            acc3 = _mm512_dpbusd_epi32(acc3, av, _mm512_loadu_si512(w3 + k));
+        }
+        if (tail) {
+            const int k = vector_depth;
+            const __m512i av = _mm512_maskz_loadu_epi8(tail, a + k);
+            acc0 = _mm512_dpbusd_epi32(acc0, av, _mm512_maskz_loadu_epi8(tail, w0 + k));
+            acc1 = _mm512_dpbusd_epi32(acc1, av, _mm512_maskz_loadu_epi8(tail, w1 + k));
+            acc2 = _mm512_dpbusd_epi32(acc2, av, _mm512_maskz_loadu_epi8(tail, w2 + k));
+            acc3 = _mm512_dpbusd_epi32(acc3, av, _mm512_maskz_loadu_epi8(tail, w3 + k));
+        }
+        out[j] = _mm512_reduce_add_epi32(acc0);
+        out[j + 1] = _mm512_reduce_add_epi32(acc1);
+        out[j + 2] = _mm512_reduce_add_epi32(acc2);
+        out[j + 3] = _mm512_reduce_add_epi32(acc3);
+    }
+    for (; j < n; ++j) {
+        const int8_t* row = w + static_cast<size_t>(j) * depth;
+        __m512i acc = _mm512_setzero_si512();
+        for (int k = 0; k < vector_depth; k += 64) {
+            acc = _mm512_dpbusd_epi32(acc, _mm512_loadu_si512(a + k), _mm512_loadu_si512(row + k));
+        }
+        if (tail) {
+            acc = _mm512_dpbusd_epi32(acc, _mm512_maskz_loadu_epi8(tail, a + vector_depth),
+                                      _mm512_maskz_loadu_epi8(tail, row + vector_depth));
+        }
+        out[j] = _mm512_reduce_add_epi32(acc);
+    }
+}
+
+const QgemmKernels& qgemm_vnni_kernels() {
+    static const QgemmKernels kernels = {"vnni", dot_rows_vnni};
+    return kernels;
+}
@@ -0,0 +1,385 @@
+/*
+ * reduce.cpp - axis reductions: planning, kernels and their backward
+ *
+ * every kernel sees the input as [outer, reduce, inner] packed floats (in place, or gathered):
+ * - inner == 1: each output sums one contiguous run pairwise (pairwise.hpp; long runs split
+ *   into fixed pieces that depend only on their length)
+ * - inner > 1: each output column block adds kRowBlock rows at a time into a block buffer that
+ *   then joins the output; few outputs over many rows also split the rows into fixed pieces
+ * work is cut along outputs first, so results never depend on the thread count
+ */
+
+#include "reduce.hpp"
+#include "../graph.hpp"
+#include "../grad_mode.hpp"
+#include "../memory.hpp"
+#include "../profiler.hpp"
+#include "../strided.hpp"
+#include "../thread_pool.hpp"
+#include "simd.hpp"
+#include "pairwise.hpp"
+#include "cast.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+static constexpr size_t kRowBlock = 64;          // rows per block buffer in column sums
+static constexpr size_t kColumnBlock = 1024;     // output columns per column task
+static constexpr size_t kReduceGrain = kPairwiseGrain;  // input elements per parallel chunk
+static constexpr size_t kMaxPieces = kMaxPairwisePieces;  // row pieces of one long reduction
+static constexpr size_t kMaxPartials = 1 << 20;  // floats of per-piece partial outputs
+
+// which axes fold, the output shape, and whether the input can be read in place
+static ReducePlan make_plan(const Tensor& x, const std::vector<int>& axes, bool keepdim) {
+    const int rank = static_cast<int>(x.shape.size());
+    std::vector<bool> reduced(rank, axes.empty());
+    for (int axis : axes) {
+        const int a = axis < 0 ? axis + rank : axis;
+        if (a < 0 || a >= rank) throw std::runtime_error("reduce: axis out of range");
+        if (reduced[a]) throw std::runtime_error("reduce: axis listed twice");
+        reduced[a] = true;
+    }
+
+    ReducePlan plan;
+    const std::vector<int> packed = contiguous_strides(x.shape);
+    for (int pass = 0; pass < 2; ++pass) {
+        // kept axes first, then the reduced ones, each in their original order
+        for (int d = 0; d < rank; ++d) {
+            if (reduced[d] != (pass == 1)) continue;
+            plan.walk_shape.push_back(x.shape[d]);
+            plan.walk_strides.push_back(x.strides[d]);
+            plan.grad_strides.push_back(packed[d]);
+        }
+    }
+    for (int d = 0; d < rank; ++d) {
+        if (!reduced[d]) plan.out_shape.push_back(x.shape[d]);
+        else if (keepdim) plan.out_shape.push_back(1);
+        if (reduced[d]) plan.reduce *= x.shape[d];
+    }
+    if (plan.out_shape.empty()) plan.out_shape = {1};
+
+    // a packed input whose reduced axes are one block [first, last] is read in place
+    int first = rank, last = -1;
+    for (int d = 0; d < rank; ++d) {
+        if (reduced[d]) {
+            first = std::min(first, d);
+            last = d;
+        }
+    }
+    bool adjacent = true;
+    for (int d = first; d <= last; ++d) adjacent = adjacent && reduced[d];
+
+    if (x.is_contiguous() && adjacent && last >= 0) {
+        for (int d = 0; d < first; ++d) plan.outer *= x.shape[d];
+        for (int d = last + 1; d < rank; ++d) plan.inner *= x.shape[d];
+    } else {
+        plan.gather = true;
+        for (int d = 0; d < rank; ++d) {
+            if (!reduced[d]) plan.outer *= x.shape[d];
+        }
+    }
+    return plan;
+}
+
+// per-thread scratch that grows once (gathered inputs, per-piece partials)
+static float* scratch(std::vector<float>& buffer, size_t size) {
+    if (buffer.size() < size) buffer.resize(size);
+    return buffer.data();
+}
+
+// out[o * inner + c] = sum over r of term(x[(o * reduce + r) * inner + c], o * inner + c)
+template <typename Term>
+static void sum_kernel(const float* x, const ReducePlan& plan, float* out, const Term& term) {
+    const size_t outer = plan.outer;
+    const size_t rows = plan.reduce;
+    const size_t inner = plan.inner;
+
+    if (inner == 1) {
+        const size_t grain = std::max<size_t>(1, kReduceGrain / std::max<size_t>(rows, 1));
+        parallel_for(0, outer, grain, [&](size_t lo, size_t hi) {
+            for (size_t o = lo; o < hi; ++o) {
+                const float* run = x + o * rows;
+                out[o] = pairwise_sum_parallel(rows, [&](size_t r) { return term(run[r], o); });
+            }
+        });
+        return;
+    }
+
+    // few outputs over many rows: the rows are cut into pieces too, summed in piece order
+    const size_t blocks = (inner + kColumnBlock - 1) / kColumnBlock;
+    size_t pieces = 1;
+    size_t piece_rows = rows;
+    if (outer > 0 && outer * blocks < kMaxPieces && rows > 2 * kReduceGrain / std::min(inner, kColumnBlock)) {
+        pieces = std::min(kMaxPieces, std::max<size_t>(1, kMaxPartials / (outer * inner)));
+        piece_rows = ((rows + pieces - 1) / pieces + kRowBlock - 1) / kRowBlock * kRowBlock;
+        pieces = (rows + piece_rows - 1) / piece_rows;
+    }
+    static thread_local std::vector<float> partial_buffer;
+    const size_t outputs = outer * inner;
+    float* partials = pieces > 1 ? scratch(partial_buffer, pieces * outputs) : nullptr;
+
+    const size_t grain = std::max<size_t>(1, kReduceGrain / std::max<size_t>(piece_rows * std::min(inner, kColumnBlock), 1));
+    parallel_for(0, outer * blocks * pieces, grain, [&](size_t lo, size_t hi) {
+        float block[kColumnBlock];
+        for (size_t t = lo; t < hi; ++t) {
+            const size_t p = t % pieces;
+            const size_t o = t / pieces / blocks;
+            const size_t c0 = t / pieces % blocks * kColumnBlock;
+            const size_t cols = std::min(kColumnBlock, inner - c0);
+            const size_t first = o * inner + c0;
+            float* acc = (pieces > 1 ? partials + p * outputs : out) + first;
+            std::fill(acc, acc + cols, 0.0f);
+
+            const size_t r_end = std::min(rows, (p + 1) * piece_rows);
+            for (size_t r0 = p * piece_rows; r0 < r_end; r0 += kRowBlock) {
+                std::fill(block, block + cols, 0.0f);
+                for (size_t r = r0; r < std::min(r_end, r0 + kRowBlock); ++r) {
+                    const float* row = x + (o * rows + r) * inner + c0;
+                    for (size_t c = 0; c < cols; ++c) block[c] += term(row[c], first + c);
+                }
+                for (size_t c = 0; c < cols; ++c) acc[c] += block[c];
+            }
+        }
+    });
+
+    if (pieces > 1) {
+        for (size_t i = 0; i < outputs; ++i) {
+            float total = 0.0f;
+            for (size_t p = 0; p < pieces; ++p) total += partials[p * outputs + i];
+            out[i] = total;
+        }
+    }
+}
+
+// out = the element preferred by better() along the reduced rows, index = its row (first wins)
+template <typename Better>
+static void extreme_kernel(const float* x, const ReducePlan& plan, float* out, int* index, Better better) {
+    const size_t outer = plan.outer;
+    const size_t rows = plan.reduce;
+    const size_t inner = plan.inner;
+    const size_t blocks = (inner + kColumnBlock - 1) / kColumnBlock;
+    const size_t grain = std::max<size_t>(1, kReduceGrain / std::max<size_t>(rows * std::min(inner, kColumnBlock), 1));
+
+    parallel_for(0, outer * blocks, grain, [&](size_t lo, size_t hi) {
+        for (size_t t = lo; t < hi; ++t) {
+            const size_t o = t / blocks;
+            const size_t c0 = t % blocks * kColumnBlock;
+            const size_t cols = std::min(kColumnBlock, inner - c0);
+            float* best = out + o * inner + c0;
+            int* at = index + o * inner + c0;
+
+            const float* row = x + o * rows * inner + c0;
+            std::copy(row, row + cols, best);
+            std::fill(at, at + cols, 0);
+            for (size_t r = 1; r < rows; ++r) {
+                row = x + (o * rows + r) * inner + c0;
+                for (size_t c = 0; c < cols; ++c) {
+                    if (better(row[c], best[c])) {
+                        best[c] = row[c];
+                        at[c] = static_cast<int>(r);
+                    }
+                }
+            }
+        }
+    });
+}
+
+// the input in the layout the kernels expect: in place, or gathered output by output
+static const float* reduce_input(const Tensor& input, const ReducePlan& plan) {
+    if (!plan.gather) return input.storage->data() + input.offset;
+
+    static thread_local std::vector<float> gather_buffer;
+    float* packed = scratch(gather_buffer, input.numel());
+    float* dst = packed;
+    const float* src = input.storage->data();
+    for_each_row<1>(plan.walk_shape, {plan.walk_strides.data()}, {input.offset},
+        [&](const std::array<size_t, 1>& off, int count, const std::array<int, 1>& step) {
+            for (int j = 0; j < count; ++j) *dst++ = src[off[0] + static_cast<size_t>(j) * step[0]];
+        });
+    return packed;
+}
+
+// fills output; indices (max/min) and means (var) are sized to the output by the caller
+static void reduce_kernel(ReduceKind kind, const ReducePlan& plan, int ddof, const Tensor& input, Tensor& output,
+                          int* indices, float* means) {
+    const float* x = reduce_input(input, plan);
+    float* out = output.storage->data() + output.offset;
+    const size_t outputs = plan.outer * plan.inner;
+    const float count = static_cast<float>(plan.reduce);
+
+    switch (kind) {
+    case ReduceKind::Sum:
+        sum_kernel(x, plan, out, [](float v, size_t) { return v; });
+        break;
+    case ReduceKind::Mean:
+        sum_kernel(x, plan, out, [](float v, size_t) { return v; });
+        simd().div_scalar(out, count, out, outputs);
+        break;
+    case ReduceKind::Max:
+        extreme_kernel(x, plan, out, indices, [](float a, float b) { return a > b; });
+        break;
+    case ReduceKind::Min:
+        extreme_kernel(x, plan, out, indices, [](float a, float b) { return a < b; });
+        break;
+    case ReduceKind::Var:
+        // two passes: the means, then the centered squares (no catastrophic cancellation)
+        sum_kernel(x, plan, means, [](float v, size_t) { return v; });
+        simd().div_scalar(means, count, means, outputs);
+        sum_kernel(x, plan, out, [means](float v, size_t i) {
+            const float d = v - means[i];
+            return d * d;
+        });
+        simd().div_scalar(out, static_cast<float>(static_cast<long>(plan.reduce) - ddof), out, outputs);
+        break;
+    }
+}
+
+ReduceOp::ReduceOp(const std::shared_ptr<Tensor>& input, ReduceKind kind_, ReducePlan plan_, int ddof_)
+    : kind(kind_), plan(std::move(plan_)), ddof(ddof_) {
+    inputs.push_back(input);
+    const size_t outputs = plan.outer * plan.inner;
+    if (kind == ReduceKind::Max || kind == ReduceKind::Min) indices.resize(outputs);
+    if (kind == ReduceKind::Var) means.resize(outputs);
+}
+
+const char* ReduceOp::name() const {
+    switch (kind) {
+    case ReduceKind::Sum: return "sum";
+    case ReduceKind::Mean: return "mean";
+    case ReduceKind::Max: return "amax";
+    case ReduceKind::Min: return "amin";
+    case ReduceKind::Var: return "var";
+    }
+    return "reduce";
+}
+
+void ReduceOp::recompute(Tensor& output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("ReduceOp: input expired");
+    reduce_kernel(kind, plan, ddof, *input, output, indices.data(), means.data());
+}
+
+void ReduceOp::backward(Tensor& grad_output) {
+    auto input = std::const_pointer_cast<Tensor>(inputs[0].lock());
+    if (!input) throw std::runtime_error("ReduceOp: input expired");
+    if (!input->requires_grad || !needs_input_grad(0)) return;
+    if (input->grad.empty()) input->grad.resize(input->numel(), 0.0f);
+
+    const float* g = grad_output.grad.data();
+    const float* x = input->storage->data();
+    float* dx = input->grad.data();
+    const size_t rows = plan.reduce;
+
+    // visits the input output by output: fn(o, r, value, grad) for reduced position r of output o
+    auto walk = [&](auto&& fn) {
+        size_t o = 0;
+        size_t r = 0;
+        for_each_row<2>(plan.walk_shape, {plan.walk_strides.data(), plan.grad_strides.data()}, {input->offset, 0},
+            [&](const std::array<size_t, 2>& off, int count, const std::array<int, 2>& step) {
+                for (int j = 0; j < count; ++j) {
+                    fn(o, r, x[off[0] + static_cast<size_t>(j) * step[0]], dx[off[1] + static_cast<size_t>(j) * step[1]]);
+                    if (++r == rows) {
+                        r = 0;
+                        ++o;
+                    }
+                }
+            });
+    };
+
+    switch (kind) {
+    case ReduceKind::Sum:
+        walk([g](size_t o, size_t, float, float& d) { d += g[o]; });
+        break;
+    case ReduceKind::Mean: {
+        const float count = static_cast<float>(rows);
+        walk([g, count](size_t o, size_t, float, float& d) { d += g[o] / count; });
+        break;
+    }
+    case ReduceKind::Max:
+    case ReduceKind::Min: {
+        const int* at = indices.data();
+        walk([g, at](size_t o, size_t r, float, float& d) {
+            if (static_cast<int>(r) == at[o]) d += g[o];
+        });
+        break;
+    }
+    case ReduceKind::Var: {
+        // d var / dx = 2 (x - mean) / (n - ddof)
+        const float* m = means.data();
+        const float scale = 2.0f / static_cast<float>(static_cast<long>(rows) - ddof);
+        walk([g, m, scale](size_t o, size_t, float v, float& d) { d += g[o] * scale * (v - m[o]); });
+        break;
+    }
+    }
+}
+
+// plans, runs and (when a gradient is needed) records one reduction
+static std::shared_ptr<Tensor> reduce(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim,
+                                      ReduceKind kind, int ddof, const char* name) {
+    if (x->dtype() != DType::Float32) return reduce(as_float32(x), axes, keepdim, kind, ddof, name);
+    ProfileScope profile(name, "forward");
+
+    ReducePlan plan = make_plan(*x, axes, keepdim);
+    if ((kind == ReduceKind::Max || kind == ReduceKind::Min) && plan.reduce == 0) {
+        throw std::runtime_error(std::string(name) + ": reduction over an empty axis");
+    }
+    if (kind == ReduceKind::Var && static_cast<long>(plan.reduce) <= ddof) {
+        throw std::runtime_error("var: not enough elements for ddof");
+    }
+
+    auto result = current_graph().make_tensor(plan.out_shape, GradMode::track(x->requires_grad));
+    if (!result->requires_grad) {
+        const size_t outputs = plan.outer * plan.inner;
+        std::vector<int> indices(kind == ReduceKind::Max || kind == ReduceKind::Min ? outputs : 0);
+        std::vector<float> means(kind == ReduceKind::Var ? outputs : 0);
+        reduce_kernel(kind, plan, ddof, *x, *result, indices.data(), means.data());
+        return result;
+    }
+
+    Graph& graph = current_graph();
+    auto op = graph.make_op<ReduceOp>(x, kind, std::move(plan), ddof);
+    op->recompute(*result);
+    result->set_creator(op);
+
+    // register with the current graph to prevent premature destruction
+    graph.add_tensor(result);
+    graph.add_op(op);
+    return result;
+}
+
+std::shared_ptr<Tensor> sum(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim) {
+    return reduce(x, axes, keepdim, ReduceKind::Sum, 0, "sum");
+}
+
+std::shared_ptr<Tensor> mean(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim) {
+    return reduce(x, axes, keepdim, ReduceKind::Mean, 0, "mean");
+}
+
+std::shared_ptr<Tensor> amax(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim) {
+    return reduce(x, axes, keepdim, ReduceKind::Max, 0, "amax");
+}
+
+std::shared_ptr<Tensor> amin(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim) {
+    return reduce(x, axes, keepdim, ReduceKind::Min, 0, "amin");
+}
+
+std::shared_ptr<Tensor> var(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim, int ddof) {
+    return reduce(x, axes, keepdim, ReduceKind::Var, ddof, "var");
+}
+
+std::shared_ptr<Tensor> argmax(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim) {
+    if (x->dtype() != DType::Float32) return argmax(as_float32(x), axes, keepdim);
+    ProfileScope profile("argmax", "forward");
+
+    const ReducePlan plan = make_plan(*x, axes, keepdim);
+    if (plan.reduce == 0) throw std::runtime_error("argmax: reduction over an empty axis");
+
+    // indices are not differentiable: always a plain tensor
+    auto result = std::make_shared<Tensor>(plan.out_shape, false, tracked_heap(MemoryCategory::Activation));
+    std::vector<int> indices(plan.outer * plan.inner);
+    reduce_kernel(ReduceKind::Max, plan, 0, *x, *result, indices.data(), nullptr);
+
+    float* out = result->storage->data();
+    for (size_t i = 0; i < indices.size(); ++i) out[i] = static_cast<float>(indices[i]);
+    return result;
+}
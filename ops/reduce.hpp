@@ -0,0 +1,79 @@
+/*
+ * reduce.hpp - axis-aware reductions: sum, mean, amax, amin, var and argmax
+ *
+ * each reduction folds the given axes of its input (all axes when the list is empty):
+ * - negative axes count from the end; keepdim leaves the reduced axes in place with size 1,
+ *   and a full reduction without keepdim gives the usual {1} scalar tensor
+ * - packed inputs reduced over adjacent axes are read in place: a reduced block of whole rows
+ *   (e.g. axis 0 of [batch, features]) is added row by row into the output with vector loops,
+ *   a contiguous reduced run (e.g. the last axis) is summed pairwise
+ * - any other layout is first gathered into (output, reduced) order in a per-thread scratch
+ * - sums are pairwise / row-blocked, so the error grows with log(n) rather than n, and outputs
+ *   are split across the thread pool (each output is always summed the same way, whatever the
+ *   thread count)
+ *
+ * usage:
+ *     auto feature_mean = mean(x, {0});            // [batch, features] -> [features]
+ *     auto row_max = amax(x, {-1}, true);           // [batch, features] -> [batch, 1]
+ *
+ * IMPORTANT: amax/amin send the whole gradient to the first extreme element, argmax returns
+ * indices as floats and never requires grad
+ */
+
+#pragma once
+#include <memory>
+#include <vector>
+#include "../tensor.hpp"
+#include "../op.hpp"
+
+enum class ReduceKind {
+    Sum,
+    Mean,
+    Max,
+    Min,
+    Var,
+};
+
+// how a reduction walks its input, fixed when the op is built so recompute never allocates
+// outputs are numbered in row-major order over the kept axes
+struct ReducePlan {
+    std::vector<int> out_shape;
+    size_t outer = 1;   // outputs per column (all outputs when inner is 1)
+    size_t reduce = 1;  // elements folded into each output
+    size_t inner = 1;   // in-place reads: distance between consecutive reduced elements
+    bool gather = false;  // copy the input into packed (output, reduced) order first
+
+    // the input's axes reordered kept-first, with its storage strides and its packed strides
+    // (the gradient buffer layout); walking them visits elements output by output
+    std::vector<int> walk_shape;
+    std::vector<int> walk_strides;
+    std::vector<int> grad_strides;
+};
+
+class ReduceOp : public Op {
+public:
+    ReduceOp(const std::shared_ptr<Tensor>& input, ReduceKind kind, ReducePlan plan, int ddof);
+
+    void backward(Tensor& grad_output) override;
+    void recompute(Tensor& output) override;
+    const char* name() const override;
+
+private:
+    ReduceKind kind;
+    ReducePlan plan;
+    int ddof;
+    std::vector<int> indices;  // max/min: reduced position of the winner of each output
+    std::vector<float> means;  // var: mean of each output's elements
+};
+
+std::shared_ptr<Tensor> sum(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim = false);
+std::shared_ptr<Tensor> mean(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim = false);
+std::shared_ptr<Tensor> amax(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim = false);
+std::shared_ptr<Tensor> amin(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim = false);
+
+// variance with ddof delta degrees of freedom (0: population, 1: sample variance)
+std::shared_ptr<Tensor> var(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim = false,
+                            int ddof = 0);
+
+// position of the first maximum along the reduced axes (row-major over them when there are several)
+std::shared_ptr<Tensor> argmax(const std::shared_ptr<Tensor>& x, const std::vector<int>& axes, bool keepdim = false);
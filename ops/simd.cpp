@@ -0,0 +1,214 @@
+/*
+ * simd.cpp - scalar kernels and the startup choice of instruction set
+ */
+
+#include "simd.hpp"
+#include "simd_impl.hpp"
+#include "../logging.hpp"
+#include "../thread_pool.hpp"
+#include "../dtype.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+// one element at a time, built with the compiler's baseline flags
+struct ScalarLanes {
+    using Vec = float;
+    static constexpr size_t width = 1;
+
+    static Vec load(const float* p) { return *p; }
+    static void store(float* p, Vec v) { *p = v; }
+    static Vec set1(float v) { return v; }
+    static Vec zero() { return 0.0f; }
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static Vec sub(Vec a, Vec b) { return a - b; }
+    static Vec mul(Vec a, Vec b) { return a * b; }
+    static Vec div(Vec a, Vec b) { return a / b; }
+    static Vec relu(Vec x) { return x > 0.0f ? x : 0.0f; }
+    static Vec where_positive(Vec x, Vec g) { return x > 0.0f ? g : 0.0f; }
+    // same operand order as minps/maxps: the second operand wins ties and nan
+    static Vec min(Vec a, Vec b) { return a < b ? a : b; }
+    static Vec max(Vec a, Vec b) { return a > b ? a : b; }
+    static Vec sqrt(Vec x) { return std::sqrt(x); }
+    static Vec load_bf16(const uint16_t* p) { return bf16_to_float(*p); }
+    static void store_bf16(uint16_t* p, Vec v) { *p = float_to_bf16(v); }
+    static Vec load_fp16(const uint16_t* p) { return fp16_to_float(*p); }
+    static void store_fp16(uint16_t* p, Vec v) { *p = float_to_fp16(v); }
+};
+
+const SimdKernels& simd_scalar_kernels() {
+    static const SimdKernels kernels = make_simd_kernels<ScalarLanes>("scalar");
+    return kernels;
+}
+
+// best supported instruction set, capped by CPPGRAD_SIMD
+static const SimdKernels& select_kernels() {
+    const char* env = std::getenv("CPPGRAD_SIMD");
+    const std::string cap = env ? env : "avx512";
+
+#ifdef CPPGRAD_X86_SIMD
+    __builtin_cpu_init();
+    if (cap == "avx512" && __builtin_cpu_supports("avx512f")) return simd_avx512_kernels();
+    if ((cap == "avx512" || cap == "avx2") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+        return simd_avx2_kernels();
+    }
+#endif
+    if (cap != "scalar" && cap != "avx2" && cap != "avx512") {
+        LOG_WARN("[simd] unknown CPPGRAD_SIMD=" << cap << ", using scalar kernels");
+    }
+    return simd_scalar_kernels();
+}
+
+// kernels of the instruction set picked at startup, single threaded
+static const SimdKernels& isa() {
+    static const SimdKernels& kernels = [] () -> const SimdKernels& {
+        const SimdKernels& chosen = select_kernels();
+        LOG_DEBUG("[simd] element-wise kernels: " << chosen.name);
+        return chosen;
+    }();
+    return kernels;
+}
+
+// the table handed out by simd(): the same kernels, split across the thread pool
+// arrays of up to kElementGrain elements (128 KB) stay on the calling thread
+static constexpr size_t kElementGrain = 1 << 15;
+static constexpr size_t kMaxSumPieces = 64;
+
+static void add_parallel(const float* a, const float* b, float* out, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().add(a + lo, b + lo, out + lo, hi - lo); });
+}
+
+static void sub_parallel(const float* a, const float* b, float* out, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().sub(a + lo, b + lo, out + lo, hi - lo); });
+}
+
+static void mul_parallel(const float* a, const float* b, float* out, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().mul(a + lo, b + lo, out + lo, hi - lo); });
+}
+
+static void div_parallel(const float* a, const float* b, float* out, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().div(a + lo, b + lo, out + lo, hi - lo); });
+}
+
+static void div_scalar_parallel(const float* a, float s, float* out, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().div_scalar(a + lo, s, out + lo, hi - lo); });
+}
+
+static void relu_parallel(const float* x, float* out, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().relu(x + lo, out + lo, hi - lo); });
+}
+
+static void accumulate_parallel(const float* src, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().accumulate(src + lo, dst + lo, hi - lo); });
+}
+
+static void subtract_parallel(const float* src, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().subtract(src + lo, dst + lo, hi - lo); });
+}
+
+static void accumulate_scalar_parallel(float c, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().accumulate_scalar(c, dst + lo, hi - lo); });
+}
+
+static void accumulate_div_parallel(const float* src, float s, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) {
+        isa().accumulate_div(src + lo, s, dst + lo, hi - lo);
+    });
+}
+
+static void accumulate_mul_parallel(const float* a, const float* b, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) {
+        isa().accumulate_mul(a + lo, b + lo, dst + lo, hi - lo);
+    });
+}
+
+static void accumulate_scaled_mul_parallel(const float* a, const float* b, float s, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) {
+        isa().accumulate_scaled_mul(a + lo, b + lo, s, dst + lo, hi - lo);
+    });
+}
+
+static void relu_backward_parallel(const float* x, const float* g, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) {
+        isa().relu_backward(x + lo, g + lo, dst + lo, hi - lo);
+    });
+}
+
+// partial sums over fixed pieces (at most kMaxSumPieces), added in piece order
+// the pieces only depend on n, so the result is the same for every thread count
+static float sum_parallel(const float* x, size_t n) {
+    const size_t piece = std::max(kElementGrain, (n + kMaxSumPieces - 1) / kMaxSumPieces);
+    const size_t pieces = (n + piece - 1) / piece;
+    if (pieces <= 1) return isa().sum(x, n);
+
+    float partial[kMaxSumPieces];
+    parallel_for(0, pieces, 1, [&](size_t lo, size_t hi) {
+        for (size_t p = lo; p < hi; ++p) partial[p] = isa().sum(x + p * piece, std::min(piece, n - p * piece));
+    });
+
+    float total = 0.0f;
+    for (size_t p = 0; p < pieces; ++p) total += partial[p];
+    return total;
+}
+
+// pieces that start after a non-finite one was found are skipped
+static bool all_finite_parallel(const float* x, size_t n) {
+    std::atomic<bool> finite{true};
+    parallel_for(0, n, kElementGrain, [&](size_t lo, size_t hi) {
+        if (finite.load(std::memory_order_relaxed) && !isa().all_finite(x + lo, hi - lo)) {
+            finite.store(false, std::memory_order_relaxed);
+        }
+    });
+    return finite.load();
+}
+
+static void adam_parallel(float* param, const float* grad, float* m, float* v, size_t n, const AdamStep& step) {
+    parallel_for(0, n, kElementGrain, [=, &step](size_t lo, size_t hi) {
+        isa().adam(param + lo, grad + lo, m + lo, v + lo, hi - lo, step);
+    });
+}
+
+static void widen_bf16_parallel(const uint16_t* src, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().widen_bf16(src + lo, dst + lo, hi - lo); });
+}
+
+static void narrow_bf16_parallel(const float* src, uint16_t* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().narrow_bf16(src + lo, dst + lo, hi - lo); });
+}
+
+static void widen_fp16_parallel(const uint16_t* src, float* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().widen_fp16(src + lo, dst + lo, hi - lo); });
+}
+
+static void narrow_fp16_parallel(const float* src, uint16_t* dst, size_t n) {
+    parallel_for(0, n, kElementGrain, [=](size_t lo, size_t hi) { isa().narrow_fp16(src + lo, dst + lo, hi - lo); });
+}
+
+const SimdKernels& simd() {
+    static const SimdKernels kernels = {
+        isa().name,
+        add_parallel,
+        sub_parallel,
+        mul_parallel,
+        div_parallel,
+        div_scalar_parallel,
+        relu_parallel,
+        accumulate_parallel,
+        subtract_parallel,
+        accumulate_scalar_parallel,
+        accumulate_div_parallel,
+        accumulate_mul_parallel,
+        accumulate_scaled_mul_parallel,
+        relu_backward_parallel,
+        sum_parallel,
+        all_finite_parallel,
+        adam_parallel,
+        widen_bf16_parallel,
+        narrow_bf16_parallel,
+        widen_fp16_parallel,
+        narrow_fp16_parallel,
+    };
+    return kernels;
+}
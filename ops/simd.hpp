@@ -0,0 +1,88 @@
+/*
+ * simd.hpp - vectorized element-wise kernels with runtime cpu dispatch
+ *
+ * the element-wise forwards and the grad[i] += ... loops of the backwards are memory bound,
+ * so they run through one table of packed-array kernels:
+ * - one implementation per instruction set: scalar (the compiler's baseline, sse2 on x86-64),
+ *   avx2 and avx-512, each built in its own translation unit with its own target flags
+ * - the best set the cpu and os support is picked once at startup; CPPGRAD_SIMD=scalar|avx2|avx512
+ *   caps the choice (useful to compare or to rule out a kernel)
+ * - every set produces bit-identical results: no fused multiply-add, and sum() always reduces
+ *   through the same 16 lanes in the same order
+ * - simd() splits large arrays across the thread pool (thread_pool.hpp), sum() over fixed pieces
+ *   so the result does not depend on the thread count either
+ *
+ * usage:
+ *     simd().add(pa, pb, out, n);             // out = a + b
+ *     simd().accumulate(g_out, g_in, n);      // g_in += g_out
+ *
+ * the table also converts between float32 and the 16-bit storage types of dtype.hpp
+ * (f16c / avx-512 for float16, integer rounding for bfloat16 so every set agrees bit for bit)
+ *
+ * IMPORTANT: all pointers address packed arrays of n elements (float unless noted)
+ * strided views still go through the visitors of elementwise.hpp
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// constants of one fused adam update (optimizer/adam.hpp), computed once per step
+struct AdamStep {
+    float beta1;
+    float beta2;
+    float one_minus_beta1;
+    float one_minus_beta2;
+    float step_size;       // lr / (1 - beta1^t)
+    float inv_sqrt_bias2;  // 1 / sqrt(1 - beta2^t)
+    float epsilon;
+    float decay;           // decoupled weight decay factor 1 - lr * weight_decay (1 for plain adam)
+    float grad_scale;      // gradients are multiplied by this first (1 / loss scale, else 1)
+    float clip;            // then clamped to [-clip, clip]
+};
+
+struct SimdKernels {
+    const char* name;
+
+    // out = a op b
+    void (*add)(const float* a, const float* b, float* out, size_t n);
+    void (*sub)(const float* a, const float* b, float* out, size_t n);
+    void (*mul)(const float* a, const float* b, float* out, size_t n);
+    void (*div)(const float* a, const float* b, float* out, size_t n);
+    // out = a / s
+    void (*div_scalar)(const float* a, float s, float* out, size_t n);
+    // out = max(0, x)
+    void (*relu)(const float* x, float* out, size_t n);
+
+    // gradient accumulation into dst
+    void (*accumulate)(const float* src, float* dst, size_t n);                 // dst += src
+    void (*subtract)(const float* src, float* dst, size_t n);                   // dst -= src
+    void (*accumulate_scalar)(float c, float* dst, size_t n);                   // dst += c
+    void (*accumulate_div)(const float* src, float s, float* dst, size_t n);    // dst += src / s
+    void (*accumulate_mul)(const float* a, const float* b, float* dst, size_t n);  // dst += a * b
+    void (*accumulate_scaled_mul)(const float* a, const float* b, float s, float* dst, size_t n);  // dst += s * a * b
+    void (*relu_backward)(const float* x, const float* g, float* dst, size_t n);   // dst += x > 0 ? g : 0
+
+    // sum of n elements
+    float (*sum)(const float* x, size_t n);
+    // true when no element is inf or nan (read only, never overflows)
+    bool (*all_finite)(const float* x, size_t n);
+
+    // adam in one pass: g = clamp(grad_scale * grad), m = b1 m + (1 - b1) g, v = b2 v + (1 - b2) g^2,
+    // param = decay * param - step_size * m / (sqrt(v) * inv_sqrt_bias2 + epsilon)
+    void (*adam)(float* param, const float* grad, float* m, float* v, size_t n, const AdamStep& step);
+
+    // 16-bit storage (dtype.hpp) to float32 and back, rounding to nearest even
+    void (*widen_bf16)(const uint16_t* src, float* dst, size_t n);
+    void (*narrow_bf16)(const float* src, uint16_t* dst, size_t n);
+    void (*widen_fp16)(const uint16_t* src, float* dst, size_t n);
+    void (*narrow_fp16)(const float* src, uint16_t* dst, size_t n);
+};
+
+// kernels of the instruction set chosen at startup, parallel over large arrays
+const SimdKernels& simd();
+
+// single-threaded per instruction set tables (simd_avx2.cpp / simd_avx512.cpp are only built for x86-64)
+const SimdKernels& simd_scalar_kernels();
+const SimdKernels& simd_avx2_kernels();
+const SimdKernels& simd_avx512_kernels();
@@ -0,0 +1,58 @@
+/*
+ * simd_avx2.cpp - 8-wide kernels, built with -mavx2 -mf16c (x86-64 only)
+ */
+
+#include "simd_impl.hpp"
+#include <immintrin.h>
+
+struct Avx2Lanes {
+    using Vec = __m256;
+    static constexpr size_t width = 8;
+
+    static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec set1(float v) { return _mm256_set1_ps(v); }
+    static Vec zero() { return _mm256_setzero_ps(); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+    // max returns the second operand for nan and signed zeros, matching x > 0 ? x : 0
+    static Vec relu(Vec x) { return _mm256_max_ps(x, _mm256_setzero_ps()); }
+    static Vec where_positive(Vec x, Vec g) {
+        return _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ), g);
+    }
+    static Vec min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+    static Vec sqrt(Vec x) { return _mm256_sqrt_ps(x); }
+
+    // bfloat16 is the top half of a float: widen by shifting, narrow with the integer
+    // round-to-nearest-even of dtype.hpp (nans keep their payload and turn quiet)
+    static Vec load_bf16(const uint16_t* p) {
+        const __m256i x = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(x, 16));
+    }
+    static void store_bf16(uint16_t* p, Vec v) {
+        const __m256i x = _mm256_castps_si256(v);
+        const __m256i high = _mm256_srli_epi32(x, 16);
+        const __m256i bias = _mm256_add_epi32(_mm256_set1_epi32(0x7fff), _mm256_and_si256(high, _mm256_set1_epi32(1)));
+        const __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(x, bias), 16);
+        const __m256i quiet = _mm256_or_si256(high, _mm256_set1_epi32(0x40));
+        const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+        // every value fits 16 bits: pack both 128-bit halves, then gather their low quadwords
+        const __m256i r = _mm256_blendv_epi8(rounded, quiet, nan);
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(r, r), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+    }
+    static Vec load_fp16(const uint16_t* p) {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+    static void store_fp16(uint16_t* p, Vec v) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+const SimdKernels& simd_avx2_kernels() {
+    static const SimdKernels kernels = make_simd_kernels<Avx2Lanes>("avx2");
+    return kernels;
+}
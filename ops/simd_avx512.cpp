@@ -0,0 +1,55 @@
+/*
+ * simd_avx512.cpp - 16-wide kernels, built with -mavx512f (x86-64 only)
+ */
+
+#include "simd_impl.hpp"
+#include <immintrin.h>
+
+struct Avx512Lanes {
+    using Vec = __m512;
+    static constexpr size_t width = 16;
+
+    static Vec load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm512_storeu_ps(p, v); }
+    static Vec set1(float v) { return _mm512_set1_ps(v); }
+    static Vec zero() { return _mm512_setzero_ps(); }
+    static Vec add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+    // max returns the second operand for nan and signed zeros, matching x > 0 ? x : 0
+    static Vec relu(Vec x) { return _mm512_max_ps(x, _mm512_setzero_ps()); }
+    static Vec where_positive(Vec x, Vec g) {
+        return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, _mm512_setzero_ps(), _CMP_GT_OQ), g);
+    }
+    static Vec min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+    static Vec max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+    static Vec sqrt(Vec x) { return _mm512_sqrt_ps(x); }
+
+    // bfloat16 narrows with integer rounding rather than avx512_bf16, whose conversion
+    // flushes subnormals and would disagree with the other instruction sets
+    static Vec load_bf16(const uint16_t* p) {
+        const __m512i x = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(x, 16));
+    }
+    static void store_bf16(uint16_t* p, Vec v) {
+        const __m512i x = _mm512_castps_si512(v);
+        const __m512i high = _mm512_srli_epi32(x, 16);
+        const __m512i bias = _mm512_add_epi32(_mm512_set1_epi32(0x7fff), _mm512_and_si512(high, _mm512_set1_epi32(1)));
+        const __m512i rounded = _mm512_srli_epi32(_mm512_add_epi32(x, bias), 16);
+        const __m512i quiet = _mm512_or_si512(high, _mm512_set1_epi32(0x40));
+        const __m512i r = _mm512_mask_blend_epi32(_mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q), rounded, quiet);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(r));
+    }
+    static Vec load_fp16(const uint16_t* p) {
+        return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    }
+    static void store_fp16(uint16_t* p, Vec v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+const SimdKernels& simd_avx512_kernels() {
+    static const SimdKernels kernels = make_simd_kernels<Avx512Lanes>("avx512");
+    return kernels;
+}
@@ -0,0 +1,252 @@
+/*
+ * simd_impl.hpp - kernel bodies shared by every instruction set of simd.hpp
+ *
+ * each simd_*.cpp defines a Lanes struct (vector type, width and a handful of primitives)
+ * and instantiates make_simd_kernels<Lanes>() - the loops below are written once
+ *
+ * IMPORTANT: only include this from the per-isa translation units, everything here has
+ * internal linkage so the differently compiled copies can never be mixed up by the linker
+ * (for the same reason the bodies call no inline library functions)
+ */
+
+#pragma once
+#include "simd.hpp"
+
+// sum() always reduces through this many partial sums, whatever the vector width
+static constexpr size_t kSumLanes = 16;
+
+template <typename L>
+static void add_impl(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(out + i, L::add(L::load(a + i), L::load(b + i)));
+    for (; i < n; ++i) out[i] = a[i] + b[i];
+}
+
+template <typename L>
+static void sub_impl(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(out + i, L::sub(L::load(a + i), L::load(b + i)));
+    for (; i < n; ++i) out[i] = a[i] - b[i];
+}
+
+template <typename L>
+static void mul_impl(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(out + i, L::mul(L::load(a + i), L::load(b + i)));
+    for (; i < n; ++i) out[i] = a[i] * b[i];
+}
+
+template <typename L>
+static void div_impl(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(out + i, L::div(L::load(a + i), L::load(b + i)));
+    for (; i < n; ++i) out[i] = a[i] / b[i];
+}
+
+template <typename L>
+static void div_scalar_impl(const float* a, float s, float* out, size_t n) {
+    const typename L::Vec vs = L::set1(s);
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(out + i, L::div(L::load(a + i), vs));
+    for (; i < n; ++i) out[i] = a[i] / s;
+}
+
+template <typename L>
+static void relu_impl(const float* x, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(out + i, L::relu(L::load(x + i)));
+    for (; i < n; ++i) out[i] = x[i] > 0.0f ? x[i] : 0.0f;
+}
+
+template <typename L>
+static void accumulate_impl(const float* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(dst + i, L::add(L::load(dst + i), L::load(src + i)));
+    for (; i < n; ++i) dst[i] += src[i];
+}
+
+template <typename L>
+static void subtract_impl(const float* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(dst + i, L::sub(L::load(dst + i), L::load(src + i)));
+    for (; i < n; ++i) dst[i] -= src[i];
+}
+
+template <typename L>
+static void accumulate_scalar_impl(float c, float* dst, size_t n) {
+    const typename L::Vec vc = L::set1(c);
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(dst + i, L::add(L::load(dst + i), vc));
+    for (; i < n; ++i) dst[i] += c;
+}
+
+template <typename L>
+static void accumulate_div_impl(const float* src, float s, float* dst, size_t n) {
+    const typename L::Vec vs = L::set1(s);
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) {
+        L::store(dst + i, L::add(L::load(dst + i), L::div(L::load(src + i), vs)));
+    }
+    for (; i < n; ++i) dst[i] += src[i] / s;
+}
+
+template <typename L>
+static void accumulate_mul_impl(const float* a, const float* b, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) {
+        L::store(dst + i, L::add(L::load(dst + i), L::mul(L::load(a + i), L::load(b + i))));
+    }
+    for (; i < n; ++i) dst[i] += a[i] * b[i];
+}
+
+template <typename L>
+static void accumulate_scaled_mul_impl(const float* a, const float* b, float s, float* dst, size_t n) {
+    const typename L::Vec vs = L::set1(s);
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) {
+        L::store(dst + i, L::add(L::load(dst + i), L::mul(L::mul(vs, L::load(a + i)), L::load(b + i))));
+    }
+    for (; i < n; ++i) dst[i] += s * a[i] * b[i];
+}
+
+template <typename L>
+static void relu_backward_impl(const float* x, const float* g, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) {
+        L::store(dst + i, L::add(L::load(dst + i), L::where_positive(L::load(x + i), L::load(g + i))));
+    }
+    for (; i < n; ++i) dst[i] += x[i] > 0.0f ? g[i] : 0.0f;
+}
+
+template <typename L>
+static float sum_impl(const float* x, size_t n) {
+    // kSumLanes partial sums: element i always lands in partial i % kSumLanes
+    constexpr size_t regs = kSumLanes / L::width;
+    typename L::Vec acc[regs];
+    for (size_t r = 0; r < regs; ++r) acc[r] = L::zero();
+
+    size_t i = 0;
+    for (; i + kSumLanes <= n; i += kSumLanes) {
+        for (size_t r = 0; r < regs; ++r) acc[r] = L::add(acc[r], L::load(x + i + r * L::width));
+    }
+
+    float lanes[kSumLanes];
+    for (size_t r = 0; r < regs; ++r) L::store(lanes + r * L::width, acc[r]);
+    for (size_t j = 0; i < n; ++i, ++j) lanes[j] += x[i];
+
+    float total = 0.0f;
+    for (size_t j = 0; j < kSumLanes; ++j) total += lanes[j];
+    return total;
+}
+
+template <typename L>
+static bool all_finite_impl(const float* x, size_t n) {
+    // x * 0 is exactly 0 for finite x and nan for inf / nan, and a sum of zeros cannot overflow
+    const typename L::Vec zero = L::zero();
+    typename L::Vec acc = L::zero();
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) acc = L::add(acc, L::mul(L::load(x + i), zero));
+
+    float lanes[L::width];
+    L::store(lanes, acc);
+    float total = 0.0f;
+    for (size_t j = 0; j < L::width; ++j) total += lanes[j];
+    for (; i < n; ++i) total += x[i] * 0.0f;
+    return total == 0.0f;
+}
+
+template <typename L>
+static void adam_impl(float* param, const float* grad, float* m, float* v, size_t n, const AdamStep& s) {
+    using Vec = typename L::Vec;
+    const Vec beta1 = L::set1(s.beta1), beta2 = L::set1(s.beta2);
+    const Vec one_minus_beta1 = L::set1(s.one_minus_beta1), one_minus_beta2 = L::set1(s.one_minus_beta2);
+    const Vec step_size = L::set1(s.step_size), inv_sqrt_bias2 = L::set1(s.inv_sqrt_bias2);
+    const Vec epsilon = L::set1(s.epsilon), decay = L::set1(s.decay);
+    const Vec grad_scale = L::set1(s.grad_scale);
+    const Vec clip = L::set1(s.clip), neg_clip = L::set1(-s.clip);
+
+    // one vector of elements; min/max return their second operand for nan, so nan gradients stay nan
+    auto update = [&](float* p, const float* gp, float* mp, float* vp) {
+        const Vec g = L::max(neg_clip, L::min(clip, L::mul(grad_scale, L::load(gp))));
+        const Vec m_new = L::add(L::mul(beta1, L::load(mp)), L::mul(one_minus_beta1, g));
+        const Vec v_new = L::add(L::mul(beta2, L::load(vp)), L::mul(L::mul(one_minus_beta2, g), g));
+        const Vec denom = L::add(L::mul(L::sqrt(v_new), inv_sqrt_bias2), epsilon);
+        L::store(p, L::sub(L::mul(decay, L::load(p)), L::div(L::mul(step_size, m_new), denom)));
+        L::store(mp, m_new);
+        L::store(vp, v_new);
+    };
+
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) update(param + i, grad + i, m + i, v + i);
+    if (i == n) return;
+
+    // the tail goes through one zero-padded vector, like the 16-bit conversions below
+    float p[L::width] = {}, g[L::width] = {}, mt[L::width] = {}, vt[L::width] = {};
+    for (size_t j = 0; i + j < n; ++j) {
+        p[j] = param[i + j];
+        g[j] = grad[i + j];
+        mt[j] = m[i + j];
+        vt[j] = v[i + j];
+    }
+    update(p, g, mt, vt);
+    for (size_t j = 0; i + j < n; ++j) {
+        param[i + j] = p[j];
+        m[i + j] = mt[j];
+        v[i + j] = vt[j];
+    }
+}
+
+// 16-bit -> float32 through L::widen (bf16 or fp16 primitive)
+// the tail goes through one zero-padded vector, so every element is converted the same way
+template <typename L, typename L::Vec (*widen)(const uint16_t*)>
+static void widen_impl(const uint16_t* src, float* dst, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) L::store(dst + i, widen(src + i));
+    if (i == n) return;
+
+    uint16_t in[L::width] = {};
+    float out[L::width];
+    for (size_t j = 0; i + j < n; ++j) in[j] = src[i + j];
+    L::store(out, widen(in));
+    for (size_t j = 0; i + j < n; ++j) dst[i + j] = out[j];
+}
+
+template <typename L, void (*narrow)(uint16_t*, typename L::Vec)>
+static void narrow_impl(const float* src, uint16_t* dst, size_t n) {
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width) narrow(dst + i, L::load(src + i));
+    if (i == n) return;
+
+    float in[L::width] = {};
+    uint16_t out[L::width];
+    for (size_t j = 0; i + j < n; ++j) in[j] = src[i + j];
+    narrow(out, L::load(in));
+    for (size_t j = 0; i + j < n; ++j) dst[i + j] = out[j];
+}
+
+template <typename L>
+static SimdKernels make_simd_kernels(const char* name) {
+    SimdKernels k;
+    k.name = name;
+    k.add = add_impl<L>;
+    k.sub = sub_impl<L>;
+    k.mul = mul_impl<L>;
+    k.div = div_impl<L>;
+    k.div_scalar = div_scalar_impl<L>;
+    k.relu = relu_impl<L>;
+    k.accumulate = accumulate_impl<L>;
+    k.subtract = subtract_impl<L>;
+    k.accumulate_scalar = accumulate_scalar_impl<L>;
+    k.accumulate_div = accumulate_div_impl<L>;
+    k.accumulate_mul = accumulate_mul_impl<L>;
+    k.accumulate_scaled_mul = accumulate_scaled_mul_impl<L>;
+    k.relu_backward = relu_backward_impl<L>;
+    k.sum = sum_impl<L>;
+    k.all_finite = all_finite_impl<L>;
+    k.adam = adam_impl<L>;
+    k.widen_bf16 = widen_impl<L, L::load_bf16>;
+    k.narrow_bf16 = narrow_impl<L, L::store_bf16>;
+    k.widen_fp16 = widen_impl<L, L::load_fp16>;
+    k.narrow_fp16 = narrow_impl<L, L::store_fp16>;
+    return k;
+}
@@ -12,8 +12,6 @@
 #include "../op.hpp"
 #include "../graph.hpp"
 
-extern Graph global_graph;
-
 // sub operation handles element-wise subtraction between tensors
 // primarily used in loss computation: prediction - target
 class SubOp : public Op {
@@ -23,6 +21,8 @@ class SubOp : public Op {
 public:
     SubOp(std::shared_ptr<Tensor> a, std::shared_ptr<Tensor> b);
     void backward(Tensor& grad_output) override;
+    void recompute(Tensor& output) override;
+    const char* name() const override { return "sub"; }
 };
 
 // global sub function creates sub operations and integrates with computational graph
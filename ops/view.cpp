@@ -0,0 +1,51 @@
+/*
+ * view.cpp - gradient routing for zero-copy tensor views
+ *
+ * the backward pass is a strided scatter-add: grad_output is packed in the view's shape,
+ * input->grad is packed in the input's shape and the recorded strides connect the two
+ */
+
+#include "view.hpp"
+#include "../strided.hpp"
+#include "elementwise.hpp"
+#include "cast.hpp"
+#include <stdexcept>
+
+ViewOp::ViewOp(const std::shared_ptr<Tensor>& input, std::vector<int> grad_strides_, size_t grad_offset_)
+    : grad_strides(std::move(grad_strides_)), grad_offset(grad_offset_) {
+    inputs.push_back(input);
+}
+
+void ViewOp::backward(Tensor& grad_output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("ViewOp: input expired");
+    if (!input->requires_grad || !needs_input_grad(0)) return;
+
+    if (input->grad.empty()) input->grad.resize(input->numel(), 0.0f);
+
+    const float* g_out = grad_output.grad.data();
+    float* g_in = input->grad.data();
+    if (grad_output.shape.size() > kMaxStridedDims) throw std::runtime_error("ViewOp: tensor rank too high");
+    int out_strides[kMaxStridedDims];
+    contiguous_strides(grad_output.shape, out_strides);
+
+    for_each_row<2>(grad_output.shape, {out_strides, grad_strides.data()}, {0, grad_offset},
+        [&](const std::array<size_t, 2>& off, int count, const std::array<int, 2>& step) {
+            if (step[0] == 1 && step[1] == 1) {
+                simd().accumulate(g_out + off[0], g_in + off[1], count);
+                return;
+            }
+            for (int j = 0; j < count; ++j) {
+                g_in[off[1] + static_cast<size_t>(j) * step[1]] += g_out[off[0] + static_cast<size_t>(j) * step[0]];
+            }
+        });
+}
+
+void ViewOp::recompute(Tensor& output) {
+    auto input = inputs[0].lock();
+    if (!input) throw std::runtime_error("ViewOp: input expired");
+
+    // a view reads its input's storage directly, only a contiguous() copy has data to refresh
+    if (output.storage == input->storage) return;
+    convert_kernel(*input, output);
+}
@@ -0,0 +1,27 @@
+/*
+ * view.hpp - gradient routing for zero-copy tensor views
+ *
+ * views (view, reshape, transpose, narrow/slice) share storage with their input, so their forward
+ * pass costs nothing; the backward pass has to put each gradient element back where it came from:
+ * - the view's layout is recorded in the input's packed index space (the layout of input->grad)
+ * - backward scatters grad_output into input->grad through that layout
+ * - the same op serves contiguous(), whose copy maps onto the input one to one
+ */
+
+#pragma once
+#include "../tensor.hpp"
+#include "../op.hpp"
+
+// view operation: records how view elements map onto the input's gradient buffer
+class ViewOp : public Op {
+public:
+    // grad_strides/grad_offset locate view elements inside the input's packed gradient
+    ViewOp(const std::shared_ptr<Tensor>& input, std::vector<int> grad_strides, size_t grad_offset);
+    void backward(Tensor& grad_output) override;
+    void recompute(Tensor& output) override;
+    const char* name() const override { return "view"; }
+
+private:
+    std::vector<int> grad_strides;
+    size_t grad_offset;
+};
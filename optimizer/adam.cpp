@@ -9,107 +9,228 @@
  */
 
 #include "adam.hpp"
+#include <algorithm>
 #include <cmath>
-#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "../logging.hpp"
+#include "../profiler.hpp"
+#include "../thread_pool.hpp"
+
+// elements per parallel chunk of the concatenated parameter range (whole state blocks)
+static constexpr size_t kAdamGrain = 1 << 14;
+static_assert(kAdamGrain % kAdamStateBlock == 0, "chunks must not split a state block");
+
+// state elements of a parameter: quantized slices are padded to whole blocks
+static size_t state_size(size_t n, bool quantized) {
+    return quantized ? (n + kAdamStateBlock - 1) / kAdamStateBlock * kAdamStateBlock : n;
+}
+
+// m codes: c in [-127, 127] stands for scale * (c / 127)^2 with the sign of c
+static void dequantize_m(const int8_t* codes, float scale, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const float r = codes[i] * (1.0f / 127.0f);
+        out[i] = scale * r * std::fabs(r);
+    }
+}
+
+// returns the block's new scale (its largest magnitude)
+static float quantize_m(const float* x, int8_t* codes, size_t n) {
+    float scale = 0.0f;
+    for (size_t i = 0; i < n; ++i) scale = std::max(scale, std::fabs(x[i]));
+    const float inv = scale > 0.0f ? 1.0f / scale : 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        const float q = std::sqrt(std::fabs(x[i]) * inv) * 127.0f + 0.5f;
+        const int c = q < 127.0f ? static_cast<int>(q) : 127;  // also catches nan
+        codes[i] = static_cast<int8_t>(x[i] < 0.0f ? -c : c);
+    }
+    return scale;
+}
+
+// v codes: c in [0, 255] stands for scale * (c / 255)^4
+static void dequantize_v(const uint8_t* codes, float scale, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const float r = codes[i] * (1.0f / 255.0f);
+        out[i] = scale * (r * r) * (r * r);
+    }
+}
+
+// a nonzero v never rounds to 0: that would turn its denominator into epsilon
+static float quantize_v(const float* x, uint8_t* codes, size_t n) {
+    float scale = 0.0f;
+    for (size_t i = 0; i < n; ++i) scale = std::max(scale, x[i]);
+    const float inv = scale > 0.0f ? 1.0f / scale : 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        const float q = std::sqrt(std::sqrt(x[i] * inv)) * 255.0f + 0.5f;
+        const int c = q < 255.0f ? static_cast<int>(q) : 255;
+        codes[i] = static_cast<uint8_t>(c == 0 && x[i] > 0.0f ? 1 : c);
+    }
+    return scale;
+}
 
 // constructor initializes hyperparameters with sensible defaults
 // beta1=0.9 provides momentum, beta2=0.999 provides adaptive learning rate scaling
 Adam::Adam(float learning_rate, float beta1_, float beta2_, float epsilon_)
-    : lr(learning_rate), beta1(beta1_), beta2(beta2_), epsilon(epsilon_), t(0), initialized(false) {}
+    : lr(learning_rate), beta1(beta1_), beta2(beta2_), epsilon(epsilon_), t(0),
+      m(tracked_heap(MemoryCategory::OptimizerState)), v(tracked_heap(MemoryCategory::OptimizerState)),
+      m_codes(tracked_heap(MemoryCategory::OptimizerState)), v_codes(tracked_heap(MemoryCategory::OptimizerState)),
+      m_scales(tracked_heap(MemoryCategory::OptimizerState)), v_scales(tracked_heap(MemoryCategory::OptimizerState)),
+      initialized(false) {}
 
-// initializes momentum and variance buffers for all parameters
-// these buffers will store running averages of gradients and squared gradients
+// lays out one slice of the moment buffers per parameter, all zero
 // called automatically on first step if not manually initialized
 void Adam::initialize_state(const std::vector<std::shared_ptr<Tensor>>& params) {
-    std::cout << "[Adam] Initializing state for " << params.size() << " parameters\n";
-    m.clear();
-    v.clear();
-    m.reserve(params.size());
-    v.reserve(params.size());
-
+    LOG_DEBUG("[Adam] Initializing state for " << params.size() << " parameters");
+    offsets.assign(1, 0);
+    sizes.clear();
     for (size_t i = 0; i < params.size(); ++i) {
-        auto& p = params[i];
-        size_t size = p->data.size();
-        std::cout << "[Adam] Param " << i << " size: " << size << "\n";
-        // initialize momentum buffer (first moment) for parameter i
-        m.emplace_back(size, 0.0f);
-        // initialize variance buffer (the second moment) for parameter i
-        v.emplace_back(size, 0.0f);
+        const size_t size = params[i]->numel();
+        LOG_DEBUG("[Adam] Param " << i << " size: " << size);
+        sizes.push_back(size);
+        offsets.push_back(offsets.back() + state_size(size, quantized_state));
+    }
+
+    if (quantized_state) {
+        // all-zero codes and scales decode to zero moments
+        m_codes.assign(offsets.back(), 0);
+        v_codes.assign(offsets.back(), 0);
+        m_scales.assign(offsets.back() / kAdamStateBlock, 0.0f);
+        v_scales.assign(offsets.back() / kAdamStateBlock, 0.0f);
+    } else {
+        m.assign(offsets.back(), 0.0f);
+        v.assign(offsets.back(), 0.0f);
     }
     initialized = true;
-    std::cout << "[Adam] Initialization done.\n";
+    LOG_DEBUG("[Adam] Initialization done (" << offsets.back() << " elements, " << state_bytes() << " bytes).");
 }
 
 // performs one optimization step using the adam algorithm
 // updates all parameters using their computed gradients and stored momentum/variance
-void Adam::step(const std::vector<std::shared_ptr<Tensor>>& params) {
+void Adam::step(const std::vector<std::shared_ptr<Tensor>>& params, float grad_scale) {
+    ProfileScope profile("adam_step", "optimizer");
+
     if (!initialized) {
         initialize_state(params);
     }
-    ++t; // increment timestep for bias correction
-    
-    // gradient clipping prevents extreme gradient values that could destabilize training
-    // clips gradients to maximum norm of 1.0 to maintain numerical stability
-    float max_grad_norm = 1.0f;  // clip gradients to this max norm
-    for (auto& param : params) {
-        if (!param->requires_grad || param->grad.empty()) continue;
-        for (auto& grad : param->grad) {
-            if (std::abs(grad) > max_grad_norm) {
-                grad = std::copysign(max_grad_norm, grad);
-            }
-        }
+    if (params.size() + 1 != offsets.size()) {
+        throw std::runtime_error("Adam::step: got " + std::to_string(params.size()) + " parameters, state has " +
+                                 std::to_string(offsets.size() - 1) + " (call zero_state() for a new model)");
     }
-    std::cout << "[Adam] Step " << t << " updating parameters.\n";
+    ++t; // increment timestep for bias correction
+    LOG_DEBUG("[Adam] Step " << t << " updating parameters.");
 
-    // update each parameter using adam algorithm
+    // collect the parameters that have a gradient this step
+    segments.clear();
+    size_t total = 0;
     for (size_t i = 0; i < params.size(); ++i) {
         auto& p = params[i];
+        const size_t size = sizes[i];
+        if (static_cast<size_t>(p->numel()) != size) {
+            throw std::runtime_error("Adam::step: parameter " + std::to_string(i) + " changed size");
+        }
         if (!p->requires_grad) {
-            std::cout << "[Adam] Param " << i << " does not require grad, skipping.\n";
+            LOG_DEBUG("[Adam] Param " << i << " does not require grad, skipping.");
             continue;
         }
 
         // validate gradient and parameter size consistency
-        if (p->grad.size() != p->data.size()) {
-            std::cerr << "[Adam] ERROR: Grad and data size mismatch for param " << i
-                      << " grad size: " << p->grad.size() << ", data size: " << p->data.size() << "\n";
+        if (p->grad.size() != size) {
+            LOG_ERROR("[Adam] ERROR: Grad and data size mismatch for param " << i
+                      << " grad size: " << p->grad.size() << ", data size: " << size);
             continue;
         }
 
-        std::cout << "[Adam] Updating param " << i << " (size " << p->data.size() << ")\n";
-        for (size_t j = 0; j < p->data.size(); ++j) {
-            float grad = p->grad[j];
-
-            // update momentum (first moment) - exponential moving average of gradients
-            m[i][j] = beta1 * m[i][j] + (1.0f - beta1) * grad;
-            // update variance (second moment) - exponential moving average of squared gradients
-            v[i][j] = beta2 * v[i][j] + (1.0f - beta2) * grad * grad;
+        // neighbours in memory (flattened parameters, src/flat_parameters.hpp) become one segment
+        // (with quantized state only when the previous slice fills whole blocks)
+        float* values = p->data().data();
+        Segment* last = segments.empty() ? nullptr : &segments.back();
+        if (last && last->param + last->size == values && last->grad + last->size == p->grad.data() &&
+            last->state + last->size == offsets[i]) {
+            last->size += size;
+            total = last->begin + state_size(last->size, quantized_state);
+        } else {
+            segments.push_back({values, p->grad.data(), offsets[i], total, size});
+            total += state_size(size, quantized_state);
+        }
+    }
 
-            // bias correction for early training steps when moving averages are biased toward zero
-            float m_hat = m[i][j] / (1.0f - std::pow(beta1, t));
-            float v_hat = v[i][j] / (1.0f - std::pow(beta2, t));
+    // bias corrections and the decay factor, once per step
+    AdamStep s;
+    s.beta1 = beta1;
+    s.beta2 = beta2;
+    s.one_minus_beta1 = 1.0f - beta1;
+    s.one_minus_beta2 = 1.0f - beta2;
+    s.step_size = static_cast<float>(lr / (1.0 - std::pow(static_cast<double>(beta1), t)));
+    s.inv_sqrt_bias2 = static_cast<float>(1.0 / std::sqrt(1.0 - std::pow(static_cast<double>(beta2), t)));
+    s.epsilon = epsilon;
+    s.decay = 1.0f - lr * weight_decay;
+    s.grad_scale = grad_scale;
+    s.clip = max_grad_value;
 
-            // compute adaptive learning rate and parameter update
-            float update = lr * m_hat / (std::sqrt(v_hat) + epsilon);
-            p->data[j] -= update;
+    // every chunk of the concatenated range updates the pieces of the segments it covers
+    // (quantized segments are padded to whole blocks in the range, so chunks start on a block)
+    parallel_for(0, total, kAdamGrain, [&](size_t lo, size_t hi) {
+        auto seg = std::upper_bound(segments.begin(), segments.end(), lo,
+                                    [](size_t x, const Segment& g) { return x < g.begin; }) - 1;
+        for (; seg != segments.end() && seg->begin < hi; ++seg) {
+            const size_t first = std::max(lo, seg->begin) - seg->begin;
+            const size_t last = std::min(hi, seg->begin + seg->size) - seg->begin;
+            if (first >= last) continue;  // chunk starts in the block padding after the segment
 
-            // print first few updates for debugging and monitoring training progress
-            if (j < 3) {
-                std::cout << "  idx " << j << ": grad=" << grad << ", m=" << m[i][j] << ", v=" << v[i][j]
-                          << ", m_hat=" << m_hat << ", v_hat=" << v_hat << ", update=" << update
-                          << ", new_param=" << p->data[j] << "\n";
+            const size_t state = seg->state + first;
+            if (quantized_state) {
+                update_quantized(seg->param + first, seg->grad + first, state, last - first, s);
+            } else {
+                simd().adam(seg->param + first, seg->grad + first, m.data() + state, v.data() + state, last - first, s);
             }
         }
+    });
+    LOG_DEBUG("[Adam] Step " << t << " complete.");
+}
+
+// dequantize one block at a time into L1, run the float kernel on it, requantize with new scales
+// state is block aligned, so every block here is one of the stored ones
+void Adam::update_quantized(float* param, const float* grad, size_t state, size_t n, const AdamStep& s) {
+    float block_m[kAdamStateBlock];
+    float block_v[kAdamStateBlock];
+    for (size_t j = 0; j < n; j += kAdamStateBlock) {
+        const size_t count = std::min(kAdamStateBlock, n - j);
+        const size_t block = (state + j) / kAdamStateBlock;
+        int8_t* mc = m_codes.data() + state + j;
+        uint8_t* vc = v_codes.data() + state + j;
+
+        dequantize_m(mc, m_scales[block], block_m, count);
+        dequantize_v(vc, v_scales[block], block_v, count);
+        simd().adam(param + j, grad + j, block_m, block_v, count, s);
+        m_scales[block] = quantize_m(block_m, mc, count);
+        v_scales[block] = quantize_v(block_v, vc, count);
     }
-    std::cout << "[Adam] Step " << t << " complete.\n";
+}
+
+void Adam::set_quantized_state(bool enabled) {
+    if (initialized && enabled != quantized_state) {
+        throw std::runtime_error("Adam::set_quantized_state: optimizer already has state, call zero_state() first");
+    }
+    quantized_state = enabled;
+}
+
+size_t Adam::state_bytes() const {
+    return (m.size() + v.size() + m_scales.size() + v_scales.size()) * sizeof(float) + m_codes.size() +
+           v_codes.size();
 }
 
 // clears all optimizer state including momentum and variance buffers
 // useful for restarting training or switching between different optimization strategies
 void Adam::zero_state() {
-    std::cout << "[Adam] Clearing optimizer state.\n";
+    LOG_DEBUG("[Adam] Clearing optimizer state.");
     m.clear();
     v.clear();
+    m_codes.clear();
+    v_codes.clear();
+    m_scales.clear();
+    v_scales.clear();
+    offsets.clear();
+    sizes.clear();
     t = 0;
     initialized = false;
 }
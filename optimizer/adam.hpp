@@ -1,42 +1,115 @@
 /*
  * adam.hpp - adam optimizer for neural network training
  * 
- * implements the adam (adaptive moment estimation) optimizer
+ * implements the adam (adaptive moment estimation) optimizer and its decoupled
+ * weight decay variant adamw
+ *
+ * each step is a single fused pass per element (ops/simd.hpp adam kernel):
+ * - the gradient is clamped, both moments are updated and the parameter is written,
+ *   with the bias corrections computed once per step instead of per element
+ * - the moments of all parameters live in two flat buffers, one slice per parameter
+ * - the parameters are walked as one concatenated range split across the thread pool,
+ *   so many small tensors are spread over the threads as well as a few large ones
+ * - flattened parameters (src/flat_parameters.hpp) are adjacent in memory and merge into a
+ *   single segment, so the whole model is updated as one span
+ *
+ * set_quantized_state(true) keeps both moments in 8 bits per element (~4x less optimizer memory):
+ * - each block of kAdamStateBlock elements stores one float scale (its largest magnitude)
+ *   and a code per element; m is signed with a square-root code, v unsigned with a fourth-root
+ *   code, so small values keep several significant bits next to large ones in the same block
+ * - the step dequantizes a block into L1, runs the same adam kernel and requantizes it with
+ *   the block's new scale; blocks never straddle two parameters
+ *
+ * IMPORTANT: the parameter list must keep the same tensors (and sizes) from step to step,
+ * call zero_state() before switching to a different model
  */
 
 #pragma once
 
 #include "../tensor.hpp"
+#include "../ops/simd.hpp"
+#include <cstdint>
 #include <vector>
 #include <memory>
+#include <memory_resource>
+
+// elements per scale of the 8-bit moments
+constexpr size_t kAdamStateBlock = 256;
 
 class Adam {
 public:
     // constructor with default hyperparameters (good for most cases)
     Adam(float learning_rate = 0.001f, float beta1 = 0.9f, float beta2 = 0.999f, float epsilon = 1e-8f);
+    virtual ~Adam() = default;
 
     // update parameters using computed gradients
     // this is the main training step that modifies model weights
-    void step(const std::vector<std::shared_ptr<Tensor>>& params);
+    // grad_scale multiplies every gradient before clipping (loss_scaler.hpp passes 1 / loss scale)
+    void step(const std::vector<std::shared_ptr<Tensor>>& params, float grad_scale = 1.0f);
     
     // reset optimizer state (optional, rarely needed)
     void zero_state();
 
-private:
+    // 8-bit blockwise moments instead of float32 ones; set before the first step (or after zero_state)
+    void set_quantized_state(bool enabled);
+
+    // bytes held by the moments (and their block scales)
+    size_t state_bytes() const;
+
+protected:
     // hyperparameters
     float lr;        // learning rate - controls step size
     float beta1;     // first moment decay rate (momentum)
     float beta2;     // second moment decay rate (variance)
     float epsilon;   // small constant to prevent division by zero
+    float weight_decay = 0.0f;    // decoupled (adamw) decay, 0 for plain adam
+    float max_grad_value = 1.0f;  // gradients are clamped to [-max_grad_value, max_grad_value]
 
+private:
     // internal state
     int t;           // timestep counter for bias correction
-    std::vector<std::vector<float>> m;  // first moment (momentum) for each parameter
-    std::vector<std::vector<float>> v;  // second moment (variance) for each parameter
+    // allocated from the optimizer-state heap so memory accounting sees them (memory.hpp)
+    // parameter i owns elements [offsets[i], offsets[i + 1]) of the moment buffers; with quantized
+    // state every slice starts on a block boundary
+    std::pmr::vector<float> m;  // first moment (momentum) of every parameter
+    std::pmr::vector<float> v;  // second moment (variance) of every parameter
+    std::vector<size_t> offsets;
+    std::vector<size_t> sizes;   // elements of parameter i
+
+    // quantized state: codes per element and one scale per block, m and v unused
+    bool quantized_state = false;
+    std::pmr::vector<int8_t> m_codes;
+    std::pmr::vector<uint8_t> v_codes;
+    std::pmr::vector<float> m_scales;
+    std::pmr::vector<float> v_scales;
+
+    // the parameters updated this step, as consecutive pieces of one range (reused across steps)
+    struct Segment {
+        float* param;
+        const float* grad;
+        size_t state;  // first element in the moment buffers
+        size_t begin;  // position in the concatenated range
+        size_t size;
+    };
+    std::vector<Segment> segments;
 
     // initialization state
     bool initialized;
     
     // initialize optimizer state for given parameters
     void initialize_state(const std::vector<std::shared_ptr<Tensor>>& params);
+
+    // one piece of a segment through the dequantize / update / requantize blocks
+    void update_quantized(float* param, const float* grad, size_t state, size_t n, const AdamStep& s);
+};
+
+// adam with decoupled weight decay: every step also shrinks the parameters by lr * weight_decay
+// (applied to all parameters, biases included)
+class AdamW : public Adam {
+public:
+    AdamW(float learning_rate = 0.001f, float beta1 = 0.9f, float beta2 = 0.999f, float epsilon = 1e-8f,
+          float weight_decay_ = 0.01f)
+        : Adam(learning_rate, beta1, beta2, epsilon) {
+        weight_decay = weight_decay_;
+    }
 };
@@ -0,0 +1,58 @@
+/*
+ * loss_scaler.cpp - overflow detection and scale updates of the dynamic loss scaler
+ */
+
+#include "loss_scaler.hpp"
+#include <stdexcept>
+#include "../logging.hpp"
+#include "../ops/simd.hpp"
+
+DynamicLossScaler::DynamicLossScaler(float initial_scale, float growth_factor_, float backoff_factor_,
+                                     int growth_interval_)
+    : current_scale(initial_scale), growth_factor(growth_factor_), backoff_factor(backoff_factor_),
+      growth_interval(growth_interval_) {
+    if (!(initial_scale > 0.0f) || !(growth_factor_ >= 1.0f) || !(backoff_factor_ > 0.0f && backoff_factor_ < 1.0f)) {
+        throw std::runtime_error("DynamicLossScaler: need scale > 0, growth >= 1 and 0 < backoff < 1");
+    }
+}
+
+// Tensor::backward only seeds a loss gradient of 1 when there is none yet
+void DynamicLossScaler::backward(const std::shared_ptr<Tensor>& loss) {
+    loss->grad.assign(loss->numel(), current_scale);
+    loss->backward();
+}
+
+void DynamicLossScaler::backward(const std::shared_ptr<Tensor>& loss,
+                                 const std::vector<std::shared_ptr<Tensor>>& leaves) {
+    loss->grad.assign(loss->numel(), current_scale);
+    loss->backward(leaves);
+}
+
+bool DynamicLossScaler::step(Adam& optimizer, const std::vector<std::shared_ptr<Tensor>>& params) {
+    // read-only check before adam touches anything: an overflowed step must leave the
+    // parameters and moments as they were, which a check inside the update pass cannot do
+    bool finite = true;
+    for (const auto& p : params) {
+        if (!p->requires_grad || p->grad.empty()) continue;
+        if (!simd().all_finite(p->grad.data(), p->grad.size())) {
+            finite = false;
+            break;
+        }
+    }
+
+    if (!finite) {
+        current_scale *= backoff_factor;
+        clean_steps = 0;
+        ++skipped;
+        LOG_DEBUG("[LossScaler] gradient overflow, step skipped, scale now " << current_scale);
+        return false;
+    }
+
+    optimizer.step(params, 1.0f / current_scale);
+    if (++clean_steps >= growth_interval) {
+        current_scale *= growth_factor;
+        clean_steps = 0;
+        LOG_DEBUG("[LossScaler] scale grown to " << current_scale);
+    }
+    return true;
+}
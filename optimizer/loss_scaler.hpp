@@ -0,0 +1,48 @@
+/*
+ * loss_scaler.hpp - dynamic loss scaling for mixed-precision training
+ *
+ * small gradients of 16-bit activations (autocast.hpp) vanish unless the loss is scaled up
+ * before backward; the scaler keeps that scale as large as possible without overflowing:
+ * - backward() seeds the loss gradient with the scale instead of 1 (no extra op)
+ * - step() checks every gradient for inf/nan; an overflowed step is skipped and the scale
+ *   halved, otherwise adam runs with the unscale fused into its clamp (ops/simd.hpp adam)
+ * - after growth_interval clean steps in a row the scale doubles again
+ *
+ * usage:
+ *     scaler.backward(loss, model->parameters());
+ *     if (!scaler.step(optimizer, model->parameters())) { ... step skipped ... }
+ *
+ * IMPORTANT: the finite check is its own read-only vectorized pass (simd().all_finite) ahead of
+ * adam: a skipped step must not touch parameters or moments, so it cannot live in the update
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "adam.hpp"
+#include "../tensor.hpp"
+
+class DynamicLossScaler {
+public:
+    DynamicLossScaler(float initial_scale = 65536.0f, float growth_factor = 2.0f, float backoff_factor = 0.5f,
+                      int growth_interval = 2000);
+
+    // backpropagates scale * loss (into leaves only, when given)
+    void backward(const std::shared_ptr<Tensor>& loss);
+    void backward(const std::shared_ptr<Tensor>& loss, const std::vector<std::shared_ptr<Tensor>>& leaves);
+
+    // unscaled adam step when every gradient is finite; returns false (and backs off) otherwise
+    bool step(Adam& optimizer, const std::vector<std::shared_ptr<Tensor>>& params);
+
+    float scale() const { return current_scale; }
+    size_t skipped_steps() const { return skipped; }
+
+private:
+    float current_scale;
+    float growth_factor;
+    float backoff_factor;
+    int growth_interval;
+    int clean_steps = 0;   // finite steps since the last change of scale
+    size_t skipped = 0;
+};
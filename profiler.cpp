@@ -0,0 +1,112 @@
+/*
+ * profiler.cpp - event storage, aggregation and chrome trace export
+ */
+
+#include "profiler.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+// one finished scope
+struct ProfileEvent {
+    const char* name;
+    const char* category;
+    int64_t start_ns;
+    int64_t duration_ns;
+    int thread;
+};
+
+static std::mutex& events_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<ProfileEvent>& events() {
+    static std::vector<ProfileEvent> recorded;
+    return recorded;
+}
+
+// small stable thread ids for the trace viewer's rows
+static int thread_index() {
+    static std::atomic<int> next{0};
+    static thread_local int index = next.fetch_add(1);
+    return index;
+}
+
+static const std::chrono::steady_clock::time_point clock_start = std::chrono::steady_clock::now();
+
+void Profiler::set_enabled(bool enabled) {
+    active.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(events_mutex());
+    events().clear();
+}
+
+int64_t Profiler::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clock_start).count();
+}
+
+void Profiler::record(const char* name, const char* category, int64_t start_ns, int64_t duration_ns) {
+    const int thread = thread_index();
+    std::lock_guard<std::mutex> lock(events_mutex());
+    events().push_back({name, category, start_ns, duration_ns, thread});
+}
+
+std::vector<ProfileStat> Profiler::summary() {
+    std::map<std::pair<std::string, std::string>, ProfileStat> totals;
+    {
+        std::lock_guard<std::mutex> lock(events_mutex());
+        for (const ProfileEvent& e : events()) {
+            ProfileStat& stat = totals[{e.category, e.name}];
+            stat.count++;
+            stat.total_ms += e.duration_ns * 1e-6;
+        }
+    }
+
+    std::vector<ProfileStat> stats;
+    for (auto& entry : totals) {
+        entry.second.category = entry.first.first;
+        entry.second.name = entry.first.second;
+        stats.push_back(std::move(entry.second));
+    }
+    std::sort(stats.begin(), stats.end(),
+              [](const ProfileStat& a, const ProfileStat& b) { return a.total_ms > b.total_ms; });
+    return stats;
+}
+
+void Profiler::print_summary(std::ostream& out) {
+    out << std::left << std::setw(12) << "category" << std::setw(16) << "name"
+        << std::right << std::setw(10) << "calls" << std::setw(14) << "total ms" << std::setw(12) << "avg us" << "\n";
+    for (const ProfileStat& stat : summary()) {
+        out << std::left << std::setw(12) << stat.category << std::setw(16) << stat.name
+            << std::right << std::setw(10) << stat.count
+            << std::setw(14) << std::fixed << std::setprecision(3) << stat.total_ms
+            << std::setw(12) << std::setprecision(1) << stat.total_ms * 1000.0 / stat.count << "\n";
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+void Profiler::write_chrome_trace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error("Profiler: cannot open " + path);
+
+    std::lock_guard<std::mutex> lock(events_mutex());
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    for (const ProfileEvent& e : events()) {
+        // timestamps are microseconds in the trace_event format
+        file << (first ? "\n" : ",\n")
+             << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\""
+             << ",\"ts\":" << std::fixed << std::setprecision(3) << e.start_ns * 1e-3
+             << ",\"dur\":" << e.duration_ns * 1e-3
+             << ",\"pid\":0,\"tid\":" << e.thread << "}";
+        first = false;
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
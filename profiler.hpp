@@ -0,0 +1,84 @@
+/*
+ * profiler.hpp - scoped wall-time profiling with chrome trace export
+ *
+ * answers "where did this step's time go":
+ * - ProfileScope marks a region (forward op, Op::backward, optimizer step, data loading)
+ * - events are kept in memory while profiling is enabled and can be
+ *   aggregated per (category, name) or dumped as a chrome trace_event file
+ *   (open it in chrome://tracing or https://ui.perfetto.dev)
+ * - while disabled a scope costs two relaxed atomic loads (profiler and memory tracker)
+ *
+ * usage:
+ *     Profiler::set_enabled(true);
+ *     ... training steps ...
+ *     Profiler::print_summary(std::cout);
+ *     Profiler::write_chrome_trace("trace.json");
+ *
+ * IMPORTANT: names and categories must be string literals (or otherwise outlive the profiler),
+ * only the pointers are stored
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "memory.hpp"
+
+// aggregated time of one (category, name) pair
+struct ProfileStat {
+    std::string category;
+    std::string name;
+    size_t count = 0;
+    double total_ms = 0.0;
+};
+
+class Profiler {
+public:
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    static void set_enabled(bool enabled);
+
+    // drops all recorded events
+    static void reset();
+
+    // nanoseconds since the profiler clock started
+    static int64_t now_ns();
+
+    // stores one finished event (called by ProfileScope)
+    static void record(const char* name, const char* category, int64_t start_ns, int64_t duration_ns);
+
+    // per (category, name) totals, most expensive first
+    static std::vector<ProfileStat> summary();
+    static void print_summary(std::ostream& out);
+
+    // writes every recorded event as complete ("X") events of the chrome trace_event format
+    static void write_chrome_trace(const std::string& path);
+
+private:
+    static inline std::atomic<bool> active{false};
+};
+
+// times the enclosing scope when profiling is enabled
+// and names the op allocations are attributed to while memory tracking is enabled (memory.hpp)
+class ProfileScope {
+public:
+    ProfileScope(const char* name_, const char* category_)
+        : name(name_), category(category_), start(Profiler::enabled() ? Profiler::now_ns() : -1),
+          tagged(MemoryTracker::enabled()), outer_op(tagged ? MemoryTracker::enter_op(name_) : nullptr) {}
+    ~ProfileScope() {
+        if (start >= 0) Profiler::record(name, category, start, Profiler::now_ns() - start);
+        if (tagged) MemoryTracker::leave_op(outer_op);
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    int64_t start;  // -1 when profiling was off at construction
+    bool tagged;    // memory tracking was on at construction
+    const char* outer_op;
+};
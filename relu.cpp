@@ -14,72 +14,92 @@
 #include "tensor.hpp"
 #include "graph.hpp"
 #include "op.hpp"
-
-// global graph manager prevents premature destruction of tensors during computation
-// critical for maintaining computational graph integrity across forward/backward passes
-extern Graph global_graph;
+#include "ops/elementwise.hpp"
+#include "ops/cast.hpp"
+#include "grad_mode.hpp"
+#include "profiler.hpp"
 
 // constructor stores input tensor reference for gradient computation during backpropagation
 // weak references prevent circular dependencies while maintaining access to input data
-ReLUOp::ReLUOp(std::shared_ptr<Tensor> input) : input(input) {}
+ReLUOp::ReLUOp(std::shared_ptr<Tensor> input) : input(input) {
+    inputs.push_back(input);
+}
+
+// apply relu activation element-wise: max(0, x)
+// this creates the "dead relu" problem where negative inputs produce zero gradients
+static void relu_kernel(const Tensor& input, Tensor& output) {
+    float* out = output.storage->data();
+    if (input.is_contiguous()) {
+        simd().relu(input.storage->data() + input.offset, out, input.numel());
+        return;
+    }
+    for_each_element(input, [out](size_t i, float x) {
+        out[i] = std::max(0.0f, x);
+    });
+}
 
 std::shared_ptr<Tensor> ReLUOp::forward() {
     // create output tensor with same shape and gradient requirements as input
     // this maintains the computational graph structure for backpropagation
-    output = std::make_shared<Tensor>(input->shape, input->requires_grad);
-    
-    // apply relu activation element-wise: max(0, x)
-    // this creates the "dead relu" problem where negative inputs produce zero gradients
-    for (size_t i = 0; i < input->data.size(); ++i) {
-        output->data[i] = std::max(0.0f, input->data[i]);
-    }
-    
+    output = current_graph().make_tensor(input->shape, GradMode::track(input->requires_grad));
+    relu_kernel(*input, *output);
     return output;
 }
 
+void ReLUOp::recompute(Tensor& output) {
+    relu_kernel(*input, output);
+}
+
 void ReLUOp::backward(Tensor& grad_output) {
-    if (!input->requires_grad) return;
+    if (!input->requires_grad || !needs_input_grad(0)) return;
     
     // initialize gradient buffer if needed (lazy allocation to save memory)
     // gradient buffers are only allocated when actually needed for backpropagation
     if (input->grad.empty()) {
-        input->grad.resize(input->data.size(), 0.0f);
+        input->grad.resize(input->numel(), 0.0f);
     }
     
     // compute gradients w.r.t. input: ∂relu/∂x = 1 if x > 0, else 0
     // this is the key insight: relu gradient is discontinuous at x=0 but rarely causes issues
-    for (size_t i = 0; i < input->data.size(); ++i) {
+    float* g_in = input->grad.data();
+    const float* g_out = grad_output.grad.data();
+    if (input->is_contiguous()) {
+        simd().relu_backward(input->storage->data() + input->offset, g_out, g_in, input->numel());
+        return;
+    }
+    for_each_element(*input, [=](size_t i, float x) {
         // relu gradient: 1 if input > 0, 0 otherwise
         // this creates sparse gradients which can help with feature selection
-        float grad = (input->data[i] > 0.0f) ? grad_output.grad[i] : 0.0f;
-        input->grad[i] += grad;
-    }
-
-    // propagate gradients to input tensor's creator to maintain gradient chain
-    // critical fix: check if creator is different to prevent infinite loops
-    auto input_creator = input->creator.lock();
-    if (input_creator && input_creator.get() != this) {
-        // only propagate if the creator is different from this operation
-        input_creator->backward(*input);
-    }
+        float grad = (x > 0.0f) ? g_out[i] : 0.0f;
+        g_in[i] += grad;
+    });
 }
 
 std::shared_ptr<Tensor> ReLU::forward(std::shared_ptr<Tensor> input) {
+    ProfileScope profile("relu", "forward");
+    input = as_float32(input);
+
+    // inference path: no op, no creator, no graph registration
+    if (!GradMode::track(input->requires_grad)) {
+        auto result = std::make_shared<Tensor>(input->shape, false, tracked_heap(MemoryCategory::Activation));
+        relu_kernel(*input, *result);
+        return result;
+    }
+
     // create a proper relu operation to maintain gradient chain
     // this separates the module interface from the operation implementation
-    auto op = std::make_shared<ReLUOp>(input);
+    Graph& graph = current_graph();
+    auto op = graph.make_op<ReLUOp>(input);
     auto result = op->forward();
     
     // set the creator after forward to ensure proper gradient chain
     // this links the output tensor to its creating operation for backpropagation
-    if (input->requires_grad) {
-        result->set_creator(op);
-    }
+    result->set_creator(op);
     
-    // register tensor and operation with global graph for lifetime management
+    // register tensor and operation with the current graph for lifetime management
     // prevents premature destruction of intermediate computation results
-    global_graph.add_tensor(result);
-    global_graph.add_op(op);
+    graph.add_tensor(result);
+    graph.add_op(op);
     
     return result;
 }
@@ -50,10 +50,13 @@ public:
     // backward pass: computes gradients w.r.t. input
     // gradient is 1 if input > 0, 0 otherwise (simple but effective)
     void backward(Tensor& grad_output) override;
+
+    // re-applies relu into the existing output buffer (graph replay)
+    void recompute(Tensor& output) override;
     
     // operation identification for debugging and graph inspection
     // helps track computation flow during backpropagation
-    std::string name() const { return "ReLU"; }
+    const char* name() const override { return "relu"; }
     
 private:
     std::shared_ptr<Tensor> input;   // input tensor for gradient computation
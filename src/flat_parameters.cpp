@@ -0,0 +1,147 @@
+/*
+ * flat_parameters.cpp - the parameter block and the slices it hands to each tensor
+ *
+ * every parameter storage and gradient vector is re-created on a SliceResource, a memory
+ * resource that always returns the same fixed range of the block, so the pmr vectors of
+ * Storage and Tensor need no changes to live inside it
+ */
+
+#include "flat_parameters.hpp"
+#include "../memory.hpp"
+#include "../logging.hpp"
+#include "../strided.hpp"
+#include "../ops/cast.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+
+static constexpr size_t kFlatAlignment = 64;
+
+// hands out one fixed slice of the block: the single buffer of one storage or gradient
+class SliceResource : public std::pmr::memory_resource {
+public:
+    SliceResource(float* base_, size_t capacity_) : base(base_), capacity(capacity_ * sizeof(float)) {}
+
+private:
+    void* do_allocate(size_t bytes, size_t) override {
+        if (bytes > capacity) throw std::bad_alloc();
+        return base;
+    }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    float* base;
+    size_t capacity;
+};
+
+// the two aligned buffers and the slice resources pointing into them
+// owned by every parameter storage (Storage::owner) and by the FlatParameters
+struct FlatParameters::Block {
+    size_t size = 0;
+    float* values = nullptr;
+    float* grads = nullptr;
+    std::vector<std::unique_ptr<SliceResource>> slices;
+
+    explicit Block(size_t size_) : size(size_) {
+        const size_t bytes = std::max<size_t>(size, 1) * sizeof(float);
+        values = static_cast<float*>(tracked_heap(MemoryCategory::Parameter)->allocate(bytes, kFlatAlignment));
+        grads = static_cast<float*>(tracked_heap(MemoryCategory::Gradient)->allocate(bytes, kFlatAlignment));
+    }
+    ~Block() {
+        const size_t bytes = std::max<size_t>(size, 1) * sizeof(float);
+        tracked_heap(MemoryCategory::Parameter)->deallocate(values, bytes, kFlatAlignment);
+        tracked_heap(MemoryCategory::Gradient)->deallocate(grads, bytes, kFlatAlignment);
+    }
+
+    Block(const Block&) = delete;
+    Block& operator=(const Block&) = delete;
+
+    SliceResource* slice(float* base, size_t count) {
+        slices.push_back(std::make_unique<SliceResource>(base, count));
+        return slices.back().get();
+    }
+};
+
+// re-creates the gradient vector of param on resource, keeping its values (zero if it had none)
+// pmr vectors never change allocator on assignment, hence the destroy + move-construct
+static void move_grad(Tensor& param, std::pmr::memory_resource* resource) {
+    std::pmr::vector<float> grad(param.numel(), 0.0f, resource);
+    if (param.grad.size() == grad.size()) std::copy(param.grad.begin(), param.grad.end(), grad.begin());
+
+    using GradVector = std::pmr::vector<float>;
+    param.grad.~GradVector();
+    new (&param.grad) GradVector(std::move(grad));
+}
+
+FlatParameters::FlatParameters(const std::vector<std::shared_ptr<Tensor>>& params_) : params(params_) {
+    offsets.assign(1, 0);
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (params[i]->dtype() != DType::Float32) {
+            throw std::runtime_error("FlatParameters: parameter " + std::to_string(i) + " is " +
+                                     dtype_name(params[i]->dtype()) + ", flat parameters are float32");
+        }
+        for (size_t j = 0; j < i; ++j) {
+            if (params[j] == params[i]) throw std::runtime_error("FlatParameters: parameter listed twice");
+        }
+        offsets.push_back(offsets.back() + params[i]->numel());
+    }
+
+    block = std::make_shared<Block>(offsets.back());
+    for (size_t i = 0; i < params.size(); ++i) {
+        Tensor& param = *params[i];
+        const size_t n = offsets[i + 1] - offsets[i];
+
+        // the gradient first: its old buffer may belong to a previous block that only the
+        // old storage still keeps alive
+        move_grad(param, block->slice(block->grads + offsets[i], n));
+
+        auto storage = std::make_shared<Storage>(n, block->slice(block->values + offsets[i], n));
+        storage->owner = block;
+        Tensor packed(storage, param.shape, contiguous_strides(param.shape), 0);
+        convert_kernel(param, packed);
+
+        param.storage = storage;
+        param.strides = packed.strides;
+        param.offset = 0;
+    }
+    LOG_DEBUG("[FlatParameters] " << params.size() << " parameters, " << size() << " elements");
+}
+
+Span<float> FlatParameters::values() {
+    return Span<float>(block->values, size());
+}
+
+Span<float> FlatParameters::grads() {
+    return Span<float>(block->grads, size());
+}
+
+void FlatParameters::zero_grad() {
+    std::memset(block->grads, 0, size() * sizeof(float));
+}
+
+void FlatParameters::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw std::runtime_error("FlatParameters::save: cannot open " + path);
+
+    const uint64_t count = size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(block->values), static_cast<std::streamsize>(count * sizeof(float)));
+    if (!out) throw std::runtime_error("FlatParameters::save: write to " + path + " failed");
+}
+
+void FlatParameters::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("FlatParameters::load: cannot open " + path);
+
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || count != size()) {
+        throw std::runtime_error("FlatParameters::load: " + path + " does not match this model's " +
+                                 std::to_string(size()) + " parameters");
+    }
+    in.read(reinterpret_cast<char*>(block->values), static_cast<std::streamsize>(count * sizeof(float)));
+    if (!in) throw std::runtime_error("FlatParameters::load: " + path + " is truncated");
+}
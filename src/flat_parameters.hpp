@@ -0,0 +1,52 @@
+/*
+ * flat_parameters.hpp - one contiguous buffer for a model's parameters and one for their gradients
+ *
+ * flattening moves every parameter of a module into a single 64-byte aligned block:
+ * - parameter i holds elements [offset(i), offset(i) + numel) of values(), and its gradient
+ *   the same range of grads(); the tensors stay the same objects, so ops, optimizers and
+ *   containers keep working on them unchanged
+ * - zero_grad is one memset, optimizers see one span (optimizer/adam.hpp merges the adjacent
+ *   slices into a single range) and save/load write or read the whole model at once
+ * - gradients are allocated (zero) up front, so backward only ever accumulates into them
+ *
+ * usage:
+ *     model->flatten_parameters();
+ *     model->flat_parameters()->save("model.bin");
+ *
+ * IMPORTANT: parameters must be float32 and are repacked; views taken before flattening keep
+ * the old storage. the block lives as long as any parameter storage still points into it
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../tensor.hpp"
+
+class FlatParameters {
+public:
+    // moves the values and gradients of params (distinct float32 tensors) into the block, in order
+    explicit FlatParameters(const std::vector<std::shared_ptr<Tensor>>& params);
+
+    const std::vector<std::shared_ptr<Tensor>>& tensors() const { return params; }
+
+    // every parameter value / gradient, in parameter order
+    Span<float> values();
+    Span<float> grads();
+
+    size_t offset(size_t i) const { return offsets[i]; }
+    size_t size() const { return offsets.back(); }
+
+    void zero_grad();
+
+    // raw float32 values with an element count header; load requires the same layout
+    void save(const std::string& path) const;
+    void load(const std::string& path);
+
+private:
+    struct Block;
+    std::shared_ptr<Block> block;
+    std::vector<std::shared_ptr<Tensor>> params;
+    std::vector<size_t> offsets;
+};
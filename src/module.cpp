@@ -10,10 +10,39 @@
  */
 
 #include "module.hpp"
+#include "flat_parameters.hpp"
+#include "../ops/cast.hpp"
+#include "../strided.hpp"
+#include <stdexcept>
 
 void Module::zero_grad() {
+    if (flat) {
+        flat->zero_grad();
+        return;
+    }
+
     // iterate through all parameters and zero their gradients
     for (auto& param : parameters()) {
         param->zero_grad();
     }
 }
+
+void Module::to(DType dtype) {
+    if (flat) throw std::runtime_error(name() + "::to: parameters are flattened (float32 only)");
+    for (auto& param : parameters()) {
+        if (param->dtype() == dtype) continue;
+
+        // packed storage of the new dtype from the same (parameter) memory resource
+        auto converted = std::make_shared<Storage>(param->numel(), param->storage->resource(), dtype);
+        Tensor packed(converted, param->shape, contiguous_strides(param->shape), 0);
+        convert_kernel(*param, packed);
+
+        param->storage = converted;
+        param->strides = packed.strides;
+        param->offset = 0;
+    }
+}
+
+void Module::flatten_parameters() {
+    flat = std::make_shared<FlatParameters>(parameters());
+}
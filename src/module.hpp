@@ -18,6 +18,9 @@
 #include <string>
 
 #include "../tensor.hpp"
+#include "../dtype.hpp"
+
+class FlatParameters;
 
 class Module {
 public:
@@ -33,9 +36,25 @@ public:
 
     // zero gradients of all parameters before each forward pass
     // this prevents gradient accumulation across multiple backward passes
+    // one memset when the parameters are flattened
     virtual void zero_grad();
 
+    // converts every parameter's storage to dtype in place (e.g. bfloat16 weights for inference)
+    // the parameter tensors stay the same objects, so optimizers and containers keep working
+    // on them; gradients stay float32
+    // not available once the parameters are flattened
+    virtual void to(DType dtype);
+
+    // opt-in: moves all parameters and their gradients into one contiguous block each
+    // (src/flat_parameters.hpp); the parameter tensors stay the same objects
+    void flatten_parameters();
+    FlatParameters* flat_parameters() const { return flat.get(); }
+
     // module name for debugging, logging, and model inspection
     // useful for identifying layers in complex architectures
     virtual std::string name() const { return "Module"; }
+
+protected:
+    // set by flatten_parameters, null otherwise
+    std::shared_ptr<FlatParameters> flat;
 };
@@ -0,0 +1,81 @@
+/*
+ * storage.hpp - reference-counted element buffer shared between tensor views
+ *
+ * this separates the memory of a tensor from the way it is looked at:
+ * - storage owns a flat buffer of elements and nothing else (no shape, no gradient)
+ * - tensors hold a shared_ptr to a storage plus their own shape/strides/offset
+ * - views (reshape, transpose, slicing, detach) share one storage without copying it
+ * - elements are float32 or a 16-bit type (dtype.hpp); only the buffer of that dtype is allocated
+ *
+ * IMPORTANT: writing through one view is visible through every other view of the same storage
+ * data() is the float32 buffer and throws for 16-bit storage, which is read with half_data()
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "dtype.hpp"
+
+class Storage {
+public:
+    DType dtype;
+
+    // keeps the memory the buffers were carved from alive (src/flat_parameters.hpp), or null
+    // declared before the buffers so it is released after them
+    std::shared_ptr<const void> owner;
+
+    // flat element buffers, allocated from the given resource (the graph arena for graph tensors)
+    std::pmr::vector<float> buffer;          // float32 elements
+    std::pmr::vector<uint16_t> half_buffer;  // bfloat16 / float16 elements
+
+    Storage(size_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+            DType dtype_ = DType::Float32)
+        : dtype(dtype_),
+          buffer(dtype_ == DType::Float32 ? size : 0, 0.0f, resource),
+          half_buffer(dtype_ == DType::Float32 ? 0 : size, 0, resource) {}
+
+    float* data() {
+        if (dtype != DType::Float32) throw_not_float32();
+        return buffer.data();
+    }
+    const float* data() const {
+        if (dtype != DType::Float32) throw_not_float32();
+        return buffer.data();
+    }
+
+    uint16_t* half_data() { return half_buffer.data(); }
+    const uint16_t* half_data() const { return half_buffer.data(); }
+
+    size_t size() const { return dtype == DType::Float32 ? buffer.size() : half_buffer.size(); }
+    std::pmr::memory_resource* resource() const { return buffer.get_allocator().resource(); }
+
+private:
+    [[noreturn]] void throw_not_float32() const {
+        throw std::runtime_error(std::string("Storage::data on ") + dtype_name(dtype) +
+                                 " storage, convert with to(DType::Float32) first");
+    }
+};
+
+// lightweight non-owning view of contiguous elements
+// this is what Tensor::data() hands out, so loops can keep using data[i] and range-for
+template <typename T>
+class Span {
+public:
+    Span(T* ptr_, size_t size_) : ptr(ptr_), count(size_) {}
+
+    T& operator[](size_t i) const { return ptr[i]; }
+    T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + count; }
+
+private:
+    T* ptr;
+    size_t count;
+};
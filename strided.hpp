@@ -0,0 +1,100 @@
+/*
+ * strided.hpp - row-wise iteration over strided tensor layouts
+ *
+ * kernels use this to read views (transposes, slices, broadcast operands) without copying:
+ * - walks a shape in row-major order and tracks one storage offset per operand
+ * - dimensions that are laid out back to back for every operand are merged first,
+ *   so fully contiguous operands come out as a single long row (the fast path)
+ * - the callback receives whole innermost rows, keeping the per-element work a plain loop
+ * - no heap allocation, so kernels built on it can run inside allocation-free replays (capture.hpp)
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// row-major strides of a densely packed tensor with the given shape
+inline std::vector<int> contiguous_strides(const std::vector<int>& shape) {
+    std::vector<int> strides(shape.size());
+    int stride = 1;
+    for (int d = static_cast<int>(shape.size()) - 1; d >= 0; --d) {
+        strides[d] = stride;
+        stride *= shape[d];
+    }
+    return strides;
+}
+
+// row-major strides of a densely packed tensor, written into a caller-provided buffer
+// (lets hot loops build stride tables on the stack)
+inline void contiguous_strides(const std::vector<int>& shape, int* strides) {
+    int stride = 1;
+    for (int d = static_cast<int>(shape.size()) - 1; d >= 0; --d) {
+        strides[d] = stride;
+        stride *= shape[d];
+    }
+}
+
+// highest rank the walker supports; its bookkeeping lives on the stack so walking never allocates
+constexpr size_t kMaxStridedDims = 16;
+
+// calls row(offsets, count, inner_strides) once per innermost row of shape
+// strides[k] (shape.size() entries) and offsets[k] describe how operand k maps shape indices
+// onto its storage
+template <size_t N, typename RowFn>
+void for_each_row(const std::vector<int>& shape,
+                  const std::array<const int*, N>& strides,
+                  std::array<size_t, N> offsets,
+                  RowFn&& row) {
+    if (shape.size() > kMaxStridedDims) {
+        throw std::runtime_error("for_each_row: tensor rank exceeds kMaxStridedDims");
+    }
+    for (int d : shape) {
+        if (d == 0) return;
+    }
+
+    // coalesce adjacent dimensions that are contiguous with each other for every operand
+    int dims[kMaxStridedDims];
+    int steps[N][kMaxStridedDims];
+    int rank = 0;
+    for (size_t d = 0; d < shape.size(); ++d) {
+        if (shape[d] == 1) continue;  // size-1 dims never advance
+        bool merge = rank > 0;
+        for (size_t k = 0; k < N && merge; ++k) {
+            merge = steps[k][rank - 1] == strides[k][d] * shape[d];
+        }
+        if (merge) {
+            dims[rank - 1] *= shape[d];
+            for (size_t k = 0; k < N; ++k) steps[k][rank - 1] = strides[k][d];
+        } else {
+            dims[rank] = shape[d];
+            for (size_t k = 0; k < N; ++k) steps[k][rank] = strides[k][d];
+            ++rank;
+        }
+    }
+
+    std::array<int, N> inner{};
+    if (rank == 0) {
+        // scalar (or all size-1 dims): a single element
+        row(offsets, 1, inner);
+        return;
+    }
+
+    for (size_t k = 0; k < N; ++k) inner[k] = steps[k][rank - 1];
+
+    // odometer over the outer dimensions
+    int index[kMaxStridedDims] = {};
+    while (true) {
+        row(offsets, dims[rank - 1], inner);
+
+        int d = rank - 2;
+        for (; d >= 0; --d) {
+            for (size_t k = 0; k < N; ++k) offsets[k] += steps[k][d];
+            if (++index[d] < dims[d]) break;
+            for (size_t k = 0; k < N; ++k) offsets[k] -= static_cast<size_t>(steps[k][d]) * dims[d];
+            index[d] = 0;
+        }
+        if (d < 0) return;
+    }
+}
@@ -10,7 +10,7 @@
  * IMPORTANT:
  * - gradient buffers allocated lazily to save memory, don't manually allocate them
  * - all operations create new tensors (immutable design)
- * - global graph manager prevents premature tensor destruction
+ * - current graph (graph.hpp) prevents premature tensor destruction
  */
 
 #include "tensor.hpp"
@@ -18,209 +18,334 @@
 #include <iostream>
 #include "ops/sub.hpp"
 #include "ops/mul.hpp"
-#include "ops/mean.hpp"
+#include "ops/reduce.hpp"
 #include "ops/add.hpp"
 #include "ops/pow.hpp"
 #include "ops/div.hpp"
 #include "ops/matmul.hpp"
+#include "ops/view.hpp"
+#include "ops/cast.hpp"
+#include "ops/elementwise.hpp"
 #include "tensor_ops.hpp"
-
-// global graph manager to keep all tensors and operations alive during computation
-// critical for preventing premature destruction of intermediate computation results
-extern Graph global_graph;
-
-Tensor::Tensor(std::vector<int> shape_, bool requires_grad_)
-    : shape(shape_), requires_grad(requires_grad_) {
-    int total = numel();
-    data.resize(total, 0.0f);
+#include "graph.hpp"
+#include "autograd.hpp"
+#include "grad_mode.hpp"
+#include "logging.hpp"
+#include "profiler.hpp"
+#include <cmath>
+
+Tensor::Tensor(std::vector<int> shape_, bool requires_grad_, std::pmr::memory_resource* resource,
+               std::pmr::memory_resource* grad_resource, DType dtype_)
+    : shape(shape_), strides(contiguous_strides(shape_)), requires_grad(requires_grad_), grad(grad_resource) {
+    // fresh packed storage from the same resource as the tensor (arena for graph tensors)
+    storage = std::allocate_shared<Storage>(std::pmr::polymorphic_allocator<Storage>(resource), numel(), resource,
+                                            dtype_);
     // gradient buffer allocated on-demand when backward() is called to save memory
 }
 
+Tensor::Tensor(std::shared_ptr<Storage> storage_, std::vector<int> shape_, std::vector<int> strides_,
+               size_t offset_, bool requires_grad_, std::pmr::memory_resource* grad_resource)
+    : shape(std::move(shape_)), strides(std::move(strides_)), offset(offset_), storage(std::move(storage_)),
+      requires_grad(requires_grad_), grad(grad_resource) {}
+
 int Tensor::numel() const {
     int n = 1;
     for (int d : shape) n *= d;
     return n;
 }
 
+bool Tensor::is_contiguous() const {
+    // packed row-major: each stride equals the product of the dimensions after it
+    // size-1 dimensions never move, so their stride does not matter
+    int expected = 1;
+    for (int d = static_cast<int>(shape.size()) - 1; d >= 0; --d) {
+        if (shape[d] != 1 && strides[d] != expected) return false;
+        expected *= shape[d];
+    }
+    return true;
+}
+
+Span<float> Tensor::data() {
+    if (!is_contiguous()) {
+        throw std::runtime_error("Tensor::data requires a contiguous tensor, call contiguous() first");
+    }
+    return Span<float>(storage->data() + offset, numel());
+}
+
+Span<const float> Tensor::data() const {
+    if (!is_contiguous()) {
+        throw std::runtime_error("Tensor::data requires a contiguous tensor, call contiguous() first");
+    }
+    return Span<const float>(storage->data() + offset, numel());
+}
+
 void Tensor::zero_grad() {
     if (requires_grad) {
         if (grad.empty()) {
             // first time calling zero_grad - allocate gradient buffer
-            grad.resize(data.size(), 0.0f);
-            std::cout << "[Tensor] zero_grad: initialized grad buffer, size=" << grad.size() << std::endl;
+            grad.resize(numel(), 0.0f);
+            LOG_TRACE("[Tensor] zero_grad: initialized grad buffer, size=" << grad.size());
         } else {
             // reuse existing buffer - just zero all values
             std::fill(grad.begin(), grad.end(), 0.0f);
-            std::cout << "[Tensor] zero_grad: zeroed existing grad buffer, size=" << grad.size() << std::endl;
+            LOG_TRACE("[Tensor] zero_grad: zeroed existing grad buffer, size=" << grad.size());
         }
     }
 }
 
-void Tensor::backward() {
-    if (!requires_grad) {
-        std::cerr << "[Tensor] ERROR: Tensor does not require grad. Backward aborted." << std::endl;
+// seeds the gradient of a scalar loss and runs the backward engine (autograd.hpp)
+static void backward_from(Tensor& self, const std::vector<std::shared_ptr<Tensor>>* leaves) {
+    if (!self.requires_grad) {
+        LOG_ERROR("[Tensor] ERROR: Tensor does not require grad. Backward aborted.");
         throw std::runtime_error("Cannot call backward on tensor without requires_grad.");
     }
 
-    if (grad.empty()) {
+    if (self.grad.empty()) {
         // initialize gradient buffer with default gradient of 1.0 (for loss tensor)
-        grad.resize(data.size(), 1.0f);
-        std::cout << "[Tensor] Initialized grad buffer with size " << grad.size() << std::endl;
+        self.grad.resize(self.numel(), 1.0f);
+        LOG_DEBUG("[Tensor] Initialized grad buffer with size " << self.grad.size());
     }
 
-    if (auto creator_shared = creator.lock()) {
-        // propagate gradients backward through the computation graph
-        std::cout << "[Tensor] Calling backward on creator" << std::endl;
-        creator_shared->backward(*this);
+    if (!self.creator.expired()) {
+        // propagate gradients backward through the computation graph in reverse topological order
+        LOG_DEBUG("[Tensor] Running backward engine");
+        if (leaves) {
+            run_backward(self.shared_from_this(), *leaves);
+        } else {
+            run_backward(self.shared_from_this());
+        }
     } else {
         // no creator means this is a leaf tensor (input or parameter)
-        std::cout << "[Tensor] No creator found, this is a leaf tensor" << std::endl;
+        LOG_DEBUG("[Tensor] No creator found, this is a leaf tensor");
     }
 }
 
+void Tensor::backward() {
+    backward_from(*this, nullptr);
+}
+
+void Tensor::backward(const std::vector<std::shared_ptr<Tensor>>& leaves) {
+    backward_from(*this, &leaves);
+}
+
 void Tensor::print_data() const {
+    if (dtype() != DType::Float32) {
+        // print the widened values, without recording the conversion
+        NoGradGuard no_grad;
+        to(DType::Float32)->print_data();
+        return;
+    }
+
     std::cout << "Tensor(shape=[";
     for (size_t i = 0; i < shape.size(); ++i) {
         std::cout << shape[i];
         if (i + 1 != shape.size()) std::cout << ", ";
     }
     std::cout << "], data=[";
-    for (size_t i = 0; i < data.size(); ++i) {
-        std::cout << data[i];
-        if (i + 1 != data.size()) std::cout << ", ";
-    }
+    const size_t n = numel();
+    for_each_element(*this, [&](size_t i, float v) {
+        std::cout << v;
+        if (i + 1 != n) std::cout << ", ";
+    });
     std::cout << "])\n";
 }
 
 std::shared_ptr<Tensor> Tensor::detach() const {
-    // create tensor copy without gradient tracking for inference
-    auto new_tensor = std::make_shared<Tensor>(shape, false);
-    new_tensor->data = data;
-    return new_tensor;
+    // share storage without gradient tracking for inference - no element copy
+    return std::make_shared<Tensor>(storage, shape, strides, offset, false);
 }
 
-std::shared_ptr<Tensor> Tensor::operator*(const Tensor& other) const {
-    if (shape != other.shape) {
-        throw std::runtime_error("Tensor::operator* shape mismatch");
-    }
-
-    auto result = std::make_shared<Tensor>(shape, requires_grad || other.requires_grad);
-    result->data.resize(data.size());
-
-    // element-wise multiplication
-    for (size_t i = 0; i < data.size(); ++i)
-        result->data[i] = data[i] * other.data[i];
+// builds a view of self described twice: against the storage (for reading data) and against
+// self's packed index space (for routing gradients back through ViewOp)
+static std::shared_ptr<Tensor> make_view(const Tensor& self, std::vector<int> shape,
+                                         std::vector<int> strides, size_t offset,
+                                         std::vector<int> grad_strides, size_t grad_offset) {
+    ProfileScope profile("view", "forward");
+    auto result = current_graph().make_view(self.storage, std::move(shape), std::move(strides), offset, GradMode::track(self.requires_grad));
 
     if (result->requires_grad) {
-        // create multiplication operation and link to computational graph
-        auto lhs = std::const_pointer_cast<Tensor>(shared_from_this());
-        auto rhs = std::const_pointer_cast<Tensor>(other.shared_from_this());
-        auto mul_op = std::make_shared<MulOp>(lhs, rhs);
-        result->set_creator(mul_op);
-
-        // register with global graph to prevent premature destruction
-        global_graph.add_tensor(result);
-        global_graph.add_op(mul_op);
+        Graph& graph = current_graph();
+        // create view operation and link to computational graph
+        auto input = std::const_pointer_cast<Tensor>(self.shared_from_this());
+        auto view_op = graph.make_op<ViewOp>(input, std::move(grad_strides), grad_offset);
+        result->set_creator(view_op);
+
+        // register with the current graph to prevent premature destruction
+        graph.add_tensor(result);
+        graph.add_op(view_op);
     }
 
     return result;
 }
 
-std::shared_ptr<Tensor> Tensor::operator-(const Tensor& other) const {
-    if (shape != other.shape) {
-        throw std::runtime_error("Tensor::operator- shape mismatch");
+std::shared_ptr<Tensor> Tensor::view(std::vector<int> new_shape) const {
+    if (!is_contiguous()) {
+        throw std::runtime_error("Tensor::view requires a contiguous tensor, use reshape()");
+    }
+
+    // a single -1 dimension is inferred from the element count
+    int known = 1;
+    int inferred = -1;
+    for (size_t d = 0; d < new_shape.size(); ++d) {
+        if (new_shape[d] == -1) {
+            if (inferred != -1) throw std::runtime_error("Tensor::view only one dimension can be -1");
+            inferred = static_cast<int>(d);
+        } else {
+            known *= new_shape[d];
+        }
     }
+    if (inferred != -1 && known != 0) new_shape[inferred] = numel() / known;
 
-    auto result = std::make_shared<Tensor>(shape, requires_grad || other.requires_grad);
-    result->data.resize(data.size());
+    int count = 1;
+    for (int d : new_shape) count *= d;
+    if (count != numel()) throw std::runtime_error("Tensor::view element count mismatch");
 
-    // element-wise subtraction
-    for (size_t i = 0; i < data.size(); ++i)
-        result->data[i] = data[i] - other.data[i];
+    auto packed = contiguous_strides(new_shape);
+    return make_view(*this, new_shape, packed, offset, packed, 0);
+}
 
-    if (result->requires_grad) {
-        // create subtraction operation and link to computational graph
-        auto lhs = std::const_pointer_cast<Tensor>(shared_from_this());
-        auto rhs = std::const_pointer_cast<Tensor>(other.shared_from_this());
-        auto sub_op = std::make_shared<SubOp>(lhs, rhs);
-        result->set_creator(sub_op);
-
-        // register with global graph to prevent premature destruction
-        global_graph.add_tensor(result);
-        global_graph.add_op(sub_op);
+std::shared_ptr<Tensor> Tensor::reshape(std::vector<int> new_shape) const {
+    if (is_contiguous()) return view(std::move(new_shape));
+    return contiguous()->view(std::move(new_shape));
+}
+
+std::shared_ptr<Tensor> Tensor::transpose(int dim0, int dim1) const {
+    const int rank = static_cast<int>(shape.size());
+    if (dim0 < 0) dim0 += rank;
+    if (dim1 < 0) dim1 += rank;
+    if (dim0 < 0 || dim1 < 0 || dim0 >= rank || dim1 >= rank) {
+        throw std::runtime_error("Tensor::transpose dimension out of range");
     }
 
-    return result;
+    auto new_shape = shape;
+    auto new_strides = strides;
+    auto grad_strides = contiguous_strides(shape);
+    std::swap(new_shape[dim0], new_shape[dim1]);
+    std::swap(new_strides[dim0], new_strides[dim1]);
+    std::swap(grad_strides[dim0], grad_strides[dim1]);
+
+    return make_view(*this, new_shape, new_strides, offset, grad_strides, 0);
 }
 
-std::shared_ptr<Tensor> Tensor::operator+(const Tensor& other) const {
-    if (shape != other.shape) {
-        throw std::runtime_error("Tensor::operator+ shape mismatch");
+std::shared_ptr<Tensor> Tensor::narrow(int dim, int start, int length) const {
+    const int rank = static_cast<int>(shape.size());
+    if (dim < 0) dim += rank;
+    if (dim < 0 || dim >= rank) throw std::runtime_error("Tensor::narrow dimension out of range");
+    if (start < 0 || length < 0 || start + length > shape[dim]) {
+        throw std::runtime_error("Tensor::narrow range out of bounds");
     }
 
-    auto result = std::make_shared<Tensor>(shape, requires_grad || other.requires_grad);
-    result->data.resize(data.size());
+    auto new_shape = shape;
+    new_shape[dim] = length;
+    auto grad_strides = contiguous_strides(shape);
+    size_t new_offset = offset + static_cast<size_t>(start) * strides[dim];
+    size_t grad_offset = static_cast<size_t>(start) * grad_strides[dim];
+
+    return make_view(*this, new_shape, strides, new_offset, grad_strides, grad_offset);
+}
+
+std::shared_ptr<Tensor> Tensor::slice(int start, int end) const {
+    // row range along the first (batch) dimension
+    return narrow(0, start, end - start);
+}
 
-    // element-wise addition
-    for (size_t i = 0; i < data.size(); ++i)
-        result->data[i] = data[i] + other.data[i];
+std::shared_ptr<Tensor> Tensor::contiguous() const {
+    if (is_contiguous()) return std::const_pointer_cast<Tensor>(shared_from_this());
+    ProfileScope profile("contiguous", "forward");
+
+    auto result = current_graph().make_tensor(shape, GradMode::track(requires_grad), dtype());
+    convert_kernel(*this, *result);
 
     if (result->requires_grad) {
-        // create addition operation and link to computational graph
-        auto lhs = std::const_pointer_cast<Tensor>(shared_from_this());
-        auto rhs = std::const_pointer_cast<Tensor>(other.shared_from_this());
-        auto add_op = std::make_shared<AddOp>(lhs, rhs);
-        result->set_creator(add_op);
-
-        // register with global graph to prevent premature destruction
-        global_graph.add_tensor(result);
-        global_graph.add_op(add_op);
+        Graph& graph = current_graph();
+        // the packed copy maps one to one onto self's gradient layout
+        auto self = std::const_pointer_cast<Tensor>(shared_from_this());
+        auto view_op = graph.make_op<ViewOp>(self, contiguous_strides(shape), 0);
+        result->set_creator(view_op);
+
+        // register with the current graph to prevent premature destruction
+        graph.add_tensor(result);
+        graph.add_op(view_op);
     }
 
     return result;
 }
 
+// the binary operators broadcast numpy-style; the free functions own the kernels and ops
+std::shared_ptr<Tensor> Tensor::operator*(const Tensor& other) const {
+    auto lhs = std::const_pointer_cast<Tensor>(shared_from_this());
+    auto rhs = std::const_pointer_cast<Tensor>(other.shared_from_this());
+    return ::mul(lhs, rhs);
+}
+
+std::shared_ptr<Tensor> Tensor::operator-(const Tensor& other) const {
+    auto lhs = std::const_pointer_cast<Tensor>(shared_from_this());
+    auto rhs = std::const_pointer_cast<Tensor>(other.shared_from_this());
+    return ::sub(lhs, rhs);
+}
+
+std::shared_ptr<Tensor> Tensor::operator+(const Tensor& other) const {
+    auto lhs = std::const_pointer_cast<Tensor>(shared_from_this());
+    auto rhs = std::const_pointer_cast<Tensor>(other.shared_from_this());
+    return ::add(lhs, rhs);
+}
+
+std::shared_ptr<Tensor> Tensor::to(DType dtype) const {
+    auto self = std::const_pointer_cast<Tensor>(shared_from_this());
+    return ::to_dtype(self, dtype);
+}
+
 std::shared_ptr<Tensor> Tensor::pow(float exponent) const {
-    auto result = std::make_shared<Tensor>(shape, requires_grad);
-    result->data.resize(data.size());
+    if (dtype() != DType::Float32) return to(DType::Float32)->pow(exponent);
+    ProfileScope profile("pow", "forward");
+
+    auto result = current_graph().make_tensor(shape, GradMode::track(requires_grad));
+    float* out = result->storage->data();
 
     // element-wise power operation
-    for (size_t i = 0; i < data.size(); ++i)
-        result->data[i] = std::pow(data[i], exponent);
+    pow_kernel(*this, exponent, out);
 
-    if (requires_grad) {
+    if (result->requires_grad) {
+        Graph& graph = current_graph();
         // create power operation and link to computational graph
         auto self = std::const_pointer_cast<Tensor>(shared_from_this());
-        auto pow_op = std::make_shared<PowOp>(self, exponent);
+        auto pow_op = graph.make_op<PowOp>(self, exponent);
         result->set_creator(pow_op);
 
-        // register with global graph to prevent premature destruction
-        global_graph.add_tensor(result);
-        global_graph.add_op(pow_op);
+        // register with the current graph to prevent premature destruction
+        graph.add_tensor(result);
+        graph.add_op(pow_op);
     }
 
     return result;
 }
 
 std::shared_ptr<Tensor> Tensor::operator/(float scalar) const {
+    if (dtype() != DType::Float32) return *to(DType::Float32) / scalar;
+    ProfileScope profile("div", "forward");
+
     if (scalar == 0.0f) throw std::runtime_error("Tensor::operator/ division by zero");
 
-    auto result = std::make_shared<Tensor>(shape, requires_grad);
-    result->data.resize(data.size());
+    auto result = current_graph().make_tensor(shape, GradMode::track(requires_grad));
+    float* out = result->storage->data();
 
     // element-wise scalar division
-    for (size_t i = 0; i < data.size(); ++i)
-        result->data[i] = data[i] / scalar;
+    if (is_contiguous()) {
+        simd().div_scalar(storage->data() + offset, scalar, out, numel());
+    } else {
+        for_each_element(*this, [out, scalar](size_t i, float v) { out[i] = v / scalar; });
+    }
 
-    if (requires_grad) {
+    if (result->requires_grad) {
+        Graph& graph = current_graph();
         // create division operation and link to computational graph
         auto self = std::const_pointer_cast<Tensor>(shared_from_this());
-        auto div_op = std::make_shared<DivOp>(self, scalar);
+        auto div_op = graph.make_op<DivOp>(self, scalar);
         result->set_creator(div_op);
 
-        // register with global graph to prevent premature destruction
-        global_graph.add_tensor(result);
-        global_graph.add_op(div_op);
+        // register with the current graph to prevent premature destruction
+        graph.add_tensor(result);
+        graph.add_op(div_op);
     }
 
     return result;
@@ -236,25 +361,9 @@ std::shared_ptr<Tensor> Tensor::matmul(const Tensor& other) const {
 }
 
 std::shared_ptr<Tensor> Tensor::mean() const {
-    float sum = 0.0f;
-    for (float v : data) sum += v;
-
-    auto result = std::make_shared<Tensor>(std::vector<int>{1}, requires_grad);
-    result->data[0] = sum / data.size();
-
-    if (requires_grad) {
-        // create mean operation and link to computational graph
-        auto self = std::const_pointer_cast<Tensor>(shared_from_this());
-
-        auto mean_op = std::make_shared<MeanOp>(self, data.size());
-        result->set_creator(mean_op);
-
-        // register with global graph to prevent premature destruction
-        global_graph.add_tensor(result);
-        global_graph.add_op(mean_op);
-    }
-
-    return result;
+    // full reduction to a {1} tensor, summed pairwise (ops/reduce.hpp)
+    auto self = std::const_pointer_cast<Tensor>(shared_from_this());
+    return ::mean(self, {}, false);
 }
 
 void Tensor::set_creator(std::shared_ptr<Op> op) {
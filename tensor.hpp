@@ -9,47 +9,87 @@
  * 
  * design insight: tensors are immutable - operations create new tensors
  * gradient buffers are allocated on-demand to save memory
+ *
+ * memory layout: a tensor is a view (shape, strides, offset) into a shared Storage
+ * reshape/transpose/narrow/slice/detach only create new views, never copy elements
+ *
+ * element type: storage is float32 unless created (or converted with to()) as bfloat16 / float16,
+ * see dtype.hpp; gradients are float32 for every dtype
  */
 
 #pragma once
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <iostream>
 #include <typeinfo>
+#include "storage.hpp"
+#include "memory.hpp"
 
 class Op;
 
 class Tensor : public std::enable_shared_from_this<Tensor> {
 public:
-    // tensor shape and data storage
+    // tensor shape and view into shared storage
     std::vector<int> shape;           // dimensions (e.g., [batch_size, features])
-    std::vector<float> data;          // actual numerical values stored contiguously
+    std::vector<int> strides;         // storage elements to skip per step along each dimension
+    size_t offset = 0;                // position of the first element inside storage
+    std::shared_ptr<Storage> storage; // reference-counted buffer shared by all views of the same data
 
     // automatic differentiation support
     bool requires_grad = false;        // whether this tensor participates in gradient computation
-    std::vector<float> grad;          // gradients w.r.t. this tensor (allocated on-demand)
+    std::pmr::vector<float> grad;     // gradients w.r.t. this tensor, packed in shape order (allocated on-demand)
 
     // computational graph linkage
     std::weak_ptr<Op> creator;        // operation that created this tensor (for backprop)
 
     // tensor operations - all create new tensors and maintain gradient chains
-    std::shared_ptr<Tensor> operator-(const Tensor& other) const;  // element-wise subtraction
-    std::shared_ptr<Tensor> operator*(const Tensor& other) const;  // element-wise multiplication
-    std::shared_ptr<Tensor> operator+(const Tensor& other) const;  // element-wise addition
+    std::shared_ptr<Tensor> operator-(const Tensor& other) const;  // element-wise subtraction (broadcasting)
+    std::shared_ptr<Tensor> operator*(const Tensor& other) const;  // element-wise multiplication (broadcasting)
+    std::shared_ptr<Tensor> operator+(const Tensor& other) const;  // element-wise addition (broadcasting)
     std::shared_ptr<Tensor> pow(float exponent) const;             // element-wise power
     std::shared_ptr<Tensor> operator/(float scalar) const;         // scalar division
     std::shared_ptr<Tensor> matmul(const Tensor& other) const;     // matrix multiplication
     std::shared_ptr<Tensor> mean() const;                          // reduction to scalar
 
+    // zero-copy views - results share storage with this tensor and keep gradient chains
+    std::shared_ptr<Tensor> view(std::vector<int> new_shape) const;      // same contiguous data, new shape
+    std::shared_ptr<Tensor> reshape(std::vector<int> new_shape) const;   // view if contiguous, packed copy otherwise
+    std::shared_ptr<Tensor> transpose(int dim0, int dim1) const;         // swap two dimensions
+    std::shared_ptr<Tensor> narrow(int dim, int start, int length) const; // sub-range along one dimension
+    std::shared_ptr<Tensor> slice(int start, int end) const;             // rows [start, end), e.g. a mini-batch
+    std::shared_ptr<Tensor> contiguous() const;                          // this tensor if packed, else a packed copy
+
+    // element type of the storage, and a (differentiable) packed copy in another one
+    DType dtype() const { return storage->dtype; }
+    std::shared_ptr<Tensor> to(DType dtype) const;
+
     // construction and memory management
-    Tensor(std::vector<int> shape, bool requires_grad = false);
+    // resource / grad_resource are the allocator hooks for the storage and grad buffers
+    // (graph tensors use the graph's arena, the defaults are the tracked heaps of memory.hpp)
+    Tensor(std::vector<int> shape, bool requires_grad = false,
+           std::pmr::memory_resource* resource = tracked_heap(MemoryCategory::Other),
+           std::pmr::memory_resource* grad_resource = tracked_heap(MemoryCategory::Gradient),
+           DType dtype = DType::Float32);
+
+    // view construction: shares an existing storage with its own layout
+    Tensor(std::shared_ptr<Storage> storage, std::vector<int> shape, std::vector<int> strides,
+           size_t offset, bool requires_grad = false,
+           std::pmr::memory_resource* grad_resource = tracked_heap(MemoryCategory::Gradient));
+
+    // element access
+    bool is_contiguous() const;       // elements packed in row-major order (data() is valid)
+    Span<float> data();               // contiguous float32 elements - throws for strided views and 16-bit dtypes
+    Span<const float> data() const;
 
     // gradient computation support
     int numel() const;                // total number of elements (product of shape)
     void zero_grad();                 // reset gradients to zero (called before each forward pass)
     void backward();                  // initiate backpropagation from this tensor
+    // backpropagate into the given leaves only (e.g. model->parameters()), other inputs stay constant
+    void backward(const std::vector<std::shared_ptr<Tensor>>& leaves);
     void print_data() const;          // debug output of tensor contents
-    std::shared_ptr<Tensor> detach() const;  // create tensor copy without gradient tracking
+    std::shared_ptr<Tensor> detach() const;  // view of the same storage without gradient tracking
 
     // computational graph management
     void set_creator(std::shared_ptr<Op> op);  // link to operation that created this tensor
@@ -14,6 +14,7 @@
 #pragma once
 #include <memory>
 #include "tensor.hpp"  
+#include "ops/div.hpp"
 
 // convenience operators that work directly on shared_ptr<tensor> objects
 // these operators dereference the pointers and call the corresponding tensor methods
@@ -34,6 +35,11 @@ inline std::shared_ptr<Tensor> operator*(const std::shared_ptr<Tensor>& a, const
     return (*a) * (*b);
 }
 
+// element-wise division with broadcasting: creates div operation and maintains gradient flow
+inline std::shared_ptr<Tensor> operator/(const std::shared_ptr<Tensor>& a, const std::shared_ptr<Tensor>& b) {
+    return div(a, b);
+}
+
 // scalar division: divides each tensor element by the scalar value
 inline std::shared_ptr<Tensor> operator/(const std::shared_ptr<Tensor>& a, float scalar) {
     return (*a) / scalar;
@@ -0,0 +1,1117 @@
+/*
+ * test_kernels.cpp - numeric self-checks of the kernels against naive reference loops
+ *
+ * every check compares a kernel with the obvious loop it replaces:
+ * - forward results against element-by-element reference computations
+ * - analytic gradients against central finite differences of the same loss
+ *
+ * run with ctest or ./test_kernels; the exit code is nonzero when any check fails
+ */
+
+#include "tensor.hpp"
+#include "graph.hpp"
+#include "ops/add.hpp"
+#include "ops/sub.hpp"
+#include "ops/mul.hpp"
+#include "ops/div.hpp"
+#include "ops/elementwise.hpp"
+#include "ops/reduce.hpp"
+#include "ops/cast.hpp"
+#include "ops/simd.hpp"
+#include "ops/qgemm.hpp"
+#include "optimizer/adam.hpp"
+#include "model/quantized.hpp"
+#include "linear.hpp"
+#include "relu.hpp"
+#include "grad_mode.hpp"
+#include "autocast.hpp"
+#include "ops/gemm.hpp"
+#include "thread_pool.hpp"
+#include "capture.hpp"
+#include "ops/mse.hpp"
+#include "grad_accumulation.hpp"
+#include "src/flat_parameters.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+static std::mt19937 gen(42);
+
+// records a failed check without stopping the run
+static void check(bool ok, const std::string& what) {
+    if (ok) return;
+    std::cout << "  FAILED: " << what << std::endl;
+    ++failures;
+}
+
+// tensor of values uniform in [lo, hi), with a random sign when signed_values is set
+static std::shared_ptr<Tensor> random_tensor(const std::vector<int>& shape, bool requires_grad,
+                                             float lo = -1.0f, float hi = 1.0f, bool signed_values = false) {
+    std::uniform_real_distribution<float> dist(lo, hi);
+    auto t = std::make_shared<Tensor>(shape, requires_grad);
+    for (auto& v : t->data()) v = signed_values && gen() % 2 ? -dist(gen) : dist(gen);
+    return t;
+}
+
+static std::string shape_string(const std::vector<int>& shape) {
+    std::string s = "[";
+    for (size_t i = 0; i < shape.size(); ++i) s += (i ? "," : "") + std::to_string(shape[i]);
+    return s + "]";
+}
+
+// largest relative difference between the gradients backward() leaves in inputs and central
+// differences of loss() (the loss must be a scalar tensor)
+static double gradient_error(const std::function<std::shared_ptr<Tensor>()>& loss,
+                             const std::vector<std::shared_ptr<Tensor>>& inputs, float h = 1e-2f) {
+    for (auto& t : inputs) t->zero_grad();
+    {
+        auto l = loss();
+        l->backward();
+    }
+    current_graph().clear();
+
+    std::vector<std::vector<float>> analytic;
+    for (auto& t : inputs) analytic.emplace_back(t->grad.begin(), t->grad.end());
+
+    auto value = [&]() {
+        float v = loss()->data()[0];
+        current_graph().clear();
+        return v;
+    };
+
+    double worst = 0.0;
+    for (size_t k = 0; k < inputs.size(); ++k) {
+        auto data = inputs[k]->data();
+        for (size_t i = 0; i < data.size(); ++i) {
+            const float original = data[i];
+            data[i] = original + h;
+            const double plus = value();
+            data[i] = original - h;
+            const double minus = value();
+            data[i] = original;
+
+            const double numeric = (plus - minus) / (2.0 * h);
+            const double g = i < analytic[k].size() ? analytic[k][i] : 0.0;
+            worst = std::max(worst, std::abs(numeric - g) / std::max(1.0, std::abs(numeric)));
+        }
+    }
+    return worst;
+}
+
+// element of t that broadcasting reads for flat output index i of out_shape
+static float broadcast_read(const Tensor& t, const std::vector<int>& out_shape, size_t i) {
+    std::vector<int> index(out_shape.size());
+    for (int d = static_cast<int>(out_shape.size()) - 1; d >= 0; --d) {
+        index[d] = static_cast<int>(i % out_shape[d]);
+        i /= out_shape[d];
+    }
+    const size_t lead = out_shape.size() - t.shape.size();
+    size_t offset = t.offset;
+    for (size_t d = 0; d < t.shape.size(); ++d) {
+        if (t.shape[d] != 1) offset += static_cast<size_t>(index[d + lead]) * t.strides[d];
+    }
+    return t.storage->data()[offset];
+}
+
+static void test_broadcast() {
+    const std::vector<std::pair<std::vector<int>, std::vector<int>>> cases = {
+        {{4, 3}, {3}}, {{4, 3}, {4, 1}}, {{2, 1, 3}, {4, 1}}, {{5}, {2, 3, 5}},
+        {{1}, {3, 2}}, {{2, 3}, {2, 3}}, {{3, 1, 2}, {1, 4, 1}},
+    };
+    const char* names[] = {"add", "sub", "mul", "div"};
+
+    double worst = 0.0;
+    for (const auto& c : cases) {
+        for (int op = 0; op < 4; ++op) {
+            // divisors stay away from zero so the finite differences are well conditioned
+            auto a = random_tensor(c.first, true, 0.5f, 2.0f, true);
+            auto b = random_tensor(c.second, true, 0.5f, 2.0f, true);
+            auto apply = [op](const std::shared_ptr<Tensor>& x, const std::shared_ptr<Tensor>& y) {
+                return op == 0 ? add(x, y) : op == 1 ? sub(x, y) : op == 2 ? mul(x, y) : div(x, y);
+            };
+            const std::string what = std::string(names[op]) + " " + shape_string(c.first) + " " +
+                                     shape_string(c.second);
+
+            const auto out_shape = broadcast_shape(a->shape, b->shape);
+            auto result = apply(a, b);
+            check(result->shape == out_shape, what + ": output shape");
+            bool exact = true;
+            for (size_t i = 0; i < static_cast<size_t>(result->numel()); ++i) {
+                const float x = broadcast_read(*a, out_shape, i);
+                const float y = broadcast_read(*b, out_shape, i);
+                const float expected = op == 0 ? x + y : op == 1 ? x - y : op == 2 ? x * y : x / y;
+                exact = exact && result->data()[i] == expected;
+            }
+            check(exact, what + ": forward differs from the reference loop");
+            current_graph().clear();
+
+            // weighted sum, so every output element gets its own upstream gradient
+            auto weights = random_tensor(out_shape, false);
+            const double error = gradient_error([&]() { return sum(mul(apply(a, b), weights), {}); }, {a, b});
+            check(error < 2e-2, what + ": gradient error " + std::to_string(error));
+            worst = std::max(worst, error);
+        }
+    }
+
+    // strided operand: a transposed view broadcast against a column
+    auto m = random_tensor({3, 4}, true, 0.5f, 2.0f, true);
+    auto column = random_tensor({4, 1}, true, 0.5f, 2.0f, true);
+    auto result = add(m->transpose(0, 1), column);
+    bool exact = true;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 3; ++j) exact = exact && result->data()[i * 3 + j] == m->data()[j * 4 + i] + column->data()[i];
+    }
+    check(exact, "add of a transposed view and a column");
+    current_graph().clear();
+    const double error = gradient_error([&]() { return sum(mul(m->transpose(0, 1), column), {}); }, {m, column});
+    check(error < 2e-2, "mul of a transposed view: gradient error " + std::to_string(error));
+    worst = std::max(worst, error);
+
+    bool threw = false;
+    try {
+        add(random_tensor({3, 2}, false), random_tensor({3}, false));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "incompatible shapes must throw");
+
+    std::cout << "Largest gradient error: " << worst << std::endl;
+}
+
+// naive mean or variance (ddof >= 0) of a contiguous tensor over axes, in double
+static std::vector<double> reference_moment(const Tensor& t, std::vector<int> axes, int ddof) {
+    const int ndim = static_cast<int>(t.shape.size());
+    std::vector<bool> reduced(ndim, axes.empty());
+    for (int a : axes) reduced[a < 0 ? a + ndim : a] = true;
+
+    // flat output index of every input element, in the kept dims' row-major order
+    std::vector<int> out_of(t.numel());
+    size_t outputs = 1;
+    for (int d = 0; d < ndim; ++d) {
+        if (!reduced[d]) outputs *= t.shape[d];
+    }
+    for (size_t i = 0; i < out_of.size(); ++i) {
+        size_t rest = i, out = 0, scale = 1;
+        for (int d = ndim - 1; d >= 0; --d) {
+            const size_t index = rest % t.shape[d];
+            rest /= t.shape[d];
+            if (!reduced[d]) {
+                out += index * scale;
+                scale *= t.shape[d];
+            }
+        }
+        out_of[i] = static_cast<int>(out);
+    }
+
+    const double count = static_cast<double>(t.numel()) / outputs;
+    std::vector<double> means(outputs, 0.0), squares(outputs, 0.0);
+    for (size_t i = 0; i < out_of.size(); ++i) means[out_of[i]] += t.data()[i] / count;
+    if (ddof < 0) return means;
+    for (size_t i = 0; i < out_of.size(); ++i) {
+        const double d = t.data()[i] - means[out_of[i]];
+        squares[out_of[i]] += d * d;
+    }
+    for (auto& v : squares) v /= count - ddof;
+    return squares;
+}
+
+static void test_reductions() {
+    const std::vector<std::vector<int>> axes_cases = {{0}, {1}, {-1}, {0, 2}, {1, 2}, {}};
+
+    double worst_value = 0.0, worst_gradient = 0.0;
+    for (const auto& axes : axes_cases) {
+        for (int ddof = -1; ddof <= 1; ++ddof) {
+            for (bool keepdim : {false, true}) {
+                // ddof -1 stands for mean
+                auto x = random_tensor({3, 4, 5}, true, -2.0f, 2.0f);
+                auto reduce = [&]() { return ddof < 0 ? mean(x, axes, keepdim) : var(x, axes, keepdim, ddof); };
+                std::string what = (ddof < 0 ? std::string("mean") : "var ddof " + std::to_string(ddof)) + " over " +
+                                   shape_string(axes) + (keepdim ? " keepdim" : "");
+
+                const auto expected = reference_moment(*x, axes, ddof);
+                auto result = reduce();
+                check(static_cast<size_t>(result->numel()) == expected.size(), what + ": output size");
+                // a full reduction without keepdim still returns shape {1}
+                const size_t rank = keepdim ? 3 : axes.empty() ? 1 : 3 - axes.size();
+                check(result->shape.size() == rank, what + ": output rank");
+                for (size_t i = 0; i < expected.size() && i < static_cast<size_t>(result->numel()); ++i) {
+                    const double error = std::abs(result->data()[i] - expected[i]) / std::max(1.0, std::abs(expected[i]));
+                    worst_value = std::max(worst_value, error);
+                    if (error > 1e-5) {
+                        check(false, what + ": value " + std::to_string(i) + " error " + std::to_string(error));
+                        break;
+                    }
+                }
+                current_graph().clear();
+
+                auto weights = random_tensor(result->shape, false);
+                const double error = gradient_error([&]() { return sum(mul(reduce(), weights), {}); }, {x});
+                check(error < 2e-2, what + ": gradient error " + std::to_string(error));
+                worst_gradient = std::max(worst_gradient, error);
+            }
+        }
+    }
+
+    // strided input: the reductions must read through the view, not the raw storage order
+    auto x = random_tensor({4, 6}, true, -2.0f, 2.0f);
+    auto transposed = x->transpose(0, 1);
+    auto result = var(transposed, {1}, false, 1);
+    bool close = true;
+    for (int i = 0; i < 6; ++i) {
+        double m = 0.0, s = 0.0;
+        for (int j = 0; j < 4; ++j) m += x->data()[j * 6 + i] / 4.0;
+        for (int j = 0; j < 4; ++j) s += (x->data()[j * 6 + i] - m) * (x->data()[j * 6 + i] - m) / 3.0;
+        close = close && std::abs(result->data()[i] - s) <= 1e-5 * std::max(1.0, s);
+    }
+    check(close, "var over a transposed view");
+    current_graph().clear();
+
+    std::cout << "Largest value error: " << worst_value << ", largest gradient error: " << worst_gradient << std::endl;
+}
+
+// per instruction set kernel tables this cpu can run, scalar first
+static std::vector<const SimdKernels*> available_simd_kernels() {
+    std::vector<const SimdKernels*> tables = {&simd_scalar_kernels()};
+#ifdef CPPGRAD_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) tables.push_back(&simd_avx2_kernels());
+    if (__builtin_cpu_supports("avx512f")) tables.push_back(&simd_avx512_kernels());
+#endif
+    return tables;
+}
+
+// float rounded to the given significand bits (bfloat16: 8, float16: 11) by plain double arithmetic
+// with ties to even; min_exponent is the smallest normal exponent, below it the spacing stays fixed
+static float reference_round(float f, int bits, int min_exponent, double max_finite) {
+    if (std::isnan(f) || std::isinf(f) || f == 0.0f) return f;
+    const int exponent = std::max(std::ilogb(f), min_exponent);
+    const double ulp = std::ldexp(1.0, exponent - (bits - 1));
+    const double rounded = std::nearbyint(static_cast<double>(f) / ulp) * ulp;
+    if (std::abs(rounded) > max_finite) return std::copysign(std::numeric_limits<float>::infinity(), f);
+    return static_cast<float>(rounded);
+}
+
+// random bit patterns over the whole exponent range, plus the values that usually break conversions
+static std::vector<float> conversion_inputs(size_t n) {
+    std::vector<float> values = {0.0f, -0.0f, 1.0f, -1.0f, 65504.0f, 65519.0f, 65520.0f, 1e-8f, 6.1e-5f, 5.96e-8f,
+                                 2.98e-8f, 3e38f, std::numeric_limits<float>::denorm_min(),
+                                 std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+                                 std::numeric_limits<float>::quiet_NaN(), bits_float(0x7f800001u),
+                                 bits_float(0x3f808000u), bits_float(0x3f818000u), bits_float(0x3f801000u)};
+    while (values.size() < n) {
+        // mostly exponents around the 16-bit ranges (2^-30 .. 2^17), the rest any bit pattern
+        const uint32_t bits = static_cast<uint32_t>(gen());
+        const uint32_t exponent = static_cast<uint32_t>(97 + gen() % 48) << 23;
+        values.push_back(bits_float(gen() % 4 ? (bits & 0x807fffffu) | exponent : bits));
+    }
+    return values;
+}
+
+static void test_casts() {
+    const auto inputs = conversion_inputs(4099);  // odd size: vector bodies and scalar tails both run
+    const size_t n = inputs.size();
+    const auto tables = available_simd_kernels();
+
+    struct Format {
+        const char* name;
+        DType dtype;
+        void (*const SimdKernels::*narrow)(const float*, uint16_t*, size_t);
+        int bits;
+        int min_exponent;
+        double max_finite;
+    };
+    const Format formats[] = {
+        {"bfloat16", DType::BFloat16, &SimdKernels::narrow_bf16, 8, -126, 3.3895313892515355e38},
+        {"float16", DType::Float16, &SimdKernels::narrow_fp16, 11, -14, 65504.0},
+    };
+
+    for (const auto& format : formats) {
+        const bool is_bf16 = format.dtype == DType::BFloat16;
+        auto widen = [&](const SimdKernels& k) { return is_bf16 ? k.widen_bf16 : k.widen_fp16; };
+
+        // scalar conversion against the double-arithmetic rounding
+        std::vector<uint16_t> narrowed(n);
+        (simd_scalar_kernels().*format.narrow)(inputs.data(), narrowed.data(), n);
+        std::vector<float> widened(n);
+        widen(simd_scalar_kernels())(narrowed.data(), widened.data(), n);
+        size_t wrong = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const float expected = reference_round(inputs[i], format.bits, format.min_exponent, format.max_finite);
+            const bool same = std::isnan(expected) ? std::isnan(widened[i])
+                                                   : float_bits(widened[i]) == float_bits(expected);
+            if (!same && wrong++ == 0) {
+                check(false, std::string(format.name) + ": " + std::to_string(inputs[i]) + " rounds to " +
+                                 std::to_string(widened[i]) + ", expected " + std::to_string(expected));
+            }
+        }
+
+        // values the format represents survive the round trip exactly
+        std::vector<uint16_t> again(n);
+        (simd_scalar_kernels().*format.narrow)(widened.data(), again.data(), n);
+        bool round_trip = true;
+        for (size_t i = 0; i < n; ++i) round_trip = round_trip && again[i] == narrowed[i];
+        check(round_trip, std::string(format.name) + ": representable values must round-trip exactly");
+
+        // every instruction set gives the scalar bits
+        for (const SimdKernels* table : tables) {
+            std::vector<uint16_t> narrowed_isa(n);
+            std::vector<float> widened_isa(n);
+            (table->*format.narrow)(inputs.data(), narrowed_isa.data(), n);
+            widen(*table)(narrowed.data(), widened_isa.data(), n);
+            bool same = narrowed_isa == narrowed;
+            for (size_t i = 0; i < n; ++i) same = same && float_bits(widened_isa[i]) == float_bits(widened[i]);
+            check(same, std::string(format.name) + ": " + table->name + " kernels differ from scalar");
+        }
+
+        // tensor cast: same bits as the kernels, and the gradient passes straight through
+        auto x = std::make_shared<Tensor>(std::vector<int>{static_cast<int>(n)}, true);
+        std::copy(inputs.begin(), inputs.end(), x->data().begin());
+        auto weights = random_tensor({static_cast<int>(n)}, false);
+        x->zero_grad();
+        {
+            auto cast = to_dtype(x, format.dtype);
+            check(cast->dtype() == format.dtype, std::string(format.name) + ": cast dtype");
+            check(std::equal(narrowed.begin(), narrowed.end(), cast->storage->half_data()),
+                  std::string(format.name) + ": to_dtype differs from the kernels");
+            auto back = cast->to(DType::Float32);
+            bool same = true;
+            for (size_t i = 0; i < n; ++i) same = same && float_bits(back->data()[i]) == float_bits(widened[i]);
+            check(same, std::string(format.name) + ": widening cast differs from the kernels");
+            sum(mul(as_float32(cast), weights), {})->backward();
+        }
+        current_graph().clear();
+        check(std::equal(x->grad.begin(), x->grad.end(), weights->data().begin()),
+              std::string(format.name) + ": cast gradient must be the upstream gradient");
+    }
+
+    std::cout << "Checked " << n << " values on";
+    for (const SimdKernels* table : tables) std::cout << " " << table->name;
+    std::cout << std::endl;
+}
+
+// int8 dot product kernels this cpu can run, scalar first (the selection rules of ops/qgemm.cpp)
+static std::vector<const QgemmKernels*> available_qgemm_kernels() {
+    std::vector<const QgemmKernels*> tables = {&qgemm_scalar_kernels()};
+#ifdef CPPGRAD_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) tables.push_back(&qgemm_avx2_kernels());
+    if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw")) {
+        tables.push_back(&qgemm_vnni_kernels());
+    }
+#endif
+    return tables;
+}
+
+static void test_qgemm() {
+    const auto tables = available_qgemm_kernels();
+
+    // integer sums are exact, so every kernel must match the naive loop bit for bit; the depths
+    // cover empty, tail-only, exact-vector and vector-plus-tail rows, the extremes saturate nothing
+    for (int depth : {0, 1, 3, 15, 16, 31, 32, 33, 64, 100, 257, 1000}) {
+        for (int n : {1, 3, 8}) {
+            std::vector<uint8_t> a(depth);
+            std::vector<int8_t> w(static_cast<size_t>(depth) * n);
+            for (auto& v : a) v = gen() % 3 ? static_cast<uint8_t>(gen()) : 255;
+            for (auto& v : w) v = gen() % 3 ? static_cast<int8_t>(static_cast<int>(gen() % 255) - 127) : -127;
+
+            std::vector<int32_t> expected(n, 0);
+            for (int j = 0; j < n; ++j) {
+                for (int k = 0; k < depth; ++k) expected[j] += a[k] * w[static_cast<size_t>(j) * depth + k];
+            }
+            for (const QgemmKernels* table : tables) {
+                std::vector<int32_t> out(n, -1);
+                table->dot_rows(a.data(), w.data(), depth, n, out.data());
+                check(out == expected, std::string(table->name) + " dot_rows, depth " + std::to_string(depth) +
+                                           ", " + std::to_string(n) + " rows");
+            }
+        }
+    }
+
+    // qlinear against float math: it must equal the dequantized operands' product up to float
+    // rounding, and the float layer within the worst case of the rounding errors (half a step each)
+    const int m = 7, in = 37, out = 5;
+    auto x = random_tensor({m, in}, false, -1.0f, 3.0f);
+    auto weight = random_tensor({in, out}, false);
+    auto bias = random_tensor({out}, false);
+
+    const auto q = quantize_weights(*weight);
+    const auto range = std::minmax_element(x->data().begin(), x->data().end());
+    const QuantParams params = choose_quant_params(*range.first, *range.second);
+    std::vector<uint8_t> qx(static_cast<size_t>(m) * in);
+    quantize_activations(*x, params, qx.data());
+
+    for (bool relu : {false, true}) {
+        QLinearEpilogue epilogue;
+        epilogue.bias = bias->data().data();
+        epilogue.relu = relu;
+        std::vector<float> y(static_cast<size_t>(m) * out);
+        qlinear(m, qx.data(), params, q, epilogue, y.data(), nullptr);
+
+        double worst_dequantized = 0.0, worst_float = 0.0;  // float error as a fraction of its bound
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < out; ++j) {
+                double dequantized = bias->data()[j], exact = bias->data()[j], bound = 1e-5;
+                for (int k = 0; k < in; ++k) {
+                    const double xq = params.scale * (qx[static_cast<size_t>(i) * in + k] - params.zero_point);
+                    const double wq = q.scales[j] * q.values[static_cast<size_t>(j) * in + k];
+                    dequantized += xq * wq;
+                    exact += static_cast<double>(x->data()[i * in + k]) * weight->data()[k * out + j];
+                    const double x_error = 0.5 * params.scale, w_error = 0.5 * q.scales[j];
+                    bound += x_error * std::abs(weight->data()[k * out + j]) +
+                             w_error * std::abs(x->data()[i * in + k]) + x_error * w_error;
+                }
+                if (relu) {
+                    dequantized = std::max(0.0, dequantized);
+                    exact = std::max(0.0, exact);
+                }
+                const double value = y[static_cast<size_t>(i) * out + j];
+                worst_dequantized = std::max(worst_dequantized, std::abs(value - dequantized) / std::max(1.0, std::abs(dequantized)));
+                worst_float = std::max(worst_float, std::abs(value - exact) / bound);
+            }
+        }
+        const std::string what = relu ? "qlinear + relu" : "qlinear";
+        check(worst_dequantized < 1e-5, what + ": error against the dequantized product " + std::to_string(worst_dequantized));
+        check(worst_float <= 1.0, what + ": error against float32 beyond the quantization bound");
+        if (relu) std::cout << "qlinear error against float32: " << worst_float << " of the quantization bound" << std::endl;
+    }
+
+    std::cout << "Checked dot_rows on";
+    for (const QgemmKernels* table : tables) std::cout << " " << table->name;
+    std::cout << std::endl;
+}
+
+static void test_adam() {
+    // whole blocks, a parameter ending mid-block and one smaller than a block (each is padded to
+    // whole blocks, so the memory saving needs the larger ones)
+    const std::vector<std::vector<int>> shapes = {{64, 64}, {1000}, {7}};
+    const int steps = 30;
+    const float lr = 0.01f;
+
+    std::vector<std::shared_ptr<Tensor>> full, quantized;
+    std::vector<std::vector<double>> reference, m, v;
+    for (const auto& shape : shapes) {
+        full.push_back(random_tensor(shape, true));
+        quantized.push_back(std::make_shared<Tensor>(shape, true));
+        std::copy(full.back()->data().begin(), full.back()->data().end(), quantized.back()->data().begin());
+        reference.emplace_back(full.back()->data().begin(), full.back()->data().end());
+        m.emplace_back(reference.back().size(), 0.0);
+        v.emplace_back(reference.back().size(), 0.0);
+    }
+    const auto start = reference;
+
+    Adam adam(lr), adam8(lr);
+    adam8.set_quantized_state(true);
+
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::uniform_real_distribution<float> decade(-3.0f, 0.3f);
+    for (int t = 1; t <= steps; ++t) {
+        for (size_t p = 0; p < shapes.size(); ++p) {
+            // magnitudes over several decades in one block, some beyond the clip value
+            std::vector<float> grad(reference[p].size());
+            for (auto& g : grad) g = normal(gen) * std::pow(10.0f, decade(gen));
+            full[p]->grad.assign(grad.begin(), grad.end());
+            quantized[p]->grad.assign(grad.begin(), grad.end());
+
+            // the textbook update in double
+            for (size_t i = 0; i < grad.size(); ++i) {
+                const double g = std::min(1.0, std::max(-1.0, static_cast<double>(grad[i])));
+                m[p][i] = 0.9 * m[p][i] + 0.1 * g;
+                v[p][i] = 0.999 * v[p][i] + 0.001 * g * g;
+                const double m_hat = m[p][i] / (1.0 - std::pow(0.9, t));
+                const double v_hat = v[p][i] / (1.0 - std::pow(0.999, t));
+                reference[p][i] -= lr * m_hat / (std::sqrt(v_hat) + 1e-8);
+            }
+        }
+        adam.step(full);
+        adam8.step(quantized);
+    }
+
+    // float32 moments follow the reference up to rounding; 8-bit ones up to the quantization of
+    // the moments, measured against how far the parameters moved (about lr per step)
+    double worst_full = 0.0, worst_quantized = 0.0, squared_difference = 0.0, squared_move = 0.0;
+    for (size_t p = 0; p < shapes.size(); ++p) {
+        for (size_t i = 0; i < reference[p].size(); ++i) {
+            worst_full = std::max(worst_full, std::abs(full[p]->data()[i] - reference[p][i]));
+            worst_quantized = std::max(worst_quantized, std::abs(quantized[p]->data()[i] - reference[p][i]));
+            squared_difference += std::pow(quantized[p]->data()[i] - reference[p][i], 2);
+            squared_move += std::pow(reference[p][i] - start[p][i], 2);
+        }
+    }
+    check(worst_full < 1e-5, "float32 adam differs from the reference update by " + std::to_string(worst_full));
+    const double relative_rms = std::sqrt(squared_difference / squared_move);
+    check(relative_rms < 0.05, "8-bit adam: rms difference " + std::to_string(relative_rms) + " of the rms update");
+    check(worst_quantized < 0.1 * lr * steps,
+          "8-bit adam differs from the reference update by " + std::to_string(worst_quantized));
+    check(adam8.state_bytes() * 3 < adam.state_bytes(), "8-bit adam must hold well under a third of the state bytes");
+
+    std::cout << "Largest parameter difference after " << steps << " steps: float32 " << worst_full << ", 8-bit "
+              << worst_quantized << " (rms " << relative_rms << " of the update)" << std::endl;
+    std::cout << "State bytes: float32 " << adam.state_bytes() << ", 8-bit " << adam8.state_bytes() << std::endl;
+}
+
+// int8 model against the float model it was quantized from; the bound follows the rounding
+// errors layer by layer: each input is off by the error carried in plus half its quantization
+// step, each weight by half its channel's step, and relu never widens a difference
+static void test_quantized_model() {
+    Sequential model;
+    model.add_module(std::make_shared<Linear>(9, 16, Activation::ReLU));
+    model.add_module(std::make_shared<ReLU>());  // redundant after a relu layer, still foldable
+    model.add_module(std::make_shared<Linear>(16, 8));
+    model.add_module(std::make_shared<ReLU>());
+    model.add_module(std::make_shared<Linear>(8, 3));
+
+    auto x = random_tensor({40, 9}, false, -2.0f, 2.0f);
+
+    std::shared_ptr<QuantizedSequential> int8_model;
+    try {
+        int8_model = quantize(model, x);
+    } catch (const std::runtime_error& e) {
+        check(false, std::string("quantize: ") + e.what());
+        return;
+    }
+
+    NoGradGuard no_grad;
+    auto expected = model.forward(x);
+    auto result = int8_model->forward(x);
+    check(result->shape == expected->shape, "quantized model: output shape");
+
+    // the float activations entering each Linear, and the error bound carried with them
+    const int batch = x->shape[0];
+    std::vector<std::shared_ptr<Linear>> linears;
+    for (const auto& module : model.layers()) {
+        if (auto linear = std::dynamic_pointer_cast<Linear>(module)) linears.push_back(linear);
+    }
+    auto activations = x;
+    std::vector<double> error(static_cast<size_t>(batch) * 9, 0.0);
+    for (size_t l = 0; l < linears.size(); ++l) {
+        const auto& weight = *linears[l]->weight;
+        const int in = weight.shape[0], out = weight.shape[1];
+        const auto q = quantize_weights(weight);
+        const auto range = std::minmax_element(activations->data().begin(), activations->data().end());
+        const QuantParams params = choose_quant_params(*range.first, *range.second);
+
+        std::vector<double> next(static_cast<size_t>(batch) * out, 1e-5);
+        for (int i = 0; i < batch; ++i) {
+            for (int j = 0; j < out; ++j) {
+                for (int k = 0; k < in; ++k) {
+                    const double x_error = error[static_cast<size_t>(i) * in + k] + 0.5 * params.scale;
+                    const double w_error = 0.5 * q.scales[j];
+                    next[static_cast<size_t>(i) * out + j] +=
+                        x_error * (std::abs(weight.data()[k * out + j]) + w_error) +
+                        w_error * std::abs(activations->data()[i * in + k]);
+                }
+            }
+        }
+        error = std::move(next);
+        activations = linears[l]->forward(activations, l + 1 < linears.size() ? Activation::ReLU : Activation::None);
+    }
+
+    double worst = 0.0;
+    for (size_t i = 0; i < error.size() && i < static_cast<size_t>(result->numel()); ++i) {
+        worst = std::max(worst, std::abs(result->data()[i] - expected->data()[i]) / error[i]);
+    }
+    check(worst <= 1.0, "quantized model: error against the float model beyond the quantization bound");
+    std::cout << "Quantized model error: " << worst << " of the quantization bound" << std::endl;
+}
+
+// relative differences up to the magnitude 1, largest over the elements
+template <typename Values>
+static double max_error(const Values& got, const std::vector<double>& expected) {
+    if (got.size() != expected.size()) return std::numeric_limits<double>::infinity();
+    double worst = 0.0;
+    for (size_t i = 0; i < got.size(); ++i) {
+        worst = std::max(worst, std::abs(got[i] - expected[i]) / std::max(1.0, std::abs(expected[i])));
+    }
+    return worst;
+}
+
+// packed float32 copy of any tensor's elements (strided or 16-bit)
+static std::vector<float> values_of(const std::shared_ptr<Tensor>& t) {
+    NoGradGuard no_grad;
+    auto packed = to_dtype(t, DType::Float32)->contiguous();
+    const float* p = packed->storage->data() + packed->offset;
+    return std::vector<float>(p, p + packed->numel());
+}
+
+static float round_bf16(float v) {
+    return bf16_to_float(float_to_bf16(v));
+}
+
+// y = activation(x w + b) and the gradients of sum(y * g), by the textbook loops in double
+struct LinearReference {
+    std::vector<double> y, dx, dw, db;
+};
+
+static LinearReference reference_linear(const std::vector<float>& x, const std::vector<float>& w,
+                                        const std::vector<float>& b, const std::vector<float>& g, int batch,
+                                        int in, int out, bool relu) {
+    LinearReference r;
+    r.y.assign(static_cast<size_t>(batch) * out, 0.0);
+    r.dx.assign(static_cast<size_t>(batch) * in, 0.0);
+    r.dw.assign(static_cast<size_t>(in) * out, 0.0);
+    r.db.assign(out, 0.0);
+    for (int i = 0; i < batch; ++i) {
+        for (int j = 0; j < out; ++j) {
+            double z = b[j];
+            for (int k = 0; k < in; ++k) z += static_cast<double>(x[i * in + k]) * w[k * out + j];
+            r.y[i * out + j] = relu ? std::max(0.0, z) : z;
+
+            const double dz = relu && z <= 0.0 ? 0.0 : g[i * out + j];
+            r.db[j] += dz;
+            for (int k = 0; k < in; ++k) {
+                r.dx[i * in + k] += dz * w[k * out + j];
+                r.dw[k * out + j] += x[i * in + k] * dz;
+            }
+        }
+    }
+    return r;
+}
+
+static void test_linear() {
+    const char* names[] = {"Linear(ReLU)", "Linear -> ReLU", "strided input", "bfloat16 weight", "bf16 autocast"};
+
+    double worst_value = 0.0, worst_gradient = 0.0;
+    for (const auto& dims : std::vector<std::vector<int>>{{37, 29, 13}, {300, 70, 20}}) {
+        const int batch = dims[0], in = dims[1], out = dims[2];
+        for (int variant = 0; variant < 5; ++variant) {
+            const std::string what = std::string(names[variant]) + " " + shape_string(dims);
+            const bool strided = variant == 2;
+
+            auto layer = std::make_shared<Linear>(in, out, variant == 1 ? Activation::None : Activation::ReLU);
+            std::copy_n(random_tensor({out}, false, -0.5f, 0.5f)->data().begin(), out, layer->bias->data().begin());
+            Sequential model;
+            model.add_module(layer);
+            if (variant == 1) model.add_module(std::make_shared<ReLU>());
+
+            // a strided input is the transpose of an [in, batch] tensor
+            auto base = random_tensor(strided ? std::vector<int>{in, batch} : std::vector<int>{batch, in}, true);
+            auto x = strided ? base->transpose(0, 1) : base;
+            auto upstream = random_tensor({batch, out}, false);
+            layer->weight->zero_grad();
+            layer->bias->zero_grad();
+            base->zero_grad();
+
+            std::vector<float> y;
+            DType output_dtype;
+            {
+                std::shared_ptr<Tensor> output;
+                if (variant == 3) {
+                    output = linear(x, to_dtype(layer->weight, DType::BFloat16), layer->bias, Activation::ReLU);
+                } else if (variant == 4) {
+                    AutocastGuard autocast(DType::BFloat16);
+                    output = model.forward(x);
+                } else {
+                    output = model.forward(x);
+                }
+                output_dtype = output->dtype();
+                y = values_of(output);
+                sum(mul(output, upstream), {})->backward();
+            }
+            current_graph().clear();
+
+            // the reference sees the operands the kernels saw: bf16-rounded where the op casts them
+            auto xs = values_of(x);
+            auto ws = values_of(layer->weight);
+            if (variant == 4) std::transform(xs.begin(), xs.end(), xs.begin(), round_bf16);
+            if (variant >= 3) std::transform(ws.begin(), ws.end(), ws.begin(), round_bf16);
+            const auto r = reference_linear(xs, ws, values_of(layer->bias), values_of(upstream), batch, in, out, true);
+
+            // the autocast output is stored as bfloat16: one rounding of the float32 result
+            const double value_error = max_error(y, r.y);
+            check(output_dtype == (variant == 4 ? DType::BFloat16 : DType::Float32), what + ": output dtype");
+            check(value_error < (variant == 4 ? 4e-3 : 1e-5), what + ": output error " + std::to_string(value_error));
+            worst_value = std::max(worst_value, variant == 4 ? 0.0 : value_error);
+
+            // the input gradient lands in the base tensor's own layout
+            std::vector<double> dx = r.dx;
+            if (strided) {
+                for (int i = 0; i < batch; ++i) {
+                    for (int k = 0; k < in; ++k) dx[static_cast<size_t>(k) * batch + i] = r.dx[static_cast<size_t>(i) * in + k];
+                }
+            }
+            const double gradient_error = std::max({max_error(base->grad, dx), max_error(layer->weight->grad, r.dw),
+                                                    max_error(layer->bias->grad, r.db)});
+            check(gradient_error < 1e-5, what + ": gradient error " + std::to_string(gradient_error));
+            worst_gradient = std::max(worst_gradient, gradient_error);
+        }
+    }
+    std::cout << "Largest value error: " << worst_value << ", largest gradient error: " << worst_gradient << std::endl;
+}
+
+// a [rows, cols] gemm operand with random values in one of three layouts:
+// 0 row-major, 1 stored transposed, 2 every other column of a padded wider buffer
+struct GemmOperand {
+    std::vector<float> floats;
+    std::vector<uint16_t> halves;
+    std::vector<double> values;  // logical row-major values, as the kernel reads them
+    MatrixView view;
+};
+
+static GemmOperand gemm_operand(int rows, int cols, int layout, DType dtype) {
+    GemmOperand o;
+    int row_stride = cols, col_stride = 1;
+    if (layout == 1) {
+        row_stride = 1;
+        col_stride = rows;
+    } else if (layout == 2) {
+        row_stride = 2 * cols + 3;
+        col_stride = 2;
+    }
+    const size_t size = static_cast<size_t>(rows) * std::max(cols, 1) * (layout == 2 ? 3 : 1) + 1;
+    o.floats.assign(size, std::numeric_limits<float>::quiet_NaN());  // gaps must never be read
+    o.halves.assign(size, 0x7fc0u);
+    o.values.resize(static_cast<size_t>(rows) * cols);
+
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            const size_t at = static_cast<size_t>(r) * row_stride + static_cast<size_t>(c) * col_stride;
+            float v = dist(gen);
+            if (dtype == DType::BFloat16) {
+                o.halves[at] = float_to_bf16(v);
+                v = bf16_to_float(o.halves[at]);
+            }
+            o.floats[at] = v;
+            o.values[static_cast<size_t>(r) * cols + c] = v;
+        }
+    }
+    o.view = {dtype == DType::Float32 ? static_cast<const void*>(o.floats.data()) : o.halves.data(), row_stride,
+              col_stride, dtype};
+    return o;
+}
+
+// one gemm call against the reference loop, as an error in units of its rounding bound (the sum
+// of the product magnitudes times k float ulps); also fails when c is written past n
+static double gemm_case_error(int m, int n, int k, int layout_a, int layout_b, const std::string& what) {
+    const int variant = layout_a * 3 + layout_b;
+    const bool accumulate = variant % 2 == 1;
+    const bool with_epilogue = variant % 3 != 0;
+    auto a = gemm_operand(m, k, layout_a, variant == 4 ? DType::BFloat16 : DType::Float32);
+    auto b = gemm_operand(k, n, layout_b, variant == 2 ? DType::BFloat16 : DType::Float32);
+
+    // c rows are padded past n: the kernel must leave the padding alone
+    const int ldc = n + 3;
+    std::vector<float> c(static_cast<size_t>(m) * ldc, 7.0f);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) c[static_cast<size_t>(i) * ldc + j] = static_cast<float>(i - j) / 8.0f;
+    }
+    const std::vector<float> before = c;
+    const auto bias = random_tensor({n}, false);
+    GemmEpilogue epilogue;
+    if (with_epilogue) {
+        epilogue.bias = bias->data().data();
+        epilogue.relu = true;
+    }
+
+    gemm(m, n, k, a.view, b.view, c.data(), ldc, accumulate, epilogue);
+
+    double error = 0.0;
+    bool padding_kept = true;
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < n; ++j) {
+            const size_t at = static_cast<size_t>(i) * ldc + j;
+            double expected = accumulate ? before[at] : 0.0;
+            double magnitude = std::abs(expected) + 1.0;
+            for (int p = 0; p < k; ++p) {
+                const double product = a.values[static_cast<size_t>(i) * k + p] * b.values[static_cast<size_t>(p) * n + j];
+                expected += product;
+                magnitude += std::abs(product);
+            }
+            if (with_epilogue) expected = std::max(0.0, expected + bias->data()[j]);
+            error = std::max(error, std::abs(c[at] - expected) / (magnitude * (k + 2) * 6e-8));
+        }
+        for (int j = n; j < ldc; ++j) padding_kept = padding_kept && c[static_cast<size_t>(i) * ldc + j] == 7.0f;
+    }
+
+    const std::string name = what + " layouts " + std::to_string(layout_a) + std::to_string(layout_b) +
+                             (accumulate ? " accumulate" : "") + (with_epilogue ? " bias+relu" : "");
+    check(error <= 1.0, name + ": error " + std::to_string(error) + " of the rounding bound");
+    check(padding_kept, name + ": wrote past n");
+    return error;
+}
+
+static void test_gemm() {
+    // edge tiles (m % 6, n % 8), several depth blocks (k > 256), and shapes over the threading
+    // thresholds: m >= 240 row slices, short and wide column slices, short, narrow and deep
+    const std::vector<std::vector<int>> shapes = {
+        {1, 1, 1}, {7, 9, 5}, {6, 8, 256}, {13, 17, 300}, {5, 3, 0}, {245, 40, 300}, {50, 600, 80}, {9, 16, 20000},
+    };
+
+    // the sliced paths need a pool of several threads, whatever the machine has
+    const int pool_threads = ThreadPool::num_threads();
+    double worst = 0.0;
+    for (int threads : {1, 3}) {
+        ThreadPool::set_num_threads(threads);
+        for (const auto& shape : shapes) {
+            // every layout of a against every layout of b, with accumulate, epilogue and
+            // bfloat16 operands spread over the pairs
+            const std::string what = std::to_string(threads) + " thread gemm " + shape_string(shape);
+            for (int layout_a = 0; layout_a < 3; ++layout_a) {
+                for (int layout_b = 0; layout_b < 3; ++layout_b) {
+                    worst = std::max(worst, gemm_case_error(shape[0], shape[1], shape[2], layout_a, layout_b, what));
+                }
+            }
+        }
+    }
+
+    // the sliced paths sum every element in an order fixed by the shape: same bits for any pool size
+    for (const auto& shape : std::vector<std::vector<int>>{{245, 40, 300}, {50, 600, 80}, {9, 16, 20000}}) {
+        const int m = shape[0], n = shape[1], k = shape[2];
+        auto a = gemm_operand(m, k, 1, DType::Float32);
+        auto b = gemm_operand(k, n, 0, DType::Float32);
+        std::vector<std::vector<float>> results;
+        for (int threads : {1, 2, 3}) {
+            ThreadPool::set_num_threads(threads);
+            results.emplace_back(static_cast<size_t>(m) * n);
+            gemm(m, n, k, a.view, b.view, results.back().data(), n, false);
+        }
+        check(results[0] == results[1] && results[0] == results[2],
+              "gemm " + shape_string(shape) + ": result depends on the thread count");
+    }
+
+    ThreadPool::set_num_threads(pool_threads);
+    std::cout << "Largest error: " << worst << " of the rounding bound" << std::endl;
+}
+
+// parameter gradients of model, concatenated in parameter order
+static std::vector<float> parameter_grads(const Module& model) {
+    std::vector<float> grads;
+    for (const auto& p : model.parameters()) grads.insert(grads.end(), p->grad.begin(), p->grad.end());
+    return grads;
+}
+
+// loss and parameter gradients of a fresh forward + backward, graph cleared afterwards
+static std::pair<float, std::vector<float>> fresh_step(Module& model, const std::shared_ptr<Tensor>& x,
+                                                       const std::shared_ptr<Tensor>& target) {
+    model.zero_grad();
+    float loss_value;
+    {
+        auto loss = mse_loss(model.forward(x), target);
+        loss_value = loss->data()[0];
+        loss->backward();
+    }
+    current_graph().clear();
+    return {loss_value, parameter_grads(model)};
+}
+
+static void test_captured_step() {
+    auto model = std::make_shared<Sequential>();
+    model->add_module(std::make_shared<Linear>(6, 10, Activation::ReLU));
+    model->add_module(std::make_shared<Linear>(10, 5));
+    model->add_module(std::make_shared<ReLU>());
+    model->add_module(std::make_shared<Linear>(5, 1));
+
+    const int batch = 32;
+    auto x = random_tensor({batch, 6}, false, -2.0f, 2.0f);
+    auto target = random_tensor({batch, 1}, false);
+    model->zero_grad();
+    CapturedStep step(model, *x, *target);
+
+    // a new batch, then the same after the parameters moved: replay must match a fresh step
+    for (int round = 0; round < 2; ++round) {
+        if (round == 1) {
+            Adam adam(0.05f);
+            adam.step(model->parameters());
+        }
+        auto batch_x = random_tensor({batch, 6}, false, -2.0f, 2.0f);
+        auto batch_target = random_tensor({batch, 1}, false);
+
+        model->zero_grad();
+        const float replayed_loss = step.replay(*batch_x, *batch_target)->data()[0];
+        const auto replayed_grads = parameter_grads(*model);
+        const auto expected = fresh_step(*model, batch_x, batch_target);
+
+        const std::string what = round == 0 ? "replay on a new batch" : "replay after a parameter update";
+        check(replayed_loss == expected.first, what + ": loss " + std::to_string(replayed_loss) + " vs " +
+                                                   std::to_string(expected.first));
+        check(replayed_grads == expected.second, what + ": parameter gradients differ from a fresh step");
+    }
+
+    bool threw = false;
+    try {
+        step.replay(*random_tensor({batch + 1, 6}, false), *random_tensor({batch + 1, 1}, false));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "replay with a different batch shape must throw");
+    std::cout << "Replayed loss and gradients match fresh steps" << std::endl;
+}
+
+// small mlp whose Linear -> ReLU pairs fall on both sides of segment boundaries when checkpointed
+// by two modules; the same seed state gives the same values, copy_parameters makes twins exact
+static std::shared_ptr<Sequential> make_mlp() {
+    auto model = std::make_shared<Sequential>();
+    model->add_module(std::make_shared<Linear>(6, 12, Activation::ReLU));
+    model->add_module(std::make_shared<Linear>(12, 8));
+    model->add_module(std::make_shared<ReLU>());
+    model->add_module(std::make_shared<Linear>(8, 4, Activation::ReLU));
+    model->add_module(std::make_shared<Linear>(4, 1));
+    for (const auto& p : model->parameters()) {
+        auto values = random_tensor(p->shape, false, -0.7f, 0.7f);
+        std::copy(values->data().begin(), values->data().end(), p->data().begin());
+    }
+    return model;
+}
+
+static void copy_parameters(const Module& from, Module& to) {
+    const auto source = from.parameters();
+    const auto destination = to.parameters();
+    for (size_t i = 0; i < source.size(); ++i) {
+        std::copy(source[i]->data().begin(), source[i]->data().end(), destination[i]->data().begin());
+    }
+}
+
+static void test_checkpointing() {
+    auto plain = make_mlp();
+    auto checkpointed = make_mlp();
+    copy_parameters(*plain, *checkpointed);
+    checkpointed->set_checkpointing(2);
+
+    auto x = random_tensor({40, 6}, true, -2.0f, 2.0f);
+    auto target = random_tensor({40, 1}, false);
+
+    // the input takes part as a leaf of the first segment, so its gradient is compared as well
+    x->zero_grad();
+    const auto expected = fresh_step(*plain, x, target);
+    const std::vector<double> expected_input(x->grad.begin(), x->grad.end());
+    x->zero_grad();
+    const auto result = fresh_step(*checkpointed, x, target);
+
+    const double loss_error = std::abs(result.first - expected.first) / std::max(1.0f, std::abs(expected.first));
+    const double gradient_error = max_error(result.second, std::vector<double>(expected.second.begin(), expected.second.end()));
+    const double input_error = max_error(x->grad, expected_input);
+    check(loss_error < 1e-6, "checkpointed loss differs by " + std::to_string(loss_error));
+    check(gradient_error < 1e-6, "checkpointed parameter gradients differ by " + std::to_string(gradient_error));
+    check(input_error < 1e-6, "checkpointed input gradient differs by " + std::to_string(input_error));
+    std::cout << "Largest difference to the plain step: loss " << loss_error << ", parameter gradients "
+              << gradient_error << ", input gradient " << input_error << std::endl;
+}
+
+static void test_gradient_accumulation() {
+    auto full = make_mlp();
+    auto micro = make_mlp();
+    copy_parameters(*full, *micro);
+
+    // 40 rows in micro-batches of 7: the last one is short, so its row share differs
+    auto x = random_tensor({40, 6}, false, -2.0f, 2.0f);
+    auto target = random_tensor({40, 1}, false);
+    const auto expected = fresh_step(*full, x, target);
+
+    GradientAccumulator accumulator(micro, 7);
+    micro->zero_grad();
+    const float loss = accumulator.backward(x, target);
+    const auto grads = parameter_grads(*micro);
+
+    const double loss_error = std::abs(loss - expected.first) / std::max(1.0f, std::abs(expected.first));
+    const double gradient_error = max_error(grads, std::vector<double>(expected.second.begin(), expected.second.end()));
+    check(loss_error < 1e-6, "accumulated loss differs by " + std::to_string(loss_error));
+    check(gradient_error < 1e-6, "accumulated gradients differ by " + std::to_string(gradient_error));
+    std::cout << "Largest difference to the full batch: loss " << loss_error << ", gradients " << gradient_error
+              << std::endl;
+}
+
+static void test_flat_parameters() {
+    auto plain = make_mlp();
+    auto flat = make_mlp();
+    copy_parameters(*plain, *flat);
+
+    auto x = random_tensor({40, 6}, false, -2.0f, 2.0f);
+    auto target = random_tensor({40, 1}, false);
+
+    // gradients held before flattening are moved into the block (move_grad rebuilds Tensor::grad
+    // in place), values are repacked: both must survive unchanged
+    const auto held = fresh_step(*flat, x, target);
+    flat->flatten_parameters();
+    FlatParameters& block = *flat->flat_parameters();
+    const auto plain_params = plain->parameters();
+    const auto flat_params = flat->parameters();
+
+    bool values_kept = true, grads_kept = parameter_grads(*flat) == held.second, views_match = true;
+    for (size_t i = 0; i < flat_params.size(); ++i) {
+        const auto& p = flat_params[i];
+        values_kept = values_kept && std::equal(p->data().begin(), p->data().end(), plain_params[i]->data().begin());
+        views_match = views_match && p->data().data() == block.values().data() + block.offset(i) &&
+                      p->grad.data() == block.grads().data() + block.offset(i);
+    }
+    check(values_kept, "flattening changed parameter values");
+    check(grads_kept, "flattening changed the gradients held before it");
+    check(views_match, "parameters and gradients must live at their offsets in the block");
+
+    // a step on each must give the same loss, gradients and updated values
+    Adam plain_adam(0.01f), flat_adam(0.01f);
+    for (int step = 0; step < 3; ++step) {
+        const auto expected = fresh_step(*plain, x, target);
+        const auto result = fresh_step(*flat, x, target);
+        check(result.first == expected.first && result.second == expected.second,
+              "step " + std::to_string(step) + ": flat loss or gradients differ");
+        plain_adam.step(plain->parameters());
+        flat_adam.step(flat->parameters());
+    }
+    bool stepped_equal = true;
+    for (size_t i = 0; i < flat_params.size(); ++i) {
+        stepped_equal = stepped_equal && std::equal(flat_params[i]->data().begin(), flat_params[i]->data().end(),
+                                                    plain_params[i]->data().begin());
+    }
+    check(stepped_equal, "adam steps on flat parameters give different values");
+
+    flat->zero_grad();
+    const auto grads = block.grads();
+    check(std::all_of(grads.begin(), grads.end(), [](float g) { return g == 0.0f; }), "flat zero_grad left gradients");
+    std::cout << "Flat parameters match the plain model over " << block.size() << " elements" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Testing Kernels ===" << std::endl;
+
+    std::cout << "\n1. Broadcasting element-wise ops (forward and gradients):" << std::endl;
+    test_broadcast();
+
+    std::cout << "\n2. Mean and variance over axes (forward and gradients):" << std::endl;
+    test_reductions();
+
+    std::cout << "\n3. Float32 <-> bfloat16 / float16 casts:" << std::endl;
+    test_casts();
+
+    std::cout << "\n4. Int8 gemm kernels:" << std::endl;
+    test_qgemm();
+
+    std::cout << "\n5. Adam with float32 and 8-bit moments:" << std::endl;
+    test_adam();
+
+    std::cout << "\n6. Int8 model from a trained Sequential:" << std::endl;
+    test_quantized_model();
+
+    std::cout << "\n7. Fused linear layers (forward and gradients):" << std::endl;
+    test_linear();
+
+    std::cout << "\n8. Blocked gemm against a naive loop:" << std::endl;
+    test_gemm();
+
+    std::cout << "\n9. Captured step replay:" << std::endl;
+    test_captured_step();
+
+    std::cout << "\n10. Activation checkpointing against a plain step:" << std::endl;
+    test_checkpointing();
+
+    std::cout << "\n11. Gradient accumulation against a full batch:" << std::endl;
+    test_gradient_accumulation();
+
+    std::cout << "\n12. Flat parameters against a plain model:" << std::endl;
+    test_flat_parameters();
+
+    if (failures) {
+        std::cout << "\n" << failures << " kernel check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "\nAll kernel checks passed" << std::endl;
+    return 0;
+}
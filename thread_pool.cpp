@@ -0,0 +1,185 @@
+/*
+ * thread_pool.cpp - workers, job hand-off and the global pool
+ *
+ * one job at a time: the owner publishes (task, context, chunks) and bumps the generation,
+ * every thread (workers and owner) then claims chunk indices from one atomic counter
+ * the owner returns once every chunk finished and no worker is still inside the job,
+ * so a late worker can never claim a chunk of the next job with the old task
+ */
+
+#include "thread_pool.hpp"
+#include "logging.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// set while a thread executes pool chunks, nested parallel_for calls then run serially
+static thread_local bool inside_pool = false;
+
+class Pool {
+public:
+    explicit Pool(int threads) {
+        for (int i = 1; i < threads; ++i) workers.emplace_back([this] { worker_loop(); });
+    }
+
+    ~Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
+    }
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    void run(size_t chunks, ThreadPool::Task task, void* context) {
+        // checked before job_owner: a chunk run by the owner thread must not try_lock the mutex
+        // its own job already holds
+        if (inside_pool) {
+            for (size_t i = 0; i < chunks; ++i) task(context, i);
+            return;
+        }
+        std::unique_lock<std::mutex> owner(job_owner, std::try_to_lock);
+        if (!owner.owns_lock()) {
+            // the pool is busy with another caller's job
+            for (size_t i = 0; i < chunks; ++i) task(context, i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job_task = task;
+            job_context = context;
+            job_chunks = chunks;
+            next_chunk.store(0, std::memory_order_relaxed);
+            finished_chunks = 0;
+            error = nullptr;
+            ++generation;
+        }
+        wake.notify_all();
+
+        work(task, context, chunks);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return finished_chunks == chunks && active_workers == 0; });
+        job_task = nullptr;
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    void worker_loop() {
+        size_t seen = 0;
+        for (;;) {
+            ThreadPool::Task task;
+            void* context;
+            size_t chunks;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || (generation != seen && job_task); });
+                if (stopping) return;
+                seen = generation;
+                task = job_task;
+                context = job_context;
+                chunks = job_chunks;
+                ++active_workers;
+            }
+
+            work(task, context, chunks);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --active_workers;
+            }
+            done.notify_one();
+        }
+    }
+
+    // claims and runs chunks until none are left
+    void work(ThreadPool::Task task, void* context, size_t chunks) {
+        inside_pool = true;
+        size_t completed = 0;
+        for (size_t i = next_chunk.fetch_add(1); i < chunks; i = next_chunk.fetch_add(1)) {
+            try {
+                task(context, i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) error = std::current_exception();
+            }
+            ++completed;
+        }
+        inside_pool = false;
+
+        if (completed == 0) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        finished_chunks += completed;
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex job_owner;  // held by the thread whose job is running
+
+    std::mutex mutex;
+    std::condition_variable wake;  // workers: a new job or shutdown
+    std::condition_variable done;  // owner: chunks finished / a worker left the job
+    bool stopping = false;
+    size_t generation = 0;
+    ThreadPool::Task job_task = nullptr;
+    void* job_context = nullptr;
+    size_t job_chunks = 0;
+    std::atomic<size_t> next_chunk{0};
+    size_t finished_chunks = 0;
+    int active_workers = 0;
+    std::exception_ptr error;
+};
+
+// CPPGRAD_NUM_THREADS, or one thread per hardware thread
+static int default_threads() {
+    if (const char* env = std::getenv("CPPGRAD_NUM_THREADS")) {
+        const int threads = std::atoi(env);
+        if (threads >= 1) return threads;
+        LOG_WARN("[ThreadPool] ignoring CPPGRAD_NUM_THREADS=" << env);
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+static std::mutex& pool_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::unique_ptr<Pool>& pool() {
+    static std::unique_ptr<Pool> instance = std::make_unique<Pool>(default_threads());
+    return instance;
+}
+
+// cached so the serial check in parallel_for is one relaxed load
+static std::atomic<int> pool_size{0};
+
+int ThreadPool::num_threads() {
+    int size = pool_size.load(std::memory_order_relaxed);
+    if (size == 0) {
+        std::lock_guard<std::mutex> lock(pool_mutex());
+        size = pool()->size();
+        pool_size.store(size, std::memory_order_relaxed);
+    }
+    return size;
+}
+
+void ThreadPool::set_num_threads(int threads) {
+    std::lock_guard<std::mutex> lock(pool_mutex());
+    threads = std::max(1, threads);
+    pool().reset();
+    pool() = std::make_unique<Pool>(threads);
+    pool_size.store(threads, std::memory_order_relaxed);
+    LOG_DEBUG("[ThreadPool] " << threads << " threads");
+}
+
+void ThreadPool::run(size_t chunks, Task task, void* context) {
+    pool()->run(chunks, task, context);
+}
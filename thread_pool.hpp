@@ -0,0 +1,61 @@
+/*
+ * thread_pool.hpp - process-wide worker pool for intra-op parallelism
+ *
+ * kernels split their index range with parallel_for and the pool runs the pieces:
+ * - num_threads() threads share the work, the calling thread is one of them
+ * - CPPGRAD_NUM_THREADS sets the size at startup (default: hardware concurrency),
+ *   set_num_threads() changes it later; 1 runs everything on the calling thread
+ * - ranges that fit in one grain never touch the pool, so tiny tensors stay serial
+ * - a parallel_for issued from inside a pool task, or while another thread owns the pool,
+ *   runs serially on its caller instead of waiting
+ *
+ * usage:
+ *     parallel_for(0, n, 1 << 15, [&](size_t begin, size_t end) {
+ *         simd_add(a + begin, b + begin, out + begin, end - begin);
+ *     });
+ *
+ * IMPORTANT: chunk boundaries depend only on the range and the grain, never on the thread count,
+ * so kernels that combine per-chunk results in chunk order give the same bits for any pool size
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+class ThreadPool {
+public:
+    using Task = void (*)(void* context, size_t chunk);
+
+    static int num_threads();
+    // joins the current workers and starts threads - 1 new ones (call between steps, not during one)
+    static void set_num_threads(int threads);
+
+    // runs task(context, chunk) for every chunk in [0, chunks) and returns when all are done
+    // an exception thrown by a task is rethrown here after the other chunks finished
+    static void run(size_t chunks, Task task, void* context);
+};
+
+// calls fn(begin, end) over consecutive pieces of [first, last) of at most grain indices
+template <typename Fn>
+void parallel_for(size_t first, size_t last, size_t grain, Fn&& fn) {
+    if (first >= last) return;
+    const size_t chunks = (last - first + grain - 1) / grain;
+    if (chunks == 1 || ThreadPool::num_threads() == 1) {
+        fn(first, last);
+        return;
+    }
+
+    struct Range {
+        std::remove_reference_t<Fn>* fn;
+        size_t first;
+        size_t last;
+        size_t grain;
+    } range{&fn, first, last, grain};
+
+    ThreadPool::run(chunks, [](void* context, size_t chunk) {
+        const Range& r = *static_cast<const Range*>(context);
+        const size_t begin = r.first + chunk * r.grain;
+        (*r.fn)(begin, std::min(r.last, begin + r.grain));
+    }, &range);
+}